@@ -0,0 +1,928 @@
+//----------------------------------------------------------
+//  
+//  Name: Bench.cpp
+//
+//  Desc: Micro-benchmarks for the TinyRaster rasterization
+//  paths. Not part of the renderer itself.
+//
+//----------------------------------------------------------
+
+#include "./Framebuffer.h"
+#include "./Mesh.h"
+#include "./Pipeline.h"
+#include "./Scene.h"
+#include "./Texture.h"
+#include "./VertexBuffer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//renders many small random shaded triangles and reports throughput per thread count
+static void BenchTileScaling()
+{
+  const int W = 1024;
+  const int H = 1024;
+  const int TRIS = 200000;
+  const int FRAMES = 5;
+
+  std::vector<Vertex> tris;
+  tris.reserve(TRIS * 3);
+  std::srand(1234);
+  for(int i = 0; i < TRIS; i++)
+  {
+    float cx = (float)(std::rand() % W);
+    float cy = (float)(std::rand() % H);
+    for(int k = 0; k < 3; k++)
+    {
+      Vertex v;
+      v.m_Position = Vec3(cx + (float)(std::rand() % 32 - 16), cy + (float)(std::rand() % 32 - 16), 0.0f);
+      v.m_Color = Vec3((float)(std::rand() % 256), (float)(std::rand() % 256), (float)(std::rand() % 256));
+      tris.push_back(v);
+    }
+  }
+
+  int maxThreads = (int)std::thread::hardware_concurrency();
+  if(maxThreads < 1) maxThreads = 1;
+
+  std::cout << "tile scaling: " << TRIS << " shaded triangles, " << W << "x" << H << std::endl;
+
+  for(int threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    Framebuffer fbo(W, H);
+    fbo.SetThreadCount(threads);
+
+    auto start = std::chrono::steady_clock::now();
+    for(int f = 0; f < FRAMES; f++)
+    {
+      fbo.ClearFramebuffer(CP::BLACK);
+      for(int i = 0; i < TRIS; i++)
+      {
+        fbo.PutShadedTriangle(tris[i * 3], tris[i * 3 + 1], tris[i * 3 + 2]);
+      }
+      fbo.Flush();
+    }
+    double t = Seconds(start);
+
+    std::cout << "  threads " << threads << ": " << (double)TRIS * FRAMES / t / 1e6 << " Mtri/s" << std::endl;
+  }
+}
+
+//shades full-screen quads on one thread to measure raw shaded fill rate of a pixel format. With
+//perspective the right side is four times farther away, so every pixel pays the divide.
+template<typename FB>
+static void BenchShadedFill(const char* format, bool perspective = false)
+{
+  const int W = 1024;
+  const int H = 1024;
+  const int FRAMES = 50;
+
+  Vertex v0{Vec3(0.0f, 0.0f, 0.0f), Vec3(255.0f, 0.0f, 0.0f)};
+  Vertex v1{Vec3((float)W, 0.0f, 0.0f), Vec3(0.0f, 255.0f, 0.0f)};
+  Vertex v2{Vec3((float)W, (float)H, 0.0f), Vec3(0.0f, 0.0f, 255.0f)};
+  Vertex v3{Vec3(0.0f, (float)H, 0.0f), Vec3(255.0f, 255.0f, 255.0f)};
+  if(perspective) v1.m_InvW = v2.m_InvW = 0.25f;
+
+  FB fbo(W, H);
+
+  auto start = std::chrono::steady_clock::now();
+  for(int f = 0; f < FRAMES; f++)
+  {
+    fbo.PutShadedTriangle(v0, v1, v2);
+    fbo.PutShadedTriangle(v0, v2, v3);
+  }
+  double t = Seconds(start);
+
+  std::cout << "shaded fill " << format << (perspective ? " perspective" : "") << ": "
+    << (double)W * H * FRAMES / t / 1e6 << " Mpx/s" << std::endl;
+}
+
+//draws a stack of full-screen quads front to back: without depth every layer is shaded, with a
+//depth buffer the hierarchical z rejects the hidden layers tile by tile
+static void BenchOcclusion()
+{
+  const int W = 1024;
+  const int H = 1024;
+  const int LAYERS = 100;
+  const int FRAMES = 5;
+
+  std::vector<Vertex> quads;
+  for(int i = 0; i < LAYERS; i++)
+  {
+    float z = (float)(i + 1) / (float)(LAYERS + 1);
+    Vec3 c((float)(i % 256), (float)(i * 7 % 256), (float)(i * 13 % 256));
+
+    Vertex v0{Vec3(0.0f, 0.0f, z), c};
+    Vertex v1{Vec3((float)W, 0.0f, z), c};
+    Vertex v2{Vec3((float)W, (float)H, z), c};
+    Vertex v3{Vec3(0.0f, (float)H, z), c};
+    quads.insert(quads.end(), {v0, v1, v2, v0, v2, v3});
+  }
+
+  const char* names[] = {"none", "F32", "UNORM16"};
+  const DepthFormat formats[] = {DepthFormat::NONE, DepthFormat::F32, DepthFormat::UNORM16};
+
+  std::cout << "occlusion: " << LAYERS << " full-screen layers, front to back" << std::endl;
+
+  for(int f = 0; f < 3; f++)
+  {
+    Framebuffer fbo(W, H);
+    fbo.SetDepthFormat(formats[f]);
+
+    auto start = std::chrono::steady_clock::now();
+    for(int frame = 0; frame < FRAMES; frame++)
+    {
+      fbo.ClearFramebuffer(CP::BLACK);
+      fbo.ClearDepth();
+      for(size_t i = 0; i < quads.size(); i += 3)
+      {
+        fbo.PutShadedTriangle(quads[i], quads[i + 1], quads[i + 2]);
+      }
+    }
+    double t = Seconds(start);
+
+    std::cout << "  depth " << names[f] << ": " << t / FRAMES * 1e3 << " ms/frame" << std::endl;
+  }
+}
+
+//clears a 4K framebuffer, eagerly and with fast clear
+static void BenchClear()
+{
+  const int W = 3840;
+  const int H = 2160;
+  const int FRAMES = 50;
+
+  Framebuffer fbo(W, H);
+
+  for(int fast = 0; fast < 2; fast++)
+  {
+    fbo.SetFastClear(fast == 1);
+
+    auto start = std::chrono::steady_clock::now();
+    for(int f = 0; f < FRAMES; f++)
+    {
+      fbo.ClearFramebuffer(CP::ORANGE);
+    }
+    double t = Seconds(start);
+
+    std::cout << (fast ? "fast clear: " : "clear: ") << t / FRAMES * 1e3 << " ms/frame, "
+      << (double)W * H * sizeof(Color) * FRAMES / t / 1e9 << " GB/s" << std::endl;
+  }
+}
+
+//encodes a rendered frame (a shaded gradient under flat-colored triangles) in every image format
+static void BenchEncode()
+{
+  const int W = 1024;
+  const int H = 1024;
+  const int FRAMES = 10;
+
+  Framebuffer fbo(W, H);
+  fbo.ClearFramebuffer(CP::BLACK);
+
+  Vertex v0{Vec3(0.0f, 0.0f, 0.0f), Vec3(255.0f, 0.0f, 0.0f)};
+  Vertex v1{Vec3((float)W, 0.0f, 0.0f), Vec3(0.0f, 255.0f, 0.0f)};
+  Vertex v2{Vec3((float)W, (float)H * 0.5f, 0.0f), Vec3(0.0f, 0.0f, 255.0f)};
+  fbo.PutShadedTriangle(v0, v1, v2);
+
+  std::srand(99);
+  for(int i = 0; i < 200; i++)
+  {
+    float cx = (float)(std::rand() % W);
+    float cy = (float)(std::rand() % H);
+    fbo.PutFilledTriangle(cx, cy, cx + (float)(std::rand() % 128), cy + (float)(std::rand() % 64),
+      cx - (float)(std::rand() % 64), cy + (float)(std::rand() % 128), (CP)(std::rand() % 7));
+  }
+
+  std::vector<Color> rgb((size_t)W * H);
+  fbo.ReadPixelsRGB(rgb.data());
+
+  int maxThreads = (int)std::thread::hardware_concurrency();
+  if(maxThreads < 1) maxThreads = 1;
+
+  const ImageFormat formats[] = {ImageFormat::PPM, ImageFormat::QOI, ImageFormat::PNG};
+  std::vector<uint8_t> out;
+  double mb = (double)W * H * sizeof(Color) / (1024.0 * 1024.0);
+
+  for(ImageFormat format : formats)
+  {
+    for(int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+      auto start = std::chrono::steady_clock::now();
+      for(int f = 0; f < FRAMES; f++)
+      {
+        EncodeImage(format, rgb.data(), W, H, threads, out);
+      }
+      double t = Seconds(start);
+
+      std::cout << "encode " << ImageExtension(format) << " threads " << threads << ": "
+        << mb * FRAMES / t << " MB/s, " << out.size() << " bytes ("
+        << 100.0 * (double)out.size() / ((double)W * H * sizeof(Color)) << "%)" << std::endl;
+
+      if(format == ImageFormat::PPM) break;
+    }
+  }
+}
+
+//transforms a large vertex batch the way main.cpp used to (matrix products per vertex) and
+//through the SoA batch stage
+static void BenchVertexTransform()
+{
+  const int COUNT = 1 << 20;
+  const int FRAMES = 10;
+
+  Mat4 model, view, persp, ortho;
+  model.m_Mat[0][3] = 3.0f;
+  view.m_Mat[2][3] = -900.0f;
+  persp.m_Mat[2][2] = -1.0002f;
+  persp.m_Mat[2][3] = -0.2f;
+  persp.m_Mat[3][2] = -1.0f;
+  persp.m_Mat[3][3] = 0.0f;
+  ortho.m_Mat[0][0] = 2.0f;
+  ortho.m_Mat[1][1] = 2.0f;
+  constexpr Viewport vp = Viewport::FromSize(1024.0f, 1024.0f);
+  constexpr Mat4 vpm = Mat4::Viewport(1024.0f, 1024.0f);
+
+  std::vector<Vec4> aos(COUNT);
+  VertexBuffer soa(COUNT);
+  std::srand(5);
+  for(int i = 0; i < COUNT; i++)
+  {
+    Vec4 p((float)(std::rand() % 1000 - 500), (float)(std::rand() % 1000 - 500), (float)(std::rand() % 1000 - 500), 1.0f);
+    aos[i] = p;
+    soa.Set(i, p);
+  }
+
+  std::vector<Vec4> out(COUNT);
+  auto start = std::chrono::steady_clock::now();
+  for(int f = 0; f < FRAMES; f++)
+  {
+    for(int i = 0; i < COUNT; i++)
+    {
+      Vec4 clip = view * model * aos[i];
+      clip = persp * clip;
+      clip /= clip.W();
+      out[i] = vpm * ortho * clip;
+    }
+  }
+  double t = Seconds(start);
+  std::cout << "vertex transform per-vertex matrices: " << (double)COUNT * FRAMES / t / 1e6 << " Mvert/s" << std::endl;
+
+  Mat4 mvp = ortho * persp * view * model;
+  VertexBuffer screen;
+  start = std::chrono::steady_clock::now();
+  for(int f = 0; f < FRAMES; f++)
+  {
+    TransformVertices(mvp, vp, soa, screen);
+  }
+  t = Seconds(start);
+  std::cout << "vertex transform SoA batch: " << (double)COUNT * FRAMES / t / 1e6 << " Mvert/s" << std::endl;
+}
+
+//vertex stage of an indexed grid mesh: every triangle corner transformed on its own, against the
+//post-transform cache (each shared vertex once), for the whole mesh and for a small part of it
+static void BenchIndexed()
+{
+  const int GRID = 256;
+  const int FRAMES = 20;
+
+  VertexBuffer grid(GRID * GRID);
+  for(int y = 0; y < GRID; y++)
+  {
+    for(int x = 0; x < GRID; x++)
+    {
+      grid.Set(y * GRID + x, Vec3((float)x - GRID / 2, (float)y - GRID / 2, 0.0f));
+    }
+  }
+
+  std::vector<int> indices;
+  for(int y = 0; y + 1 < GRID; y++)
+  {
+    for(int x = 0; x + 1 < GRID; x++)
+    {
+      int i = y * GRID + x;
+      indices.insert(indices.end(), {i, i + 1, i + GRID + 1, i, i + GRID + 1, i + GRID});
+    }
+  }
+  std::vector<int> part(indices.begin(), indices.begin() + indices.size() / 32);
+
+  VertexBuffer corners((int)indices.size());
+  for(size_t i = 0; i < indices.size(); i++)
+  {
+    corners.Set((int)i, grid.Get(indices[i]));
+  }
+
+  constexpr Viewport vp = Viewport::FromSize(1024.0f, 1024.0f);
+  constexpr Mat4 proj = Mat4::Perspective(0.785f, 1.0f, 0.1f, 1024.0f);
+  auto mvp = [&](int f){ return proj * Mat4::LookAt(Vec3((float)f, 0.0f, 400.0f), Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f)); };
+
+  VertexBuffer out;
+  auto start = std::chrono::steady_clock::now();
+  for(int f = 0; f < FRAMES; f++)
+  {
+    TransformVertices(mvp(f), vp, corners, out);
+  }
+  double t = Seconds(start);
+  std::cout << "indexed grid per corner: " << corners.Size() << " vertices, " << t / FRAMES * 1e3 << " ms/frame" << std::endl;
+
+  const std::vector<int>* lists[2] = {&indices, &part};
+  const char* names[2] = {"whole", "1/32"};
+  for(int l = 0; l < 2; l++)
+  {
+    VertexCache cache;
+    int transformed = 0;
+    start = std::chrono::steady_clock::now();
+    for(int f = 0; f < FRAMES; f++)
+    {
+      transformed = cache.Transform(mvp(f), vp, grid, *lists[l]);
+    }
+    t = Seconds(start);
+    std::cout << "indexed grid vertex cache (" << names[l] << "): " << lists[l]->size() << " corners, " << transformed
+      << " vertices, " << t / FRAMES * 1e3 << " ms/frame" << std::endl;
+  }
+}
+
+//parses a generated grid OBJ serially and on every core, then writes and maps its cache
+static void BenchMeshLoad()
+{
+  const int GRID = 1024;
+  const char* path = "/tmp/tr_bench_mesh.obj";
+  const char* cache = "/tmp/tr_bench_mesh.obj.trmc";
+
+  {
+    std::ofstream obj(path);
+    char line[96];
+    for(int y = 0; y < GRID; y++)
+    {
+      for(int x = 0; x < GRID; x++)
+      {
+        std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x * 0.37f, y * 0.37f, (float)((x * y) % 97) * 0.01f);
+        obj << line;
+      }
+    }
+    for(int y = 0; y + 1 < GRID; y++)
+    {
+      for(int x = 0; x + 1 < GRID; x++)
+      {
+        int i = y * GRID + x + 1;
+        obj << "f " << i << ' ' << i + 1 << ' ' << i + GRID + 1 << ' ' << i + GRID << '\n';
+      }
+    }
+  }
+
+  int threads = (int)std::thread::hardware_concurrency();
+  int counts[2] = {1, threads};
+  Mesh mesh;
+  for(int c = 0; c < 2; c++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    mesh = Mesh::Load(path, counts[c]);
+    double t = Seconds(start);
+    std::cout << "mesh load obj (" << counts[c] << " threads): " << mesh.TriangleCount() << " triangles, " << t * 1e3
+      << " ms" << std::endl;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  mesh.WriteCache(cache);
+  double t = Seconds(start);
+  std::cout << "mesh write cache: " << t * 1e3 << " ms" << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  Mesh mapped = Mesh::MapCache(cache);
+  t = Seconds(start);
+  std::cout << "mesh map cache: " << mapped.TriangleCount() << " triangles, " << t * 1e3 << " ms" << std::endl;
+
+  std::remove(path);
+  std::remove(cache);
+
+  //malformed headers: element counts far beyond the data that follows must be rejected before
+  //anything is sized by them
+  const char* ply = "/tmp/tr_bench_mesh.ply";
+  const char* headers[2] = {
+    "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\nproperty float y\nproperty float z\n"
+    "element face 999999999999\nproperty list uchar int vertex_indices\nend_header\n"
+    "0 0 0\n1 0 0\n0 1 0\n3 0 1 2\n",
+    "ply\nformat binary_little_endian 1.0\nelement vertex 2000000000\nproperty float x\nproperty float y\n"
+    "property float z\nend_header\n"
+  };
+  const char* names[2] = {"oversized face count", "truncated vertices"};
+  for(int k = 0; k < 2; k++)
+  {
+    {
+      std::ofstream out(ply, std::ios::binary);
+      out << headers[k];
+    }
+
+    bool rejected = false;
+    try
+    {
+      Mesh::Load(ply, 1);
+    }
+    catch(Mesh::Invalid)
+    {
+      rejected = true;
+    }
+    std::cout << "mesh load ply (" << names[k] << "): " << (rejected ? "rejected" : "NOT rejected") << std::endl;
+  }
+  std::remove(ply);
+}
+
+//a city of 100k boxes seen from street level: bvh culling against testing every object, and
+//drawing what survives against drawing everything
+static void BenchSceneCull()
+{
+  const int SIDE = 316;
+  const int FRAMES = 16;
+
+  VertexBuffer box(8);
+  for(int i = 0; i < 8; i++)
+  {
+    box.Set(i, Vec3((i & 1) ? 0.5f : -0.5f, (i & 2) ? 1.0f : 0.0f, (i & 4) ? 0.5f : -0.5f));
+  }
+  std::vector<int> indices = {
+    0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4,
+    2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5
+  };
+
+  Scene scene;
+  std::srand(7);
+  for(int z = 0; z < SIDE; z++)
+  {
+    for(int x = 0; x < SIDE; x++)
+    {
+      Mat4 model(1.0f);
+      model.m_Mat[0][0] = 12.0f;
+      model.m_Mat[1][1] = 10.0f + (float)(std::rand() % 90);
+      model.m_Mat[2][2] = 12.0f;
+      model.m_Mat[0][3] = (float)(x - SIDE / 2) * 20.0f;
+      model.m_Mat[2][3] = (float)(z - SIDE / 2) * 20.0f;
+      scene.Add(box, indices, model, CP::WHITE);
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  scene.Build();
+  double t = Seconds(start);
+  std::cout << "scene build: " << scene.Size() << " objects, " << t * 1e3 << " ms" << std::endl;
+
+  constexpr Mat4 proj = Mat4::Perspective(1.047f, 1.0f, 0.5f, 2000.0f);
+  auto viewProj = [&](int f)
+  {
+    float yaw = (float)f * 0.39f;
+    Vec3 eye(0.0f, 2.0f, 10.0f);
+    return proj * Mat4::LookAt(eye, eye + Vec3(std::cos(yaw), 0.0f, std::sin(yaw)), Vec3(0.0f, 1.0f, 0.0f));
+  };
+
+  size_t visible = 0;
+  start = std::chrono::steady_clock::now();
+  for(int f = 0; f < FRAMES; f++)
+  {
+    visible += scene.Cull(viewProj(f)).size();
+  }
+  t = Seconds(start);
+  std::cout << "scene cull bvh: " << (double)visible / FRAMES << " of " << scene.Size() << " visible, "
+    << t / FRAMES * 1e3 << " ms/frame" << std::endl;
+
+  size_t brute = 0;
+  start = std::chrono::steady_clock::now();
+  for(int f = 0; f < FRAMES; f++)
+  {
+    ViewFrustum frustum(viewProj(f));
+    for(int i = 0; i < scene.Size(); i++)
+    {
+      uint32_t mask = ViewFrustum::ALL_PLANES;
+      brute += frustum.Test(scene.Bounds(i), mask);
+    }
+  }
+  t = Seconds(start);
+  std::cout << "scene cull every object: " << (double)brute / FRAMES << " visible, " << t / FRAMES * 1e3
+    << " ms/frame" << std::endl;
+
+  Framebuffer fb(1024, 1024);
+  fb.SetCullMode(CullMode::BACK);
+  const int DRAWN = 4;
+
+  start = std::chrono::steady_clock::now();
+  for(int f = 0; f < DRAWN; f++)
+  {
+    fb.ClearFramebuffer(CP::BLACK);
+    scene.Draw(fb, viewProj(f));
+  }
+  t = Seconds(start);
+  std::cout << "scene draw culled: " << t / DRAWN * 1e3 << " ms/frame" << std::endl;
+
+  start = std::chrono::steady_clock::now();
+  for(int f = 0; f < DRAWN; f++)
+  {
+    fb.ClearFramebuffer(CP::BLACK);
+    Mat4 vp = viewProj(f);
+    for(int i = 0; i < scene.Size(); i++)
+    {
+      fb.DrawIndexed(vp * scene.GetTransform(i), box, indices, CP::WHITE);
+    }
+  }
+  t = Seconds(start);
+  std::cout << "scene draw everything: " << t / DRAWN * 1e3 << " ms/frame" << std::endl;
+}
+
+//the former Mat4 product: one GetRow/GetColumn pair and dot product per entry
+static Mat4 MulByRowsAndColumns(const Mat4& a, const Mat4& b)
+{
+  Mat4 result(0.0f);
+  for(int i = 0; i < 4; i++)
+  {
+    for(int j = 0; j < 4; j++)
+    {
+      result.m_Mat[i][j] = a.GetRow(i).Dot(b.GetColumn(j));
+    }
+  }
+  return result;
+}
+
+static Vec4 MulByRows(const Mat4& a, const Vec4& v)
+{
+  return Vec4(a.GetRow(0).Dot(v), a.GetRow(1).Dot(v), a.GetRow(2).Dot(v), a.GetRow(3).Dot(v));
+}
+
+//Mat4 products, transpose and inverse against the former row/column implementation
+static void BenchMatrix()
+{
+  const int N = 1024;
+  const int ITERS = 2000;
+
+  std::vector<Mat4> mats(N);
+  std::vector<Vec4> vecs(N);
+  std::srand(11);
+  for(int k = 0; k < N; k++)
+  {
+    for(int i = 0; i < 4; i++)
+    {
+      for(int j = 0; j < 4; j++)
+      {
+        mats[k].m_Mat[i][j] = (float)(std::rand() % 200 - 100) / 50.0f + (i == j ? 8.0f : 0.0f);
+      }
+    }
+    vecs[k] = Vec4((float)(k % 7), (float)(k % 5), (float)(k % 3), 1.0f);
+  }
+
+  std::vector<Mat4> outMats(N);
+  std::vector<Vec4> outVecs(N);
+
+  auto bench = [&](const char* name, auto&& op)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for(int it = 0; it < ITERS; it++)
+    {
+      for(int k = 0; k < N; k++)
+      {
+        op(k);
+      }
+    }
+    double t = Seconds(start);
+    std::cout << "mat4 " << name << ": " << t / ((double)ITERS * N) * 1e9 << " ns/op" << std::endl;
+  };
+
+  bench("mul (row/column)", [&](int k){ outMats[k] = MulByRowsAndColumns(mats[k], mats[(k + 1) % N]); });
+  bench("mul", [&](int k){ outMats[k] = mats[k] * mats[(k + 1) % N]; });
+  bench("mul vec4 (rows)", [&](int k){ outVecs[k] = MulByRows(mats[k], vecs[k]); });
+  bench("mul vec4", [&](int k){ outVecs[k] = mats[k] * vecs[k]; });
+  bench("transpose", [&](int k){ outMats[k] = mats[k].Transpose(); });
+  bench("inverse", [&](int k){ outMats[k] = mats[k].Inverse(); });
+
+  //keeps the results observable
+  if(outMats[1].m_Mat[0][0] + outVecs[1].X() == 1.5f) std::cout << " ";
+}
+
+//shaders of BenchPipeline: a transform passing color on, and the same with texture coordinates
+//shaded as a checkerboard
+struct BenchVertex
+{
+  Vec3 position;
+  Vec3 color;
+};
+
+struct BenchColor
+{
+  Vec3 color;
+};
+
+struct BenchColorVS
+{
+  using Input = BenchVertex;
+  using Varyings = BenchColor;
+
+  Mat4 mvp;
+
+  Vec4 operator()(const BenchVertex& in, BenchColor& out)const
+  {
+    out.color = in.color;
+    return mvp * Vec4(in.position.X(), in.position.Y(), in.position.Z(), 1.0f);
+  }
+};
+
+struct BenchColorFS
+{
+  using Varyings = BenchColor;
+
+  Vec3 operator()(const BenchColor& in)const{ return in.color; }
+};
+
+struct BenchUV
+{
+  float u, v;
+};
+
+struct BenchCheckerVS
+{
+  using Input = BenchVertex;
+  using Varyings = BenchUV;
+
+  Mat4 mvp;
+
+  Vec4 operator()(const BenchVertex& in, BenchUV& out)const
+  {
+    out.u = in.position.X() * 0.05f;
+    out.v = in.position.Z() * 0.05f;
+    return mvp * Vec4(in.position.X(), in.position.Y(), in.position.Z(), 1.0f);
+  }
+};
+
+struct BenchCheckerFS
+{
+  using Varyings = BenchUV;
+
+  Vec3 operator()(const BenchUV& in)const
+  {
+    int c = ((int)std::floor(in.u) + (int)std::floor(in.v)) & 1;
+    return c ? Vec3(255.0f, 255.0f, 255.0f) : Vec3(40.0f, 40.0f, 40.0f);
+  }
+};
+
+//a floor grid seen in perspective, filled by the built-in per-vertex color path and by
+//pipelines whose fragment shaders are inlined into the span loop
+static void BenchPipeline()
+{
+  const int W = 1024;
+  const int H = 1024;
+  const int GRID = 64;
+  const int FRAMES = 20;
+
+  std::vector<BenchVertex> vertices;
+  VertexBuffer positions(GRID * GRID), colors(GRID * GRID);
+  for(int z = 0; z < GRID; z++)
+  {
+    for(int x = 0; x < GRID; x++)
+    {
+      BenchVertex v{Vec3((float)(x - GRID / 2) * 4.0f, -20.0f, -(float)z * 4.0f),
+        Vec3((float)(x * 4 % 256), (float)(z * 4 % 256), 128.0f)};
+      positions.Set(z * GRID + x, v.position);
+      colors.Set(z * GRID + x, v.color);
+      vertices.push_back(v);
+    }
+  }
+
+  std::vector<int> indices;
+  for(int z = 0; z + 1 < GRID; z++)
+  {
+    for(int x = 0; x + 1 < GRID; x++)
+    {
+      int i = z * GRID + x;
+      indices.insert(indices.end(), {i, i + 1, i + GRID + 1, i, i + GRID + 1, i + GRID});
+    }
+  }
+
+  constexpr Mat4 mvp = Mat4::Perspective(1.2f, 1.0f, 0.5f, 1024.0f);
+
+  Framebuffer fbo(W, H);
+  Pipeline<BenchColorVS, BenchColorFS> color;
+  color.VertexShader().mvp = mvp;
+  Pipeline<BenchCheckerVS, BenchCheckerFS> checker;
+  checker.VertexShader().mvp = mvp;
+
+  const char* names[3] = {"per-vertex color", "pipeline color", "pipeline checker"};
+  for(int k = 0; k < 3; k++)
+  {
+    fbo.ResetQuadStats();
+
+    auto start = std::chrono::steady_clock::now();
+    for(int f = 0; f < FRAMES; f++)
+    {
+      fbo.ClearFramebuffer(CP::BLACK);
+      if(k == 0) fbo.DrawIndexed(mvp, positions, colors, indices);
+      if(k == 1) color.Draw(fbo, vertices, indices);
+      if(k == 2) checker.Draw(fbo, vertices, indices);
+    }
+    double t = Seconds(start);
+    std::cout << "shaded floor " << names[k] << ": " << indices.size() / 3 << " triangles, "
+      << t / FRAMES * 1e3 << " ms/frame";
+
+    //the built-in path shades spans, not quads
+    QuadStats quads = fbo.GetQuadStats();
+    if(k > 0) std::cout << ", " << quads.quads / FRAMES << " quads/frame, " << quads.Utilization() * 100.0
+      << "% quad utilization";
+    std::cout << std::endl;
+  }
+}
+
+//a textured floor: the fragment shader takes the derivatives of its texture coordinates to
+//pick the level of detail
+struct BenchTextureFS
+{
+  using Varyings = BenchUV;
+
+  const Texture* texture;
+  Sampler sampler;
+
+  Vec3 operator()(const BenchUV& in, const BenchUV& ddx, const BenchUV& ddy)const
+  {
+    Vec4 c = texture->Sample(sampler, in.u, in.v, ddx.u, ddx.v, ddy.u, ddy.v);
+    return Vec3(c.X(), c.Y(), c.Z());
+  }
+};
+
+//samples along a rotated, minified footprint one at a time and in batches, then fills the
+//perspective floor with the texture
+static void BenchTexture()
+{
+  const int SIZE = 512;
+  const int COUNT = 1 << 16;
+  const int REPEATS = 40;
+
+  std::vector<RGBA8> texels((size_t)SIZE * SIZE);
+  for(int y = 0; y < SIZE; y++)
+  {
+    for(int x = 0; x < SIZE; x++)
+    {
+      bool check = ((x / 32) + (y / 32)) & 1;
+      texels[(size_t)y * SIZE + x] = check ? RGBA8{230, 230, 230, 255} : RGBA8{30, 60, (uint8_t)(x / 2), 255};
+    }
+  }
+  Texture texture(texels.data(), SIZE, SIZE);
+
+  std::vector<float> u(COUNT), v(COUNT), lod(COUNT), r(COUNT), g(COUNT), b(COUNT), a(COUNT);
+  for(int i = 0; i < COUNT; i++)
+  {
+    float t = (float)i / (float)COUNT;
+    u[i] = 3.0f * t * std::cos(0.6f) + 0.1f * (float)(i % 7);
+    v[i] = 3.0f * t * std::sin(0.6f) - 0.1f * (float)(i % 5);
+    lod[i] = 2.5f * t;
+  }
+
+  const Filter filters[3] = {Filter::NEAREST, Filter::BILINEAR, Filter::TRILINEAR};
+  const char* names[3] = {"nearest", "bilinear", "trilinear"};
+  for(int k = 0; k < 3; k++)
+  {
+    Sampler sampler{filters[k], Wrap::REPEAT};
+
+    auto start = std::chrono::steady_clock::now();
+    for(int rep = 0; rep < REPEATS; rep++)
+    {
+      for(int i = 0; i < COUNT; i++) r[i] = texture.Sample(sampler, u[i], v[i], lod[i]).X();
+    }
+    double scalar = Seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    for(int rep = 0; rep < REPEATS; rep++)
+    {
+      texture.Sample(sampler, u.data(), v.data(), lod.data(), COUNT, r.data(), g.data(), b.data(), a.data());
+    }
+    double batch = Seconds(start);
+
+    double samples = (double)COUNT * REPEATS / 1e6;
+    std::cout << "texture " << names[k] << ": " << samples / scalar << " Msamples/s one at a time, "
+      << samples / batch << " Msamples/s batched" << std::endl;
+  }
+
+  //keeps the results observable
+  if(r[1] + g[1] + b[1] + a[1] == -1.0f) std::cout << " ";
+
+  const int W = 1024;
+  const int H = 1024;
+  const int GRID = 64;
+  const int FRAMES = 20;
+
+  std::vector<BenchVertex> vertices;
+  for(int z = 0; z < GRID; z++)
+  {
+    for(int x = 0; x < GRID; x++)
+    {
+      vertices.push_back(BenchVertex{Vec3((float)(x - GRID / 2) * 4.0f, -20.0f, -(float)z * 4.0f), Vec3()});
+    }
+  }
+
+  std::vector<int> indices;
+  for(int z = 0; z + 1 < GRID; z++)
+  {
+    for(int x = 0; x + 1 < GRID; x++)
+    {
+      int i = z * GRID + x;
+      indices.insert(indices.end(), {i, i + 1, i + GRID + 1, i, i + GRID + 1, i + GRID});
+    }
+  }
+
+  Framebuffer fbo(W, H);
+  Pipeline<BenchCheckerVS, BenchTextureFS> floor;
+  floor.VertexShader().mvp = Mat4::Perspective(1.2f, 1.0f, 0.5f, 1024.0f);
+  floor.FragmentShader().texture = &texture;
+
+  for(int k = 0; k < 3; k++)
+  {
+    floor.FragmentShader().sampler = Sampler{filters[k], Wrap::REPEAT};
+    fbo.ResetQuadStats();
+
+    auto start = std::chrono::steady_clock::now();
+    for(int f = 0; f < FRAMES; f++)
+    {
+      fbo.ClearFramebuffer(CP::BLACK);
+      floor.Draw(fbo, vertices, indices);
+    }
+    double t = Seconds(start);
+    std::cout << "textured floor " << names[k] << ": " << t / FRAMES * 1e3 << " ms/frame, "
+      << fbo.GetQuadStats().Utilization() * 100.0 << "% quad utilization" << std::endl;
+  }
+}
+
+//renders small random shaded triangles with depth at 1, 4 and 8 samples per pixel, timing the
+//drawing and the resolve that averages the samples when the frame is read back
+static void BenchMultisample()
+{
+  const int W = 1024;
+  const int H = 1024;
+  const int TRIS = 20000;
+  const int FRAMES = 10;
+
+  std::vector<Vertex> tris;
+  std::srand(99);
+  for(int i = 0; i < TRIS; i++)
+  {
+    float cx = (float)(std::rand() % W);
+    float cy = (float)(std::rand() % H);
+    float z = (float)(std::rand() % 1000) / 1000.0f;
+    for(int k = 0; k < 3; k++)
+    {
+      Vertex v;
+      v.m_Position = Vec3(cx + (float)(std::rand() % 48 - 24), cy + (float)(std::rand() % 48 - 24), z);
+      v.m_Color = Vec3((float)(std::rand() % 256), (float)(std::rand() % 256), (float)(std::rand() % 256));
+      tris.push_back(v);
+    }
+  }
+
+  std::vector<Color> pixels((size_t)W * H);
+
+  std::cout << "multisampling: " << TRIS << " shaded triangles with depth, " << W << "x" << H << std::endl;
+
+  for(int samples : {1, 4, 8})
+  {
+    Framebuffer fbo(W, H);
+    fbo.SetDepthFormat(DepthFormat::F32);
+    fbo.SetSampleCount(samples);
+
+    double draw = 0.0, resolve = 0.0;
+    for(int f = 0; f < FRAMES; f++)
+    {
+      auto start = std::chrono::steady_clock::now();
+      fbo.ClearFramebuffer(CP::BLACK);
+      fbo.ClearDepth();
+      for(int i = 0; i < TRIS; i++)
+      {
+        fbo.PutShadedTriangle(tris[i * 3], tris[i * 3 + 1], tris[i * 3 + 2]);
+      }
+      draw += Seconds(start);
+
+      start = std::chrono::steady_clock::now();
+      fbo.ReadPixelsRGB(pixels.data());
+      resolve += Seconds(start);
+    }
+
+    std::cout << "  samples " << samples << ": " << draw / FRAMES * 1e3 << " ms/frame drawing, "
+      << resolve / FRAMES * 1e3 << " ms resolving" << std::endl;
+  }
+}
+
+int main(void)
+{
+  BenchClear();
+  BenchShadedFill<Framebuffer>("RGB8");
+  BenchShadedFill<Framebuffer>("RGB8", true);
+  BenchShadedFill<FramebufferRGBA8>("RGBA8");
+  BenchShadedFill<FramebufferRGB565>("RGB565");
+  BenchShadedFill<FramebufferRGBA32F>("RGBA32F");
+  BenchOcclusion();
+  BenchEncode();
+  BenchMatrix();
+  BenchVertexTransform();
+  BenchIndexed();
+  BenchMeshLoad();
+  BenchSceneCull();
+  BenchPipeline();
+  BenchTexture();
+  BenchMultisample();
+  BenchTileScaling();
+  return 0;
+}
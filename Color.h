@@ -72,59 +72,15 @@ struct Color
   Color(uint8_t rr, uint8_t gg, uint8_t bb) : r(rr),
                                   g(gg),
                                   b(bb)
-  {
-    if(!IS_VALID(r) || !IS_VALID(g) || !IS_VALID(b))
-    {
-      throw Invalid{};
-    }
-  }
-
-  //destructor
-  ~Color()=default;
-
-  //copy constructor and copy assignment for color
-  Color(const Color& other) : r(other.r),
-                              g(other.g),
-                              b(other.b)
   {}
 
-  Color& operator=(const Color& other)
-  {
-
-    if(this == &other) return *this;
-
-    r = other.r;
-    g = other.g;
-    b = other.b;
-    
-    return *this;
-  }
-
-  //move constructor and move assignment
-  Color(Color&& other) : r(other.r),
-                         g(other.g),
-                         b(other.b)
-  {
-    other.r = 0;
-    other.g = 0;
-    other.b = 0;
-  }
-
-  Color& operator=(Color&& other)
-  {
-
-    if(this == &other) return *this;
-    
-    r = other.r;
-    g = other.g;
-    b = other.b;
-
-    other.r = 0;
-    other.g = 0;
-    other.b = 0;
-
-    return *this;
-  }
+  //copies and moves are plain byte copies, which keeps Color trivially copyable so pixel
+  //buffers can be filled and copied with wide memory operations
+  ~Color()=default;
+  Color(const Color& other)=default;
+  Color& operator=(const Color& other)=default;
+  Color(Color&& other)=default;
+  Color& operator=(Color&& other)=default;
 
   //operator overload for indexing rgb values
   uint8_t& operator[](int index)
@@ -0,0 +1,82 @@
+#include "./FrameDelta.h"
+#include <algorithm>
+#include <cstring>
+
+static const size_t HEADER_BYTES = 24;
+
+static void PutU32LE(std::vector<uint8_t>& out, uint32_t v)
+{
+  out.push_back((uint8_t)v);
+  out.push_back((uint8_t)(v >> 8));
+  out.push_back((uint8_t)(v >> 16));
+  out.push_back((uint8_t)(v >> 24));
+}
+
+static uint32_t GetU32LE(const uint8_t* p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void PutDeltaHeader(std::vector<uint8_t>& out, int width, int height, int tileSize, uint32_t flags,
+  uint32_t tileCount)
+{
+  out.insert(out.end(), {'T', 'R', 'D', 'F'});
+  PutU32LE(out, (uint32_t)width);
+  PutU32LE(out, (uint32_t)height);
+  PutU32LE(out, (uint32_t)tileSize);
+  PutU32LE(out, flags);
+  PutU32LE(out, tileCount);
+}
+
+void DeltaDecoder::Apply(const uint8_t* data, size_t size)
+{
+  if(size < HEADER_BYTES || std::memcmp(data, "TRDF", 4) != 0) throw Invalid{};
+
+  uint32_t width = GetU32LE(data + 4);
+  uint32_t height = GetU32LE(data + 8);
+  uint32_t tileSize = GetU32LE(data + 12);
+  uint32_t flags = GetU32LE(data + 16);
+  uint32_t count = GetU32LE(data + 20);
+
+  if(width > 65536 || height > 65536 || tileSize == 0) throw Invalid{};
+
+  uint32_t tilesX = (width + tileSize - 1) / tileSize;
+  uint32_t tilesY = (height + tileSize - 1) / tileSize;
+
+  if(flags & DELTA_KEYFRAME)
+  {
+    m_iWidth = (int)width;
+    m_iHeight = (int)height;
+    m_Frame.assign((size_t)width * height, Color());
+  }
+  else if((int)width != m_iWidth || (int)height != m_iHeight || m_Frame.empty())
+  {
+    throw Invalid{};
+  }
+
+  if(count > (uint64_t)tilesX * tilesY || (size - HEADER_BYTES) / 4 < count) throw Invalid{};
+
+  const uint8_t* index = data + HEADER_BYTES;
+  const uint8_t* pixels = index + (size_t)count * 4;
+  const uint8_t* end = data + size;
+
+  for(uint32_t i = 0; i < count; i++)
+  {
+    uint32_t tile = GetU32LE(index + (size_t)i * 4);
+    if(tile >= tilesX * tilesY) throw Invalid{};
+
+    uint32_t x0 = (tile % tilesX) * tileSize;
+    uint32_t y0 = (tile / tilesX) * tileSize;
+    uint32_t w = std::min(tileSize, width - x0);
+    uint32_t h = std::min(tileSize, height - y0);
+    size_t rowBytes = (size_t)w * sizeof(Color);
+
+    if((size_t)(end - pixels) < rowBytes * h) throw Invalid{};
+
+    for(uint32_t y = y0; y < y0 + h; y++)
+    {
+      std::memcpy(static_cast<void*>(&m_Frame[(size_t)y * width + x0]), pixels, rowBytes);
+      pixels += rowBytes;
+    }
+  }
+}
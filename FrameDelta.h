@@ -0,0 +1,60 @@
+#ifndef TINYRASTER_FRAMEDELTA_H
+#define TINYRASTER_FRAMEDELTA_H
+//--------------------------------------------------------------------
+//
+//  Name: FrameDelta.h
+//
+//  Desc: Tile-delta frame files. A delta holds only the tiles that
+//  changed since the framebuffer's previous delta; a keyframe holds
+//  every tile. DeltaDecoder rebuilds full frames from a sequence
+//  that starts with a keyframe.
+//
+//  Layout (all integers little-endian u32):
+//    "TRDF" width height tileSize flags tileCount
+//    tileCount tile indices (row-major, ascending)
+//    per listed tile: its rows of packed 24-bit rgb, clipped at the
+//    right and bottom edges
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "./Color.h"
+
+//flags bit: the delta lists every tile and needs no previous frame
+constexpr uint32_t DELTA_KEYFRAME = 1;
+
+//appends the fixed header of a delta file
+void PutDeltaHeader(std::vector<uint8_t>& out, int width, int height, int tileSize, uint32_t flags,
+  uint32_t tileCount);
+
+class DeltaDecoder
+{
+
+public:
+
+  class Invalid{};
+
+  DeltaDecoder() : m_iWidth(0), m_iHeight(0) {}
+
+  //applies one delta file to the current frame. Throws Invalid if the data is malformed, or if
+  //it is not a keyframe and does not match the size of the current frame.
+  void Apply(const uint8_t* data, size_t size);
+
+  //reconstructed frame as packed 24-bit rgb rows
+  const Color* Pixels(){return m_Frame.data();}
+  int Width(){return m_iWidth;}
+  int Height(){return m_iHeight;}
+
+private:
+
+  int m_iWidth;
+  int m_iHeight;
+  std::vector<Color> m_Frame;
+
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include "./FrameWriter.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+FrameWriter::FrameWriter(int slots) : m_Slots(slots < 1 ? 1 : slots),
+                                      m_iHead(0),
+                                      m_iCount(0),
+                                      m_bStop(false),
+                                      m_bFailed(false),
+                                      m_iSubmitted(0),
+                                      m_iWritten(0),
+                                      m_iDepthSum(0),
+                                      m_iMaxDepth(0),
+                                      m_dStallSeconds(0.0),
+                                      m_dWriteSeconds(0.0),
+                                      m_dEncodeSeconds(0.0),
+                                      m_iRawBytes(0),
+                                      m_iFileBytes(0)
+{
+  m_Writer = std::thread(&FrameWriter::Run, this);
+}
+
+FrameWriter::~FrameWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bStop = true;
+  }
+  m_NotEmpty.notify_one();
+
+  m_Writer.join();
+}
+
+FrameWriter::Slot& FrameWriter::Acquire()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+
+  if(m_bFailed) throw Invalid{};
+
+  if(m_iCount == (int)m_Slots.size())
+  {
+    auto start = std::chrono::steady_clock::now();
+    m_NotFull.wait(lock, [this]{ return m_iCount < (int)m_Slots.size(); });
+    m_dStallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  //only the producer touches a free slot, so it is filled outside the lock
+  return m_Slots[(m_iHead + m_iCount) % m_Slots.size()];
+}
+
+void FrameWriter::Push()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_iCount++;
+    m_iSubmitted++;
+    m_iDepthSum += m_iCount;
+    m_iMaxDepth = std::max(m_iMaxDepth, m_iCount);
+  }
+  m_NotEmpty.notify_one();
+}
+
+void FrameWriter::Wait()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_NotFull.wait(lock, [this]{ return m_iCount == 0; });
+
+  if(m_bFailed) throw Invalid{};
+}
+
+FrameWriter::Stats FrameWriter::GetStats()
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+
+  return Stats{
+    m_iSubmitted,
+    m_iWritten,
+    m_iCount,
+    m_iMaxDepth,
+    m_iSubmitted ? (double)m_iDepthSum / (double)m_iSubmitted : 0.0,
+    m_dStallSeconds,
+    m_dWriteSeconds,
+    m_dEncodeSeconds,
+    m_iRawBytes,
+    m_iFileBytes
+  };
+}
+
+void FrameWriter::Run()
+{
+  for(;;)
+  {
+    Slot* slot;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_NotEmpty.wait(lock, [this]{ return m_iCount > 0 || m_bStop; });
+
+      //the queue is drained before stopping
+      if(m_iCount == 0) return;
+
+      slot = &m_Slots[m_iHead];
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t rawBytes = slot->pixels.size() * sizeof(Color);
+    double encodeSeconds = 0.0;
+    size_t fileBytes = 0;
+
+    std::ofstream file(slot->name, std::ios::binary);
+    bool ok = (bool)file;
+
+    if(ok && slot->delta)
+    {
+      file.write(reinterpret_cast<const char*>(slot->bytes.data()), (std::streamsize)slot->bytes.size());
+      fileBytes = slot->bytes.size();
+
+      file.close();
+      ok = (bool)file;
+    }
+    else if(ok && slot->format != ImageFormat::PPM)
+    {
+      auto encodeStart = std::chrono::steady_clock::now();
+      EncodeImage(slot->format, slot->pixels.data(), slot->width, slot->height, slot->threads, m_Encoded);
+      encodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - encodeStart).count();
+
+      file.write(reinterpret_cast<const char*>(m_Encoded.data()), (std::streamsize)m_Encoded.size());
+      fileBytes = m_Encoded.size();
+
+      file.close();
+      ok = (bool)file;
+    }
+    else if(ok)
+    {
+      //PPM Header
+      std::string header = "P6\n" + std::to_string(slot->width) + " " + std::to_string(slot->height) + "\n255\n";
+      file << header;
+
+      file.write(reinterpret_cast<const char*>(slot->pixels.data()), (std::streamsize)rawBytes);
+      fileBytes = header.size() + rawBytes;
+
+      file.close();
+      ok = (bool)file;
+    }
+
+    if(ok) std::cout << "Framebuffer successfully blitted to: " << slot->name << std::endl;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_iHead = (m_iHead + 1) % (int)m_Slots.size();
+      m_iCount--;
+      m_dWriteSeconds += seconds;
+      if(ok)
+      {
+        m_iWritten++;
+        m_iFileBytes += fileBytes;
+        if(!slot->delta && slot->format != ImageFormat::PPM)
+        {
+          m_dEncodeSeconds += encodeSeconds;
+          m_iRawBytes += rawBytes;
+        }
+      }
+      else m_bFailed = true;
+    }
+    m_NotFull.notify_all();
+  }
+}
@@ -0,0 +1,147 @@
+#ifndef TINYRASTER_FRAMEWRITER_H
+#define TINYRASTER_FRAMEWRITER_H
+//--------------------------------------------------------------------
+//
+//  Name: FrameWriter.h
+//
+//  Desc: Asynchronous frame output. Submitted frames are copied into
+//  a bounded ring of 24-bit buffers, encoded in the framebuffer's
+//  image format and written to disk by a background thread, so
+//  rendering the next frame overlaps with writing the previous one.
+//  When the ring is full Submit blocks until the writer frees a slot
+//  (back-pressure).
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./Framebuffer.h"
+
+class FrameWriter
+{
+
+public:
+
+  class Invalid{};
+
+  struct Stats
+  {
+    uint64_t submitted;   //frames handed to Submit
+    uint64_t written;     //frames written to disk
+    int depth;            //frames currently queued or being written
+    int maxDepth;         //largest depth seen right after a submit
+    double avgDepth;      //mean depth right after a submit
+    double stallSeconds;  //total time Submit waited for a free slot
+    double writeSeconds;  //total time the writer spent writing files (encoding included)
+    double encodeSeconds; //part of writeSeconds spent encoding QOI/PNG frames
+    uint64_t rawBytes;    //24-bit input of the encoded frames
+    uint64_t fileBytes;   //bytes written to disk
+
+    //encoder throughput over the uncompressed input
+    double EncodeMBps()const{ return encodeSeconds > 0.0 ? (double)rawBytes / (1024.0 * 1024.0) / encodeSeconds : 0.0; }
+  };
+
+  //slots is the ring size: 2 for double buffering, 3 for triple buffering
+  explicit FrameWriter(int slots = 3);
+
+  //writes everything still queued, then stops the writer thread
+  ~FrameWriter();
+
+  FrameWriter(const FrameWriter&)=delete;
+  FrameWriter& operator=(const FrameWriter&)=delete;
+
+  //queues the framebuffer as the next ../frame_N.<ext> (numbered and formatted like
+  //BlitFramebuffer). The pixels are converted into a free slot on the calling thread, so fbo may
+  //be reused right away; encoding happens on the writer thread.
+  template<typename P>
+  void Submit(TFramebuffer<P>& fbo)
+  {
+    Slot& slot = Acquire();
+
+    slot.width = fbo.Width();
+    slot.height = fbo.Height();
+    slot.format = fbo.GetImageFormat();
+    slot.threads = fbo.ThreadCount();
+    slot.delta = fbo.DeltaOutput();
+
+    //a delta depends on the framebuffer's previous frame, so it is built here rather than by
+    //the writer; it is usually far smaller than the full frame copy it replaces
+    if(slot.delta) fbo.EncodeDelta(slot.bytes);
+    else
+    {
+      slot.pixels.resize((size_t)slot.width * slot.height);
+      fbo.ReadPixelsRGB(slot.pixels.data());
+    }
+
+    slot.name = "../frame_" + std::to_string(FramebufferBase::m_iBlitNum++) + "." +
+      (slot.delta ? "delta" : ImageExtension(slot.format));
+
+    Push();
+  }
+
+  //blocks until every submitted frame has been written
+  void Wait();
+
+  Stats GetStats();
+
+private:
+
+  struct Slot
+  {
+    std::vector<Color> pixels;
+    int width;
+    int height;
+    ImageFormat format;
+    int threads;
+    bool delta;
+    std::vector<uint8_t> bytes;  //the encoded delta when delta is set
+    std::string name;
+  };
+
+  //waits for the slot after the last queued one to be free and returns it
+  Slot& Acquire();
+
+  //hands the slot returned by Acquire to the writer
+  void Push();
+
+  //writer thread: writes queued slots in order until stopped
+  void Run();
+
+  std::vector<Slot> m_Slots;
+
+  //queued slots are m_iHead .. m_iHead + m_iCount - 1 (mod ring size); the head stays queued
+  //while it is being written
+  int m_iHead;
+  int m_iCount;
+
+  bool m_bStop;
+  bool m_bFailed;
+
+  std::mutex m_Mutex;
+  std::condition_variable m_NotEmpty;
+  std::condition_variable m_NotFull;
+
+  uint64_t m_iSubmitted;
+  uint64_t m_iWritten;
+  uint64_t m_iDepthSum;
+  int m_iMaxDepth;
+  double m_dStallSeconds;
+  double m_dWriteSeconds;
+  double m_dEncodeSeconds;
+  uint64_t m_iRawBytes;
+  uint64_t m_iFileBytes;
+
+  //writer-thread scratch for the encoded file
+  std::vector<uint8_t> m_Encoded;
+
+  std::thread m_Writer;
+
+};
+
+#endif
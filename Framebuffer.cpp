@@ -1,4 +1,244 @@
 #include "./Framebuffer.h"
+#include <atomic>
 
-int Framebuffer::m_iBlitNum = 0;
+int FramebufferBase::m_iBlitNum = 0;
 
+template<typename P>
+void TFramebuffer<P>::Flush()
+{
+  if(m_Commands.empty()) return;
+
+  int tilesX = (m_iWidth + TILE_SIZE - 1) / TILE_SIZE;
+  int tilesY = (m_iHeight + TILE_SIZE - 1) / TILE_SIZE;
+  int tileCount = tilesX * tilesY;
+
+  //bins keep their capacity between flushes so steady-state frames don't allocate
+  if((int)m_Bins.size() != tileCount) m_Bins.assign(tileCount, {});
+  for(std::vector<int>& bin : m_Bins) bin.clear();
+
+  //sort-middle: every triangle goes into each tile its bounding box overlaps
+  int cmdCount = (int)m_Commands.size();
+  for(int i = 0; i < cmdCount; i++)
+  {
+    TriangleCmd& cmd = m_Commands[i];
+
+    //programs are shaded with their draw's copy, which no longer moves
+    if(cmd.program && cmd.copy != NO_COPY) cmd.fs = m_Programs.data() + cmd.copy;
+
+    float minX = std::fmin(cmd.x[0], std::fmin(cmd.x[1], cmd.x[2]));
+    float minY = std::fmin(cmd.y[0], std::fmin(cmd.y[1], cmd.y[2]));
+    float maxX = std::fmax(cmd.x[0], std::fmax(cmd.x[1], cmd.x[2]));
+    float maxY = std::fmax(cmd.y[0], std::fmax(cmd.y[1], cmd.y[2]));
+
+    if(maxX < 0.0f || maxY < 0.0f || minX >= (float)m_iWidth || minY >= (float)m_iHeight) continue;
+
+    int tx0 = minX < 0.0f ? 0 : (int)minX / TILE_SIZE;
+    int ty0 = minY < 0.0f ? 0 : (int)minY / TILE_SIZE;
+    int tx1 = maxX >= (float)m_iWidth ? tilesX - 1 : (int)maxX / TILE_SIZE;
+    int ty1 = maxY >= (float)m_iHeight ? tilesY - 1 : (int)maxY / TILE_SIZE;
+
+    for(int ty = ty0; ty <= ty1; ty++)
+    {
+      for(int tx = tx0; tx <= tx1; tx++)
+      {
+        m_Bins[ty * tilesX + tx].push_back(i);
+      }
+    }
+  }
+
+  //each tile is owned by exactly one worker at a time, so no locking is needed on pixels
+  std::atomic<int> nextTile(0);
+
+  auto worker = [&](int)
+  {
+    for(int t = nextTile++; t < tileCount; t = nextTile++)
+    {
+      const std::vector<int>& bin = m_Bins[t];
+      if(bin.empty()) continue;
+
+      int tx = t % tilesX;
+      int ty = t / tilesX;
+
+      TileRect clip{
+        tx * TILE_SIZE,
+        ty * TILE_SIZE,
+        std::min((tx + 1) * TILE_SIZE, m_iWidth) - 1,
+        std::min((ty + 1) * TILE_SIZE, m_iHeight) - 1
+      };
+
+      for(int index : bin)
+      {
+        const TriangleCmd& cmd = m_Commands[index];
+
+        if(cmd.shaded) ShadeTriangle(cmd, m_Varyings.data() + cmd.varyings, clip);
+        else FillTriangle(cmd.x[0], cmd.y[0], cmd.x[1], cmd.y[1], cmd.x[2], cmd.y[2], cmd.flat, clip);
+      }
+    }
+  };
+
+  int threads = std::min(m_iThreads, tileCount);
+
+  //the calling thread works too
+  RunWorkers(threads, worker);
+
+  #ifdef DEBUG
+  std::cout << "Flushed " << cmdCount << " triangles over " << tileCount << " tiles on "
+    << threads << " threads" << std::endl;
+  #endif
+
+  m_Commands.clear();
+  m_Varyings.clear();
+  m_Programs.clear();
+}
+
+template<typename P>
+void TFramebuffer<P>::CollectEdges(const std::vector<Vec2>& positions, const std::vector<int>& indices,
+  int stride)
+{
+  int count = (int)positions.size();
+  int prims = (int)indices.size() / stride;
+  int perPrim = stride == 3 ? 3 : 1;
+
+  //edges are bucketed by their lower vertex index (a counting sort), so duplicates end up in
+  //the same small bucket and the whole pass is linear in the number of edges
+  m_EdgeStart.assign(count + 1, 0);
+  m_EdgeOther.resize(prims * perPrim);
+
+  auto endpoints = [&](int p, int k, int& lo, int& hi)
+  {
+    const int* idx = &indices[p * stride];
+    int i0 = idx[k];
+    int i1 = idx[(k + 1) % stride];
+
+    if(i0 < 0 || i0 >= count || i1 < 0 || i1 >= count) throw Invalid{};
+
+    lo = std::min(i0, i1);
+    hi = std::max(i0, i1);
+  };
+
+  for(int p = 0; p < prims; p++)
+  {
+    for(int k = 0; k < perPrim; k++)
+    {
+      int lo, hi;
+      endpoints(p, k, lo, hi);
+      m_EdgeStart[lo + 1]++;
+    }
+  }
+
+  for(int v = 0; v < count; v++)
+  {
+    m_EdgeStart[v + 1] += m_EdgeStart[v];
+  }
+
+  m_EdgeFill.assign(m_EdgeStart.begin(), m_EdgeStart.end() - 1);
+  for(int p = 0; p < prims; p++)
+  {
+    for(int k = 0; k < perPrim; k++)
+    {
+      int lo, hi;
+      endpoints(p, k, lo, hi);
+      m_EdgeOther[m_EdgeFill[lo]++] = hi;
+    }
+  }
+
+  //an edge shared by two triangles shows up twice in its bucket; keep one
+  m_Edges.clear();
+  for(int v = 0; v < count; v++)
+  {
+    int* begin = m_EdgeOther.data() + m_EdgeStart[v];
+    int* end = m_EdgeOther.data() + m_EdgeStart[v + 1];
+
+    std::sort(begin, end);
+    for(int* it = begin; it != end; it++)
+    {
+      if(*it == v || (it != begin && *it == *(it - 1))) continue;
+      m_Edges.push_back(((uint64_t)v << 32) | (uint64_t)*it);
+    }
+  }
+}
+
+template<typename P>
+void TFramebuffer<P>::DrawEdges(const std::vector<Vec2>& positions, const P& col)
+{
+  if(!m_Commands.empty()) Flush();
+
+  int edgeCount = (int)m_Edges.size();
+
+  //small batches aren't worth waking threads for
+  int threads = edgeCount < 4096 ? 1 : std::min(m_iThreads, m_iHeight);
+  if(threads < 1) threads = 1;
+
+  //bands are whole tile rows so that fast-clear tiles are never resolved by two threads
+  int band = (m_iHeight + threads - 1) / threads;
+  band = (band + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+  int bands = band > 0 ? (m_iHeight + band - 1) / band : 0;
+
+  if(bands <= 1)
+  {
+    TileRect clip{0, 0, m_iWidth - 1, m_iHeight - 1};
+    for(uint64_t edge : m_Edges)
+    {
+      const Vec2& p0 = positions[(int)(edge >> 32)];
+      const Vec2& p1 = positions[(int)(edge & 0xFFFFFFFFu)];
+      DrawLine(p0.X(), p0.Y(), p1.X(), p1.Y(), col, clip);
+    }
+    return;
+  }
+
+  //every edge is binned into the bands its y-extent overlaps (a counting sort, so each band
+  //keeps the edges in order); edges entirely above or below the framebuffer are dropped
+  auto range = [&](uint64_t edge, int& b0, int& b1)
+  {
+    float y0 = positions[(int)(edge >> 32)].Y();
+    float y1 = positions[(int)(edge & 0xFFFFFFFFu)].Y();
+    float top = std::fmin(y0, y1), bottom = std::fmax(y0, y1);
+
+    if(!(top <= bottom) || bottom < 0.0f || top >= (float)m_iHeight) return false;
+
+    b0 = top < 0.0f ? 0 : (int)top / band;
+    b1 = bottom >= (float)m_iHeight ? bands - 1 : (int)bottom / band;
+    return true;
+  };
+
+  m_BandStart.assign(bands + 1, 0);
+  for(uint64_t edge : m_Edges)
+  {
+    int b0, b1;
+    if(!range(edge, b0, b1)) continue;
+    for(int b = b0; b <= b1; b++) m_BandStart[b + 1]++;
+  }
+  for(int b = 0; b < bands; b++)
+  {
+    m_BandStart[b + 1] += m_BandStart[b];
+  }
+
+  m_EdgeFill.assign(m_BandStart.begin(), m_BandStart.end() - 1);
+  m_BandEdges.resize(m_BandStart[bands]);
+  for(int i = 0; i < edgeCount; i++)
+  {
+    int b0, b1;
+    if(!range(m_Edges[i], b0, b1)) continue;
+    for(int b = b0; b <= b1; b++) m_BandEdges[m_EdgeFill[b]++] = i;
+  }
+
+  //each thread owns a band of rows and clips its lines to it, so no pixel is shared
+  RunWorkers(bands, [&](int t)
+  {
+    TileRect clip{0, t * band, m_iWidth - 1, std::min((t + 1) * band, m_iHeight) - 1};
+
+    for(int k = m_BandStart[t]; k < m_BandStart[t + 1]; k++)
+    {
+      uint64_t edge = m_Edges[m_BandEdges[k]];
+      const Vec2& p0 = positions[(int)(edge >> 32)];
+      const Vec2& p1 = positions[(int)(edge & 0xFFFFFFFFu)];
+
+      DrawLine(p0.X(), p0.Y(), p1.X(), p1.Y(), col, clip);
+    }
+  });
+}
+
+template class TFramebuffer<RGB8>;
+template class TFramebuffer<RGBA8>;
+template class TFramebuffer<RGB565>;
+template class TFramebuffer<RGBA32F>;
@@ -10,28 +10,79 @@
 //  
 //--------------------------------------------------------------------
 
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <thread>
 #include "./Color.h"
+#include "./PixelFormat.h"
 #include "./Math.h"
 #include "./Vertex.h"
+#include "./VertexBuffer.h"
+#include "./PrimitiveAssembly.h"
+#include "./Raster.h"
+#include "./ImageEncoder.h"
+#include "./FrameDelta.h"
+#include "./WorkerPool.h"
+
+//how DrawIndexed renders its triangles
+enum class DrawMode
+{
+  WIREFRAME,  //edges, each shared edge drawn once (as PutWireframeMesh)
+  FILLED      //solid triangles (as PutFilledTriangle)
+};
 
-class Framebuffer
+//state shared by framebuffers of every pixel format
+class FramebufferBase
 {
 
 public:
-  
+
   class Invalid{};
- 
+
   //index for saving in a ppm file
   static int m_iBlitNum;
 
+  //edge length (in pixels) of the screen tiles used by the multithreaded backend
+  static constexpr int TILE_SIZE = 64;
+
+  //alignment of the pixel storage, one cache line
+  static constexpr size_t PIXEL_ALIGN = 64;
+
+};
+
+//a framebuffer storing pixels of format P (RGB8, RGBA8, RGB565 or RGBA32F, see PixelFormat.h).
+//Colors are converted to P once per draw call; blits convert rows to 24-bit rgb for the ppm.
+template<typename P>
+class TFramebuffer : public FramebufferBase
+{
+
+public:
+
+  using Pixel = P;
+
   //default constructor for framebuffer
-  Framebuffer() : m_pPixels(nullptr),
-                  m_iWidth(0),
-                  m_iHeight(0)
+  TFramebuffer() : m_pPixels(nullptr),
+                   m_iWidth(0),
+                   m_iHeight(0),
+                   m_iThreads(1),
+                   m_ImageFormat(ImageFormat::PPM),
+                   m_bFastClear(false),
+                   m_bClearPending(false),
+                   m_DepthFormat(DepthFormat::NONE),
+                   m_pDepth(nullptr),
+                   m_bDeltaOutput(false),
+                   m_iSamples(1)
   {
     #ifdef DEBUG
     std::cout << "Framebuffer init via default constructor!" << std::endl;
@@ -39,12 +90,22 @@ public:
   }
 
   //default constructor with fbo size as parameters
-  Framebuffer(int width, int height) : m_pPixels(nullptr),
-                                       m_iWidth(width),
-                                       m_iHeight(height)
+  TFramebuffer(int width, int height) : m_pPixels(nullptr),
+                                        m_iWidth(width),
+                                        m_iHeight(height),
+                                        m_iThreads(1),
+                                        m_ImageFormat(ImageFormat::PPM),
+                                        m_bFastClear(false),
+                                        m_bClearPending(false),
+                                        m_DepthFormat(DepthFormat::NONE),
+                                        m_pDepth(nullptr),
+                                        m_bDeltaOutput(false),
+                                        m_iSamples(1)
   {
     //Allocate memory to framebuffer
-    m_pPixels = new Color[m_iWidth * m_iHeight];
+    m_pPixels = AllocPixels(m_iWidth * m_iHeight);
+    m_TileDirty.assign(TilesX() * TilesY(), 1);
+    m_QuadStats.assign(TilesX() * TilesY(), QuadStats{0, 0});
     
     #ifdef DEBUG
     std::cout << "Framebuffer init via default constructor: " << m_iWidth << " * "
@@ -53,9 +114,10 @@ public:
   }
 
   //destructor for framebuffer
-  ~Framebuffer()
+  ~TFramebuffer()
   {
-    delete[] m_pPixels;
+    FreePixels(m_pPixels);
+    FreeDepth();
     
     #ifdef DEBUG
     std::cout << "Framebuffer cleaned via destructor!" << std::endl;
@@ -63,17 +125,35 @@ public:
   }
   
   //copy constructor and copy assignment for framebuffer
-  Framebuffer(const Framebuffer& other) : m_pPixels(nullptr),
-                                          m_iWidth(other.m_iWidth),
-                                          m_iHeight(other.m_iHeight)
+  TFramebuffer(const TFramebuffer& other) : m_pPixels(nullptr),
+                                            m_iWidth(other.m_iWidth),
+                                            m_iHeight(other.m_iHeight),
+                                            m_iThreads(other.m_iThreads),
+                                            m_ImageFormat(other.m_ImageFormat),
+                                            m_Commands(other.m_Commands),
+                                            m_Varyings(other.m_Varyings),
+                                            m_Programs(other.m_Programs),
+                                            m_bFastClear(other.m_bFastClear),
+                                            m_bClearPending(other.m_bClearPending),
+                                            m_ClearPattern(other.m_ClearPattern),
+                                            m_TilePending(other.m_TilePending),
+                                            m_DepthFormat(other.m_DepthFormat),
+                                            m_pDepth(nullptr),
+                                            m_HiZ(other.m_HiZ),
+                                            m_TileDirty(other.m_TileDirty),
+                                            m_bDeltaOutput(other.m_bDeltaOutput),
+                                            m_PrevFrame(other.m_PrevFrame),
+                                            m_Assembler(other.m_Assembler),
+                                            m_QuadStats(other.m_QuadStats),
+                                            m_iSamples(other.m_iSamples),
+                                            m_SampleIndex(other.m_SampleIndex),
+                                            m_SamplePools(other.m_SamplePools)
   {
-    m_pPixels = new Color[m_iWidth * m_iHeight];
-    
-    int res = m_iWidth * m_iHeight;
-    for(int i = 0; i < res; i++)
-    {
-      m_pPixels[i] = other.m_pPixels[i];
-    }
+    m_pPixels = AllocPixels(m_iWidth * m_iHeight);
+    if(m_pPixels) std::memcpy(m_pPixels, other.m_pPixels, (size_t)m_iWidth * m_iHeight * sizeof(P));
+
+    AllocDepth();
+    if(m_pDepth) std::memcpy(m_pDepth, other.m_pDepth, DepthBytes());
     
     #ifdef DEBUG
     std::cout << "Framebuffer init via copy constructor: " << m_iWidth << " * " 
@@ -81,24 +161,42 @@ public:
     #endif
   }
 
-  Framebuffer& operator=(const Framebuffer& other)
+  TFramebuffer& operator=(const TFramebuffer& other)
   {
     
     if(this == &other) return *this;
     
-    delete[] m_pPixels;
+    FreePixels(m_pPixels);
     m_pPixels = nullptr;
+    FreeDepth();
 
     m_iWidth = other.m_iWidth;
     m_iHeight = other.m_iHeight;
-
-    m_pPixels = new Color[m_iWidth * m_iHeight];
-    
-    int res = m_iWidth * m_iHeight;
-    for(int i = 0; i < res; i++)
-    {
-      m_pPixels[i] = other.m_pPixels[i];
-    }
+    m_iThreads = other.m_iThreads;
+    m_ImageFormat = other.m_ImageFormat;
+    m_Commands = other.m_Commands;
+    m_Varyings = other.m_Varyings;
+    m_Programs = other.m_Programs;
+    m_bFastClear = other.m_bFastClear;
+    m_bClearPending = other.m_bClearPending;
+    m_ClearPattern = other.m_ClearPattern;
+    m_TilePending = other.m_TilePending;
+    m_DepthFormat = other.m_DepthFormat;
+    m_HiZ = other.m_HiZ;
+    m_TileDirty = other.m_TileDirty;
+    m_bDeltaOutput = other.m_bDeltaOutput;
+    m_PrevFrame = other.m_PrevFrame;
+    m_Assembler = other.m_Assembler;
+    m_QuadStats = other.m_QuadStats;
+    m_iSamples = other.m_iSamples;
+    m_SampleIndex = other.m_SampleIndex;
+    m_SamplePools = other.m_SamplePools;
+
+    m_pPixels = AllocPixels(m_iWidth * m_iHeight);
+    if(m_pPixels) std::memcpy(m_pPixels, other.m_pPixels, (size_t)m_iWidth * m_iHeight * sizeof(P));
+
+    AllocDepth();
+    if(m_pDepth) std::memcpy(m_pDepth, other.m_pDepth, DepthBytes());
     
     #ifdef DEBUG
     std::cout << "Framebuffer init via copy assignment overload: " << m_iWidth << " * "
@@ -109,11 +207,35 @@ public:
   }
   
   //move assignment and move constructor for framebuffer
-  Framebuffer(Framebuffer&& other) : m_pPixels(other.m_pPixels),
-                                     m_iWidth(other.m_iWidth),
-                                     m_iHeight(other.m_iHeight)
+  TFramebuffer(TFramebuffer&& other) : m_pPixels(other.m_pPixels),
+                                       m_iWidth(other.m_iWidth),
+                                       m_iHeight(other.m_iHeight),
+                                       m_iThreads(other.m_iThreads),
+                                       m_ImageFormat(other.m_ImageFormat),
+                                       m_Commands(std::move(other.m_Commands)),
+                                       m_Varyings(std::move(other.m_Varyings)),
+                                       m_Programs(std::move(other.m_Programs)),
+                                       m_pWorkers(std::move(other.m_pWorkers)),
+                                       m_bFastClear(other.m_bFastClear),
+                                       m_bClearPending(other.m_bClearPending),
+                                       m_ClearPattern(other.m_ClearPattern),
+                                       m_TilePending(std::move(other.m_TilePending)),
+                                       m_DepthFormat(other.m_DepthFormat),
+                                       m_pDepth(other.m_pDepth),
+                                       m_HiZ(std::move(other.m_HiZ)),
+                                       m_TileDirty(std::move(other.m_TileDirty)),
+                                       m_bDeltaOutput(other.m_bDeltaOutput),
+                                       m_PrevFrame(std::move(other.m_PrevFrame)),
+                                       m_Assembler(std::move(other.m_Assembler)),
+                                       m_QuadStats(std::move(other.m_QuadStats)),
+                                       m_iSamples(other.m_iSamples),
+                                       m_SampleIndex(std::move(other.m_SampleIndex)),
+                                       m_SamplePools(std::move(other.m_SamplePools))
   {
     other.m_pPixels = nullptr;
+    other.m_pDepth = nullptr;
+    other.m_DepthFormat = DepthFormat::NONE;
+    other.m_iSamples = 1;
     other.m_iWidth = 0;
     other.m_iHeight = 0;
     
@@ -123,19 +245,44 @@ public:
     #endif  
   }
   
-  Framebuffer& operator=(Framebuffer&& other)
+  TFramebuffer& operator=(TFramebuffer&& other)
   {
     
     if(this == &other) return *this;
 
-    delete[] m_pPixels;
+    FreePixels(m_pPixels);
     m_pPixels = nullptr;
+    FreeDepth();
 
     m_iWidth = other.m_iWidth;
     m_iHeight = other.m_iHeight;
     m_pPixels = other.m_pPixels;
+    m_iThreads = other.m_iThreads;
+    m_ImageFormat = other.m_ImageFormat;
+    m_Commands = std::move(other.m_Commands);
+    m_Varyings = std::move(other.m_Varyings);
+    m_Programs = std::move(other.m_Programs);
+    m_pWorkers = std::move(other.m_pWorkers);
+    m_bFastClear = other.m_bFastClear;
+    m_bClearPending = other.m_bClearPending;
+    m_ClearPattern = other.m_ClearPattern;
+    m_TilePending = std::move(other.m_TilePending);
+    m_DepthFormat = other.m_DepthFormat;
+    m_pDepth = other.m_pDepth;
+    m_HiZ = std::move(other.m_HiZ);
+    m_TileDirty = std::move(other.m_TileDirty);
+    m_bDeltaOutput = other.m_bDeltaOutput;
+    m_PrevFrame = std::move(other.m_PrevFrame);
+    m_Assembler = std::move(other.m_Assembler);
+    m_QuadStats = std::move(other.m_QuadStats);
+    m_iSamples = other.m_iSamples;
+    m_SampleIndex = std::move(other.m_SampleIndex);
+    m_SamplePools = std::move(other.m_SamplePools);
 
     other.m_pPixels = nullptr;
+    other.m_pDepth = nullptr;
+    other.m_DepthFormat = DepthFormat::NONE;
+    other.m_iSamples = 1;
     other.m_iWidth = 0;
     other.m_iHeight = 0;
 
@@ -148,21 +295,213 @@ public:
   }
   
   //operator overload for accessing pixel value
-  Color& operator[](int index)
+  P& operator[](int index)
   {
+    if(!m_Commands.empty()) Flush();
+
     if(index < 0 || index >= m_iWidth * m_iHeight)
     {
       throw Invalid{};
     }
 
+    ResolveTiles(index % m_iWidth, index / m_iWidth, index % m_iWidth, index / m_iWidth);
+    MarkDirty(index % m_iWidth, index / m_iWidth, index % m_iWidth, index / m_iWidth);
+
+    //the pixel may be written through the reference, so its samples become its average
+    if(m_iSamples > 1 && m_SampleIndex[index] >= 0)
+    {
+      ResolvePixel(index);
+      Collapse(index);
+    }
+
     return m_pPixels[index];
   }
   
   //getters
-  Color* Data(){return m_pPixels;}
+  P* Data(){ if(!m_Commands.empty()) Flush(); ResolveAll(); ResolveSamples(true); MarkAllDirty(); return m_pPixels;}
   int GetRes(){return m_iWidth * m_iHeight;}
   int Width(){return m_iWidth;}
   int Height(){return m_iHeight;}
+  int ThreadCount(){return m_iThreads;}
+  ImageFormat GetImageFormat(){return m_ImageFormat;}
+  bool FastClear(){return m_bFastClear;}
+
+  //with fast clear on, ClearFramebuffer only marks every tile as cleared; a tile receives the
+  //clear color when something is first drawn into it or when the framebuffer is read or blitted
+  void SetFastClear(bool enable)
+  {
+    if(!enable) ResolveAll();
+    m_bFastClear = enable;
+  }
+
+  //sets the number of worker threads used for triangles. With more than one thread, filled and
+  //shaded triangles are recorded and rasterized tile-by-tile on Flush() (called implicitly by
+  //any other drawing, read-back or blit). 0 picks the hardware concurrency.
+  void SetThreadCount(int threads)
+  {
+    if(!m_Commands.empty()) Flush();
+
+    if(threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    m_iThreads = threads < 1 ? 1 : threads;
+  }
+
+  //selects the file format written by BlitFramebuffer (and FrameWriter). QOI and PNG are
+  //encoded in ThreadCount() strips in parallel; PPM is written as-is.
+  void SetImageFormat(ImageFormat format){m_ImageFormat = format;}
+
+  //with delta output on, BlitFramebuffer (and FrameWriter) write ../frame_N.delta files holding
+  //only the tiles that changed since the previous blit instead of full images; the first blit
+  //after enabling is a keyframe. DeltaDecoder or tr_undelta rebuilds the full frames.
+  void SetDeltaOutput(bool enable)
+  {
+    if(enable && !m_bDeltaOutput) m_PrevFrame.clear();
+    m_bDeltaOutput = enable;
+  }
+
+  bool DeltaOutput(){return m_bDeltaOutput;}
+
+  //whether anything was drawn into tile (tx, ty) (TILE_SIZE pixels square) since the last delta
+  bool TileDirty(int tx, int ty)
+  {
+    if(!m_Commands.empty()) Flush();
+
+    if(tx < 0 || tx >= TilesX() || ty < 0 || ty >= TilesY()) throw Invalid{};
+    return m_TileDirty[ty * TilesX() + tx] != 0;
+  }
+
+  //encodes the tiles that differ from the previous delta into out (see FrameDelta.h) and makes
+  //the current contents the new reference. Only dirty tiles are compared; clean ones are known
+  //to be unchanged.
+  void EncodeDelta(std::vector<uint8_t>& out)
+  {
+    if(!m_Commands.empty()) Flush();
+    ResolveAll();
+    ResolveSamples();
+
+    bool key = m_PrevFrame.size() != (size_t)m_iWidth * m_iHeight;
+    if(key) m_PrevFrame.resize((size_t)m_iWidth * m_iHeight);
+
+    int tilesX = TilesX();
+    std::vector<uint32_t> changed;
+    std::vector<Color> row(TILE_SIZE);
+
+    for(int t = 0; t < tilesX * TilesY(); t++)
+    {
+      if(!key && !m_TileDirty[t]) continue;
+
+      int x0 = (t % tilesX) * TILE_SIZE;
+      int y0 = (t / tilesX) * TILE_SIZE;
+      int w = std::min(TILE_SIZE, m_iWidth - x0);
+      int yEnd = std::min(y0 + TILE_SIZE, m_iHeight);
+      bool differs = key;
+
+      for(int y = y0; y < yEnd; y++)
+      {
+        Color* prev = &m_PrevFrame[(size_t)y * m_iWidth + x0];
+        ConvertToRGB(m_pPixels + (size_t)y * m_iWidth + x0, w, row.data());
+
+        if(differs || std::memcmp(static_cast<const void*>(prev), row.data(), w * sizeof(Color)) != 0)
+        {
+          std::memcpy(static_cast<void*>(prev), row.data(), w * sizeof(Color));
+          differs = true;
+        }
+      }
+
+      if(differs) changed.push_back((uint32_t)t);
+    }
+
+    std::fill(m_TileDirty.begin(), m_TileDirty.end(), 0);
+
+    out.clear();
+    PutDeltaHeader(out, m_iWidth, m_iHeight, TILE_SIZE, key ? DELTA_KEYFRAME : 0, (uint32_t)changed.size());
+    for(uint32_t t : changed)
+    {
+      uint8_t b[4] = {(uint8_t)t, (uint8_t)(t >> 8), (uint8_t)(t >> 16), (uint8_t)(t >> 24)};
+      out.insert(out.end(), b, b + 4);
+    }
+
+    for(uint32_t t : changed)
+    {
+      int x0 = (int)(t % tilesX) * TILE_SIZE;
+      int y0 = (int)(t / tilesX) * TILE_SIZE;
+      int w = std::min(TILE_SIZE, m_iWidth - x0);
+      int yEnd = std::min(y0 + TILE_SIZE, m_iHeight);
+
+      for(int y = y0; y < yEnd; y++)
+      {
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(&m_PrevFrame[(size_t)y * m_iWidth + x0]);
+        out.insert(out.end(), src, src + w * sizeof(Color));
+      }
+    }
+  }
+
+  //bins all recorded triangles into TILE_SIZE tiles and rasterizes the tiles in parallel
+  void Flush();
+
+  //attaches a depth buffer cleared to 1, or removes it with DepthFormat::NONE. Shaded triangles
+  //are then depth tested (LESS) and written using their vertices' m_Position.Z(); filled
+  //triangles, lines and pixels ignore depth.
+  void SetDepthFormat(DepthFormat format)
+  {
+    if(!m_Commands.empty()) Flush();
+
+    FreeDepth();
+    m_DepthFormat = format;
+    AllocDepth();
+    ClearDepth();
+  }
+
+  DepthFormat GetDepthFormat(){return m_DepthFormat;}
+
+  //sets every depth value, and the depth bounds of every tile, to depth
+  void ClearDepth(float depth = 1.0f)
+  {
+    if(!m_Commands.empty()) Flush();
+
+    if(m_DepthFormat == DepthFormat::F32) ClearDepthAs<float>(depth);
+    else if(m_DepthFormat == DepthFormat::UNORM16) ClearDepthAs<uint16_t>(depth);
+    
+    #ifdef DEBUG
+    std::cout << "Depth buffer cleared to: " << depth << std::endl;
+    #endif
+  }
+
+  //depth stored at (x, y) (its first sample when multisampled) in [0, 1] for UNORM16, 1 without a
+  //depth buffer
+  float GetDepth(int x, int y)
+  {
+    if(!m_Commands.empty()) Flush();
+
+    if(x < 0 || x >= m_iWidth || y < 0 || y >= m_iHeight) throw Invalid{};
+
+    if(m_DepthFormat == DepthFormat::F32) return DepthTraits<float>::Decode(DepthRow<float>(y)[x * m_iSamples]);
+    if(m_DepthFormat == DepthFormat::UNORM16) return DepthTraits<uint16_t>::Decode(DepthRow<uint16_t>(y)[x * m_iSamples]);
+    return 1.0f;
+  }
+
+  //sets the samples per pixel: 1 (off), 4 or 8; anything else throws Invalid. With several
+  //samples, triangles are covered and depth tested per sample (at the standard D3D positions)
+  //but shaded once per pixel, at its centre, and the color is stored to the samples covered. A
+  //pixel whose samples agree keeps a single color; only pixels on edges store every sample.
+  //Reads and blits see the samples averaged (resolved). Lines and pixels write whole pixels.
+  //The depth buffer, which holds every sample, is reallocated and cleared to 1.
+  void SetSampleCount(int samples)
+  {
+    if(samples != 1 && samples != 4 && samples != 8) throw Invalid{};
+    if(!m_Commands.empty()) Flush();
+
+    //the current contents are kept as single-color pixels
+    ResolveSamples();
+
+    m_iSamples = samples;
+    AllocSamples();
+
+    FreeDepth();
+    AllocDepth();
+    ClearDepth();
+  }
+
+  int GetSampleCount(){return m_iSamples;}
 
   //method for allocating memory to the framebuffer if not already
   void MemAlloc(int width, int height)
@@ -171,7 +510,17 @@ public:
     
     m_iWidth = width;
     m_iHeight = height;
-    m_pPixels = new Color[m_iWidth * m_iHeight];
+    m_pPixels = AllocPixels(m_iWidth * m_iHeight);
+    m_TileDirty.assign(TilesX() * TilesY(), 1);
+    m_QuadStats.assign(TilesX() * TilesY(), QuadStats{0, 0});
+    AllocSamples();
+
+    if(m_DepthFormat != DepthFormat::NONE)
+    {
+      FreeDepth();
+      AllocDepth();
+      ClearDepth();
+    }
     
     #ifdef DEBUG
     std::cout << "Memory allocated to the framebuffer: " << m_iWidth << " * "
@@ -182,11 +531,7 @@ public:
   //methods for clearing the framebuffer using a color preset or explicit rgb value
   void ClearFramebuffer(CP color)
   {
-    int res = m_iWidth * m_iHeight;
-    for(int i = 0; i < res; i++)
-    {
-      m_pPixels[i].SetColor(color);
-    }
+    Clear(Pack(color));
     
     #ifdef DEBUG
     std::cout << "Framebuffer cleared to color: " << GetColorName(color) << std::endl;
@@ -200,12 +545,8 @@ public:
     {
       throw Invalid{};
     }
-    
-    int res = m_iWidth * m_iHeight;
-    for(int i = 0; i < res; i++)
-    {
-      m_pPixels[i].SetColor(r, g, b);
-    }
+
+    Clear(Pack(r, g, b));
     
     #ifdef DEBUG
     std::cout << "Framebuffer cleared to color: RGB(" << r << ", " << g << ", " << b << ")"
@@ -215,10 +556,16 @@ public:
   
   void PutPixel(int x, int y, CP color)
   {
+    if(!m_Commands.empty()) Flush();
+
     if(x < 0 || x >= m_iWidth || y < 0 || y >= m_iHeight) return;
 
+    ResolveTiles(x, y, x, y);
+    MarkDirty(x, y, x, y);
+
     int index = y * m_iWidth + x;
-    m_pPixels[index].SetColor(color);
+    m_pPixels[index] = Pack(color);
+    Collapse(index);
     
     #ifdef DEBUG
     std::cout << "Pixel put into framebuffer at: (" << x << ", " << y << ")" << std::endl;
@@ -227,10 +574,16 @@ public:
 
   void PutPixel(const Vec2& v, CP color)
   {
+    if(!m_Commands.empty()) Flush();
+
     if(v.iX() < 0 || v.iX() >= m_iWidth || v.iY() < 0 || v.iY() >= m_iHeight) return;
 
+    ResolveTiles(v.iX(), v.iY(), v.iX(), v.iY());
+    MarkDirty(v.iX(), v.iY(), v.iX(), v.iY());
+
     int index = v.iY() * m_iWidth + v.iX();
-    m_pPixels[index].SetColor(color);
+    m_pPixels[index] = Pack(color);
+    Collapse(index);
     
     #ifdef DEBUG
     std::cout << "Pixel put into framebuffer at: (" << v.iX() << ", " << v.iY() << ")" << std::endl;
@@ -239,10 +592,16 @@ public:
 
   void PutPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b)
   {
+    if(!m_Commands.empty()) Flush();
+
     if(x < 0 || x >= m_iWidth || y < 0 || y >= m_iHeight) return;
 
+    ResolveTiles(x, y, x, y);
+    MarkDirty(x, y, x, y);
+
     int index = y * m_iWidth + x;
-    m_pPixels[index].SetColor(r, g, b);
+    m_pPixels[index] = Pack(r, g, b);
+    Collapse(index);
     
     #ifdef DEBUG
     std::cout << "Pixel put into framebuffer at: (" << x << ", " << y << ")" << std::endl;
@@ -251,10 +610,16 @@ public:
  
   void PutPixel(const Vec2& v, uint8_t r, uint8_t g, uint8_t b)
   {
+    if(!m_Commands.empty()) Flush();
+
     if(v.iX() < 0 || v.iX() >= m_iWidth || v.iY() < 0 || v.iY() >= m_iHeight) return;
 
+    ResolveTiles(v.iX(), v.iY(), v.iX(), v.iY());
+    MarkDirty(v.iX(), v.iY(), v.iX(), v.iY());
+
     int index = v.iY() * m_iWidth + v.iX();
-    m_pPixels[index].SetColor(r, g, b);
+    m_pPixels[index] = Pack(r, g, b);
+    Collapse(index);
     
     #ifdef DEBUG
     std::cout << "Pixel put into framebuffer at: (" << v.iX() << ", " << v.iY() << ")" << std::endl;
@@ -273,53 +638,7 @@ public:
   
   void PutLine(float x0, float y0, float x1, float y1, CP color)
   {
-    
-    if(std::fabs(x1 - x0) > std::abs(y1 - y0))
-    {
-      //line is horizontal-ish
-      //making sure x0 < x1
-      if(x0 > x1)
-      {
-        float tmp = x0;
-        x0 = x1;
-        x1 = tmp;
-
-        tmp = y0;
-        y0 = y1;
-        y1 = tmp;
-
-      }
-
-      std::vector<float> ys = Interpolate(x0, y0, x1, y1);
-
-      for(int x = (int)x0; x < (int)x1; x++)
-      {
-        PutPixel(x, (int)ys[(int)(x - x0)], color);
-      }
-    }
-    else
-    {
-      //line is vertical-ish
-      //making sure y0 < y1
-      if(y0 > y1)
-      {
-        float tmp = x0;
-        x0 = x1;
-        x1 = tmp;
-
-        tmp = y0;
-        y0 = y1;
-        y1 = tmp;
-
-      }
-
-      std::vector<float> xs = Interpolate(y0, x0, y1, x1);
-
-      for(int y = (int)y0; y < (int)y1; y++)
-      {
-        PutPixel((int)xs[(int)(y - y0)], (int)y, color);
-      }
-    }
+    DrawLine(x0, y0, x1, y1, Pack(color));
     
     #ifdef DEBUG
     std::cout << "Rendered a line: (" << x0 << ", " << y0 << ") -> (" << x1 << ", " << y1 << ")"
@@ -332,52 +651,9 @@ public:
     PutLine(p0.X(), p0.Y(), p1.X(), p1.Y(), color); 
   }
 
-  void PutLine(int x0, int y0, int x1, int y1, uint8_t r, uint8_t g, uint8_t b)
+  void PutLine(float x0, float y0, float x1, float y1, uint8_t r, uint8_t g, uint8_t b)
   {
-       if(std::fabs(x1 - x0) > std::fabs(y1 - y0))
-    {
-      //line is horizontal-ish
-      //making sure x0 < x1
-      if(x0 > x1)
-      {
-        float tmp = x0;
-        x0 = x1;
-        x1 = tmp;
-
-        tmp = y0;
-        y0 = y1;
-        y1 = tmp;
-      }
-
-      std::vector<float> ys = Interpolate(x0, y0, x1, y1);
-
-      for(int x = (int)x0; x < (int)x1; x++)
-      {
-        PutPixel(x, (int)ys[(int)(x - x0)], r, g, b);
-      }
-    }
-    else
-    {
-      //line is vertical-ish
-      //making sure y0 < y1
-      if(y0 > y1)
-      {
-       float tmp = x0;
-        x0 = x1;
-        x1 = tmp;
-
-        tmp = y0;
-        y0 = y1;
-        y1 = tmp;
-      }
-
-      std::vector<float> xs = Interpolate(y0, x0, y1, x1);
-
-      for(int y = (int)y0; y < (int)y1; y++)
-      {
-        PutPixel((int)xs[(int)(y - y0)], (int)y, r, g, b);
-      }
-    }
+    DrawLine(x0, y0, x1, y1, Pack(r, g, b));
 
     #ifdef DEBUG
     std::cout << "Rendered a line: " << Vec2(x0, y0) << " -> " << Vec2(x1, y1) << std::endl;
@@ -443,71 +719,228 @@ public:
     PutWireframeTriangle(x0, y0, x1, y1, x2, y2, c.X(), c.Y(), c.Z());
   }
   
-  void PutFilledTriangle(float x0, float y0, float x1, float y1, float x2, float y2, CP color)
+  //draws every edge of an indexed triangle list (three indices into positions per triangle),
+  //rasterizing edges shared between triangles only once
+  void PutWireframeMesh(const std::vector<Vec2>& positions, const std::vector<int>& indices, CP color)
   {
-    if(y1 < y0)
-    {
-      float tmp = x0;
-      x0 = x1;
-      x1 = tmp;
+    CollectEdges(positions, indices, 3);
+    DrawEdges(positions, Pack(color));
 
-      tmp = y0;
-      y0 = y1;
-      y1 = tmp;
-    }
+    #ifdef DEBUG
+    std::cout << "Rendered a wireframe-mesh: " << indices.size() / 3 << " triangles, "
+      << m_Edges.size() << " unique edges" << std::endl;
+    #endif
+  }
 
-    if(y2 < y0)
-    {
-      float tmp = y0;
-      y0 = y2;
-      y2 = tmp;
+  void PutWireframeMesh(const std::vector<Vec2>& positions, const std::vector<int>& indices,
+    uint8_t r, uint8_t g, uint8_t b)
+  {
+    CollectEdges(positions, indices, 3);
+    DrawEdges(positions, Pack(r, g, b));
 
-      tmp = x0;
-      x0 = x2;
-      x2 = tmp;
-    }
+    #ifdef DEBUG
+    std::cout << "Rendered a wireframe-mesh: " << indices.size() / 3 << " triangles, "
+      << m_Edges.size() << " unique edges" << std::endl;
+    #endif
+  }
 
-    if(y2 < y1)
-    {
-      float tmp = y1;
-      y1 = y2;
-      y2 = tmp;
+  //draws an indexed line list (two indices into positions per line), skipping repeated lines
+  void PutLineList(const std::vector<Vec2>& positions, const std::vector<int>& indices, CP color)
+  {
+    CollectEdges(positions, indices, 2);
+    DrawEdges(positions, Pack(color));
 
-      tmp = x1;
-      x1 = x2;
-      x2 = tmp;
-    }
+    #ifdef DEBUG
+    std::cout << "Rendered a line-list: " << m_Edges.size() << " unique lines" << std::endl;
+    #endif
+  }
 
-    std::vector<float> x01 = Interpolate(y0, x0, y1, x1);
-    std::vector<float> x12 = Interpolate(y1, x1, y2, x2);
-    std::vector<float> x02 = Interpolate(y0, x0, y2, x2);
-    
-    x01.pop_back();
-    x01.insert(x01.end(), x12.begin(), x12.end());
-    std::vector<float> x012 = x01;
+  void PutLineList(const std::vector<Vec2>& positions, const std::vector<int>& indices,
+    uint8_t r, uint8_t g, uint8_t b)
+  {
+    CollectEdges(positions, indices, 2);
+    DrawEdges(positions, Pack(r, g, b));
 
-    std::vector<float> x_left;
-    std::vector<float> x_right;
-    int m = std::floor(x012.size()/2);
-    if(x02[m] < x012[m])
-    {
-      x_left = x02;
-      x_right = x012;
-    }
-    else
+    #ifdef DEBUG
+    std::cout << "Rendered a line-list: " << m_Edges.size() << " unique lines" << std::endl;
+    #endif
+  }
+  
+  //draws an indexed triangle list (three indices into vertices per triangle) straight from
+  //model-space positions: mvp takes them to clip space and the viewport is the whole
+  //framebuffer. Each vertex runs through the vertex stage once however many triangles share
+  //it, and stays cached for further draws of the same buffer with the same matrix; triangles
+  //are then assembled from the indices, culled and clipped (see PrimitiveAssembly.h).
+  void DrawIndexed(const Mat4& mvp, const VertexBuffer& vertices, const std::vector<int>& indices, CP color,
+    DrawMode mode = DrawMode::WIREFRAME)
+  {
+    DrawIndexed(mvp, vertices, indices.data(), indices.size(), Pack(color), mode);
+  }
+
+  void DrawIndexed(const Mat4& mvp, const VertexBuffer& vertices, const std::vector<int>& indices,
+    uint8_t r, uint8_t g, uint8_t b, DrawMode mode = DrawMode::WIREFRAME)
+  {
+    DrawIndexed(mvp, vertices, indices.data(), indices.size(), Pack(r, g, b), mode);
+  }
+
+  //the same over indexCount indices held elsewhere, e.g. a memory-mapped Mesh
+  void DrawIndexed(const Mat4& mvp, const VertexBuffer& vertices, const int* indices, size_t indexCount,
+    CP color, DrawMode mode = DrawMode::WIREFRAME)
+  {
+    DrawIndexed(mvp, vertices, indices, indexCount, Pack(color), mode);
+  }
+
+  void DrawIndexed(const Mat4& mvp, const VertexBuffer& vertices, const int* indices, size_t indexCount,
+    uint8_t r, uint8_t g, uint8_t b, DrawMode mode = DrawMode::WIREFRAME)
+  {
+    DrawIndexed(mvp, vertices, indices, indexCount, Pack(r, g, b), mode);
+  }
+
+  //draws an indexed triangle list filled with per-vertex colors: colors holds r, g, b in
+  //[0, 255] in its x, y, z streams (as Mesh::Colors() does), one per vertex. They are
+  //interpolated perspective-correctly, across the vertices the clipper creates too, and depth
+  //tested when a depth attachment is set. Throws Invalid if colors has fewer vertices.
+  void DrawIndexed(const Mat4& mvp, const VertexBuffer& vertices, const VertexBuffer& colors,
+    const std::vector<int>& indices)
+  {
+    DrawIndexed(mvp, vertices, colors, indices.data(), indices.size());
+  }
+
+  void DrawIndexed(const Mat4& mvp, const VertexBuffer& vertices, const VertexBuffer& colors,
+    const int* indices, size_t indexCount)
+  {
+    if(colors.Size() < vertices.Size()) throw Invalid{};
+
+    const float* r = colors.X();
+    const float* g = colors.Y();
+    const float* b = colors.Z();
+
+    AssembleShaded<3>(mvp, vertices, indices, indexCount,
+      [&](int i, float* out){ out[0] = r[i]; out[1] = g[i]; out[2] = b[i]; },
+      [&](const float* v0, const float* v1, const float* v2){ PutShadedTriangle(v0, v1, v2, 3); });
+
+    #ifdef DEBUG
+    std::cout << "Rendered a shaded indexed mesh: " << indexCount / 3 << " triangles, "
+      << m_Assembler.Indices().size() / 3 << " after culling and clipping" << std::endl;
+    #endif
+  }
+
+  //draws an indexed triangle list whose vertices are already in clip space, each with N varyings
+  //(vertex i's at varyings[i * N]), shading every pixel with fs: fs(const float* varyings) gets
+  //the pixel's perspective-correct varyings and returns its r, g, b in [0, 255];
+  //fs(varyings, ddx, ddy) gets their screen-space derivatives too, taken across the pixel's 2x2
+  //quad. fs's type is a template parameter, so it is inlined into the quad loop. Quads shaded are
+  //counted in GetQuadStats. This is the rasterizer side of Pipeline (Pipeline.h). With several
+  //threads the triangles are recorded with a copy of fs taken here and shaded at the next Flush;
+  //an fs that can't be copied bytewise is flushed before the draw returns.
+  template<int N, typename F>
+  void DrawProgram(const VertexBuffer& clip, const float* varyings, const int* indices, size_t indexCount,
+    const F& fs)
+  {
+    static_assert(N > 0 && N <= MAX_VARYINGS, "a program carries 1 to MAX_VARYINGS varyings");
+
+    constexpr bool Copyable = std::is_trivially_copyable<F>::value &&
+      alignof(F) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    //offset of this draw's copy of fs in m_Programs, taken with its first recorded triangle
+    uint32_t copy = NO_COPY;
+
+    AssembleShaded<N>(Mat4(), clip, indices, indexCount,
+      [&](int i, float* out){ std::memcpy(out, varyings + (size_t)i * N, N * sizeof(float)); },
+      [&](const float* v0, const float* v1, const float* v2)
+      {
+        TriangleCmd cmd{
+          {v0[0], v1[0], v2[0]},
+          {v0[1], v1[1], v2[1]},
+          {v0[2], v1[2], v2[2]},
+          {v0[3], v1[3], v2[3]},
+          0,
+          N,
+          P{},
+          true,
+          &ShadeProgram<N, F>,
+          &fs,
+          NO_COPY
+        };
+
+        if(m_iThreads > 1)
+        {
+          if(Copyable && copy == NO_COPY)
+          {
+            copy = (uint32_t)((m_Programs.size() + alignof(F) - 1) / alignof(F) * alignof(F));
+            m_Programs.resize(copy + sizeof(F));
+            std::memcpy(m_Programs.data() + copy, static_cast<const void*>(&fs), sizeof(F));
+          }
+          cmd.copy = copy;
+
+          cmd.varyings = (uint32_t)m_Varyings.size();
+          m_Varyings.insert(m_Varyings.end(), v0 + 4, v0 + 4 + N);
+          m_Varyings.insert(m_Varyings.end(), v1 + 4, v1 + 4 + N);
+          m_Varyings.insert(m_Varyings.end(), v2 + 4, v2 + 4 + N);
+          m_Commands.push_back(cmd);
+          return;
+        }
+
+        float packed[3 * N];
+        std::copy(v0 + 4, v0 + 4 + N, packed);
+        std::copy(v1 + 4, v1 + 4 + N, packed + N);
+        std::copy(v2 + 4, v2 + 4 + N, packed + 2 * N);
+
+        ShadeTriangle(cmd, packed, FullRect());
+      });
+
+    //the recorded commands point at fs itself
+    if(!Copyable && !m_Commands.empty()) Flush();
+
+    #ifdef DEBUG
+    std::cout << "Rendered a program mesh: " << indexCount / 3 << " triangles, "
+      << m_Assembler.Indices().size() / 3 << " after culling and clipping" << std::endl;
+    #endif
+  }
+
+  //vertices the indexed draws have run through the vertex stage since the cache last started
+  //over (a new buffer, matrix or buffer contents)
+  int TransformedVertices()const{ return m_VertexCache.Transformed(); }
+
+  //facing-based culling of DrawIndexed's triangles; front faces are counter-clockwise in
+  //normalized device coordinates unless SetFrontFace says otherwise. Off by default.
+  void SetCullMode(CullMode mode){ m_Assembler.SetCullMode(mode); }
+  CullMode GetCullMode()const{ return m_Assembler.GetCullMode(); }
+
+  void SetFrontFace(Winding winding){ m_Assembler.SetFrontFace(winding); }
+  Winding GetFrontFace()const{ return m_Assembler.GetFrontFace(); }
+
+  //triangles DrawIndexed assembled, culled and clipped since the last reset
+  const ClipStats& GetClipStats()const{ return m_Assembler.Stats(); }
+  void ResetClipStats(){ m_Assembler.ResetStats(); }
+
+  //quads fragment programs ran on and pixels they wrote since the last reset; Utilization() is
+  //the share of quad lanes that were not helpers
+  QuadStats GetQuadStats()const
+  {
+    QuadStats total{0, 0};
+    for(const QuadStats& tile : m_QuadStats)
     {
-      x_left = x012;
-      x_right = x02;
+      total.quads += tile.quads;
+      total.pixels += tile.pixels;
     }
+    return total;
+  }
 
-    for(int y = (int)std::ceil(y0); y < (int)std::ceil(y2); y++)
+  void ResetQuadStats(){ std::fill(m_QuadStats.begin(), m_QuadStats.end(), QuadStats{0, 0}); }
+
+  void PutFilledTriangle(float x0, float y0, float x1, float y1, float x2, float y2, CP color)
+  {
+    P col = Pack(color);
+
+    if(m_iThreads > 1)
     {
-      for(int x = (int)x_left[y - y0]; x < (int)x_right[y - y0]; x++)
-      {
-        PutPixel(x, y, color);
-      }
+      m_Commands.push_back(TriangleCmd{{x0, x1, x2}, {y0, y1, y2}, {}, {}, 0, 0, col, false, nullptr, nullptr, 0});
+      return;
     }
 
+    FillTriangle(x0, y0, x1, y1, x2, y2, col, FullRect());
+
     #ifdef DEBUG
     std::cout << "Rendered a filled-triangle: " << Vec2(x0, y0) << ", " << Vec2(x1, y1) <<
     ", " << Vec2(x2, y2) << std::endl;
@@ -526,68 +959,15 @@ public:
   
   void PutFilledTriangle(float x0, float y0, float x1, float y1, float x2, float y2, uint8_t r, uint8_t g, uint8_t b)
   {
-    if(y1 < y0)
-    {
-      float tmp = x0;
-      x0 = x1;
-      x1 = tmp;
+    P col = Pack(r, g, b);
 
-      tmp = y0;
-      y0 = y1;
-      y1 = tmp;
-    }
-
-    if(y2 < y0)
-    {
-      float tmp = y0;
-      y0 = y2;
-      y2 = tmp;
-
-      tmp = x0;
-      x0 = x2;
-      x2 = tmp;
-    }
-
-    if(y2 < y1)
-    {
-      float tmp = y1;
-      y1 = y2;
-      y2 = tmp;
-
-      tmp = x1;
-      x1 = x2;
-      x2 = tmp;
-    }
-
-    std::vector<float> x01 = Interpolate(y0, x0, y1, x1);
-    std::vector<float> x12 = Interpolate(y1, x1, y2, x2);
-    std::vector<float> x02 = Interpolate(y0, x0, y2, x2);
-    
-    x01.pop_back();
-    x01.insert(x01.end(), x12.begin(), x12.end());
-    std::vector<float> x012 = x01;
-
-    std::vector<float> x_left;
-    std::vector<float> x_right;
-    int m = std::floor(x012.size()/2);
-    if(x02[m] < x012[m])
+    if(m_iThreads > 1)
     {
-      x_left = x02;
-      x_right = x012;
-    }
-    else
-    {
-      x_left = x012;
-      x_right = x02;
+      m_Commands.push_back(TriangleCmd{{x0, x1, x2}, {y0, y1, y2}, {}, {}, 0, 0, col, false, nullptr, nullptr, 0});
+      return;
     }
 
-    for(int y = (int)std::ceil(y0); y < (int)std::ceil(y2); y++)
-    {
-      for(int x = (int)x_left[y - y0]; x < (int)x_right[y - y0]; x++)
-      {
-        PutPixel(x, y, r, g, b);
-      }
-    }
+    FillTriangle(x0, y0, x1, y1, x2, y2, col, FullRect());
     
     #ifdef DEBUG
     std::cout << "Rendered a filled-triangle: " << Vec2(x0, y0) << ", " << Vec2(x1, y1) << ", "
@@ -605,98 +985,151 @@ public:
     PutFilledTriangle(x0, y0, x1, y1, x2, y2, c.X(), c.Y(), c.Z()); 
   }
   
+  //shades a triangle with its vertices' colors, interpolated perspective-correctly when their
+  //m_InvW differ. Only the colors are set up as varyings, as nothing on this path reads the
+  //normals or texture coordinates; a Pipeline shades with any varyings.
   void PutShadedTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2)
   {
-    Vertex a = v0;
-    Vertex b = v1;
-    Vertex c = v2;
-
-    if(b.m_Position.Y() < a.m_Position.Y()){ Swap(a.m_Position, b.m_Position); }
-    if(c.m_Position.Y() < a.m_Position.Y()){ Swap(a.m_Position, c.m_Position); }
-    if(c.m_Position.Y() < b.m_Position.Y()){ Swap(b.m_Position, c.m_Position); }
-
-    std::vector<float> x01 = Interpolate_(a.m_Position.XY(), b.m_Position.XY());
-    std::vector<Vec3> c01 = InterpolateVec3(a.m_Position.Y(), a.m_Color, b.m_Position.Y(), b.m_Color);
-    
-    std::vector<float> x12 = Interpolate_(b.m_Position.XY(), c.m_Position.XY());
-    std::vector<Vec3> c12 = InterpolateVec3(b.m_Position.Y(), b.m_Color, c.m_Position.Y(), c.m_Color);
-    
-    std::vector<float> x02 = Interpolate_(a.m_Position.XY(), c.m_Position.XY());
-    std::vector<Vec3> c02 = InterpolateVec3(a.m_Position.Y(), a.m_Color, c.m_Position.Y(), c.m_Color);
-    
-    x01.pop_back();
-    x01.insert(x01.end(), x12.begin(), x12.end());
-    std::vector<float> x012 = x01;
+    float v[3][7];
+    const Vertex* src[3] = {&v0, &v1, &v2};
+    for(int k = 0; k < 3; k++)
+    {
+      v[k][0] = src[k]->m_Position.X();
+      v[k][1] = src[k]->m_Position.Y();
+      v[k][2] = src[k]->m_Position.Z();
+      v[k][3] = src[k]->m_InvW;
+      v[k][4] = src[k]->m_Color.X();
+      v[k][5] = src[k]->m_Color.Y();
+      v[k][6] = src[k]->m_Color.Z();
+    }
 
-    c01.pop_back();
-    c01.insert(c01.end(), c12.begin(), c12.end());
-    std::vector<Vec3> c012 = c01;
-    
-    std::vector<float> x_left;
-    std::vector<Vec3> c_left;
+    PutShadedTriangle(v[0], v[1], v[2], 3);
 
-    std::vector<float> x_right;
-    std::vector<Vec3> c_right;
+    #ifdef DEBUG
+    std::cout << "Rendered a shaded-triangle: " << v0.m_Position << ", " << v1.m_Position << ", "
+    << v2.m_Position << std::endl;
+    #endif
+  }
 
-    int m = std::floor(x012.size() / 2);
-    if(x02[m] < x012[m])
+  //shades a triangle from vertices of N = count varyings: each is x, y (pixels), z (depth),
+  //1/w, then its varyings. Varyings 0, 1 and 2 are shaded as r, g, b in [0, 255] (missing ones
+  //as 0). Throws Invalid for more than MAX_VARYINGS.
+  void PutShadedTriangle(const float* v0, const float* v1, const float* v2, int count)
+  {
+    if(count < 0 || count > MAX_VARYINGS) throw Invalid{};
+
+    TriangleCmd cmd{
+      {v0[0], v1[0], v2[0]},
+      {v0[1], v1[1], v2[1]},
+      {v0[2], v1[2], v2[2]},
+      {v0[3], v1[3], v2[3]},
+      0,
+      count,
+      P{},
+      true,
+      nullptr,
+      nullptr,
+      0
+    };
+
+    if(m_iThreads > 1)
     {
-      x_left = x02;
-      c_left = c02;
-
-      x_right = x012;
-      c_right = c012;
+      cmd.varyings = (uint32_t)m_Varyings.size();
+      m_Varyings.insert(m_Varyings.end(), v0 + 4, v0 + 4 + count);
+      m_Varyings.insert(m_Varyings.end(), v1 + 4, v1 + 4 + count);
+      m_Varyings.insert(m_Varyings.end(), v2 + 4, v2 + 4 + count);
+      m_Commands.push_back(cmd);
+      return;
     }
-    else
-    {
-      x_left = x012;
-      c_left = c012;
-
-      x_right = x02;
-      c_right = c02;
-    }
-    
-    int y_start = (int)std::ceil(a.m_Position.iY());
-
-    for(int y = y_start; y < (int)std::ceil(c.m_Position.iY()); y++)
-    {
-      int i = y - y_start;
 
-      float x_l = x_left[i];
-      float x_r = x_right[i];
+    float varyings[3 * MAX_VARYINGS];
+    std::copy(v0 + 4, v0 + 4 + count, varyings);
+    std::copy(v1 + 4, v1 + 4 + count, varyings + count);
+    std::copy(v2 + 4, v2 + 4 + count, varyings + 2 * count);
 
-      Vec3 col_l = c_left[i];
-      Vec3 col_r = c_right[i];
-
-      int x_start = (int)std::ceil(x_l);
-      int x_end = (int)std::ceil(x_r);
-
-      for(int x = x_start; x < x_end; x++)
-      {
-        float t = ((float)x - x_l) / (x_r - x_l);
-        Vec3 color = Lerp(col_l, col_r, t);
-
-        PutPixel(x, y, color);
-      }
-    }
+    ShadeTriangle(cmd, varyings, FullRect());
   }
   
+  //copies the framebuffer as packed 24-bit rgb rows (the ppm layout) into dst, which must hold
+  //Width() * Height() colors
+  void ReadPixelsRGB(Color* dst)
+  {
+    if(!m_Commands.empty()) Flush();
+    ResolveAll();
+    ResolveSamples();
+
+    ConvertToRGB(m_pPixels, m_iWidth * m_iHeight, dst);
+  }
+
   void BlitFramebuffer()
   {
-    std::string name = "../frame_" + std::to_string(m_iBlitNum++) + ".ppm";
+    if(!m_Commands.empty()) Flush();
+    ResolveAll();
+    ResolveSamples();
+
+
+    std::string name = "../frame_" + std::to_string(m_iBlitNum++) + "." +
+      (m_bDeltaOutput ? "delta" : ImageExtension(m_ImageFormat));
     std::ofstream file(name, std::ios::binary);
 
     if(!file) throw Invalid{};
 
+    if(m_bDeltaOutput)
+    {
+      std::vector<uint8_t> delta;
+      EncodeDelta(delta);
+
+      file.write(reinterpret_cast<const char*>(delta.data()), (std::streamsize)delta.size());
+      file.close();
+
+      std::cout << "Framebuffer successfully blitted to: " << name << " (" << delta.size() << " bytes)"
+        << std::endl;
+      return;
+    }
+
+    if(m_ImageFormat != ImageFormat::PPM)
+    {
+      std::vector<Color> rgb((size_t)m_iWidth * m_iHeight);
+      ConvertToRGB(m_pPixels, m_iWidth * m_iHeight, rgb.data());
+
+      auto start = std::chrono::steady_clock::now();
+      std::vector<uint8_t> encoded;
+      EncodeImage(m_ImageFormat, rgb.data(), m_iWidth, m_iHeight, m_iThreads, encoded);
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      file.write(reinterpret_cast<const char*>(encoded.data()), (std::streamsize)encoded.size());
+      file.close();
+
+      //throughput is measured on the uncompressed 24-bit input
+      double mb = (double)rgb.size() * sizeof(Color) / (1024.0 * 1024.0);
+      std::cout << "Framebuffer successfully blitted to: " << name << " (" << encoded.size()
+        << " bytes, " << (seconds > 0.0 ? mb / seconds : 0.0) << " MB/s encoded)" << std::endl;
+      return;
+    }
+
     //PPM Header
     file << "P6\n";
     file << m_iWidth << " " << m_iHeight << "\n";
     file << "255\n";
 
-    file.write(
-      reinterpret_cast<const char*>(m_pPixels),
-      m_iWidth * m_iHeight * sizeof(Color)
-    );
+    if constexpr(std::is_same<P, RGB8>::value)
+    {
+      file.write(
+        reinterpret_cast<const char*>(m_pPixels),
+        (std::streamsize)m_iWidth * m_iHeight * sizeof(RGB8)
+      );
+    }
+    else
+    {
+      //other formats are converted a row at a time into the ppm's 24-bit layout
+      std::vector<Color> row(m_iWidth);
+      for(int y = 0; y < m_iHeight; y++)
+      {
+        ConvertToRGB(m_pPixels + y * m_iWidth, m_iWidth, row.data());
+
+        file.write(reinterpret_cast<const char*>(row.data()), (std::streamsize)m_iWidth * sizeof(Color));
+      }
+    }
     
     file.close();
     
@@ -704,13 +1137,1220 @@ public:
   }
   
 private:
+
+  //inclusive pixel rectangle that rasterization is clipped to (a tile or the whole framebuffer)
+  struct TileRect
+  {
+    int x0, y0, x1, y1;
+  };
+
+  //a triangle recorded for deferred, tile-binned rasterization. A shaded one keeps its vertices'
+  //1/w and count varyings per vertex at m_Varyings[varyings], vertex after vertex, and is shaded
+  //by program (with the fragment shader fs) or, if that is null, as interpolated color. A
+  //recorded program's fs is its draw's copy at m_Programs[copy], pointed at when it is flushed.
+  struct TriangleCmd
+  {
+    float x[3];
+    float y[3];
+    float z[3];
+    float w[3];
+    uint32_t varyings;
+    int count;
+    P flat;
+    bool shaded;
+    void (*program)(TFramebuffer&, const TriangleCmd&, const TriangleSetup&, const float*);
+    const void* fs;
+    uint32_t copy;
+  };
+
+  //TriangleCmd::copy of a command shaded with the fs it was recorded with
+  static constexpr uint32_t NO_COPY = 0xFFFFFFFFu;
+
+  //pixel storage is raw, PIXEL_ALIGN-aligned memory; every format is trivially copyable, so
+  //it is zeroed and copied with memset/memcpy instead of per-element constructors
+  static P* AllocPixels(int count)
+  {
+    if(count <= 0) return nullptr;
+
+    size_t bytes = (size_t)count * sizeof(P);
+    P* pixels = static_cast<P*>(::operator new(bytes, std::align_val_t(PIXEL_ALIGN)));
+    std::memset(static_cast<void*>(pixels), 0, bytes);
+    return pixels;
+  }
+
+  static void FreePixels(P* pixels)
+  {
+    if(pixels) ::operator delete(pixels, std::align_val_t(PIXEL_ALIGN));
+  }
+
+  static void ConvertToRGB(const P* src, int count, Color* dst)
+  {
+    if constexpr(std::is_same<P, RGB8>::value)
+    {
+      std::memcpy(static_cast<void*>(dst), src, (size_t)count * sizeof(RGB8));
+    }
+    else
+    {
+      for(int i = 0; i < count; i++)
+      {
+        dst[i] = PixelTraits<P>::Unpack(src[i]);
+      }
+    }
+  }
+
+  static P Pack(uint8_t r, uint8_t g, uint8_t b){ return PixelTraits<P>::Pack(r, g, b); }
+
+  static P Pack(CP color)
+  {
+    Color col;
+    col.SetColor(color);
+    return PixelTraits<P>::Pack(col.r, col.g, col.b);
+  }
+
+  //bounds of the depths stored in one tile, in the depth format's stored units, plus the pixel
+  //area drawn into the tile since the bounds were last recomputed
+  struct HiZTile
+  {
+    float zmin;
+    float zmax;
+    int written;
+  };
+
+  TileRect FullRect()const{ return TileRect{0, 0, m_iWidth - 1, m_iHeight - 1}; }
+
+  int TilesX()const{ return (m_iWidth + TILE_SIZE - 1) / TILE_SIZE; }
+  int TilesY()const{ return (m_iHeight + TILE_SIZE - 1) / TILE_SIZE; }
+
+  void Clear(const P& col)
+  {
+    //anything recorded so far would be overwritten anyway
+    m_Commands.clear();
+    m_Varyings.clear();
+    m_Programs.clear();
+
+    m_ClearPattern = MakeFillPattern(col);
+    MarkAllDirty();
+    ClearSamples();
+
+    if(m_bFastClear)
+    {
+      m_TilePending.assign(TilesX() * TilesY(), 1);
+      m_bClearPending = true;
+      return;
+    }
+
+    m_bClearPending = false;
+    FillPixels(m_pPixels, m_iWidth * m_iHeight, m_ClearPattern);
+  }
+
+  //gives every still-cleared tile overlapping the inclusive pixel rectangle its clear color.
+  //Called before any write; in the tile-binned flush the rectangle never leaves the worker's tile.
+  void ResolveTiles(int x0, int y0, int x1, int y1)
+  {
+    if(!m_bClearPending) return;
+
+    int tilesX = TilesX();
+    for(int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ty++)
+    {
+      for(int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++)
+      {
+        uint8_t& pending = m_TilePending[ty * tilesX + tx];
+        if(!pending) continue;
+
+        int w = std::min(TILE_SIZE, m_iWidth - tx * TILE_SIZE);
+        int yEnd = std::min((ty + 1) * TILE_SIZE, m_iHeight);
+        for(int y = ty * TILE_SIZE; y < yEnd; y++)
+        {
+          FillPixels(m_pPixels + y * m_iWidth + tx * TILE_SIZE, w, m_ClearPattern);
+        }
+
+        pending = 0;
+      }
+    }
+  }
+
+  void ResolveAll()
+  {
+    if(!m_bClearPending) return;
+
+    ResolveTiles(0, 0, m_iWidth - 1, m_iHeight - 1);
+    m_bClearPending = false;
+  }
+
+  //sizes the per-pixel sample indices and per-tile pools for m_iSamples, every pixel single-colored
+  void AllocSamples()
+  {
+    if(m_iSamples > 1)
+    {
+      m_SampleIndex.assign((size_t)m_iWidth * m_iHeight, -1);
+      m_SamplePools.assign(TilesX() * TilesY(), std::vector<P>());
+    }
+    else
+    {
+      m_SampleIndex.clear();
+      m_SamplePools.clear();
+    }
+  }
+
+  //a clear leaves every pixel single-colored; the pools keep their capacity
+  void ClearSamples()
+  {
+    if(m_iSamples == 1) return;
+
+    std::fill(m_SampleIndex.begin(), m_SampleIndex.end(), -1);
+    for(std::vector<P>& pool : m_SamplePools) pool.clear();
+  }
+
+  //marks pixel index single-colored (its color in m_pPixels), keeping any storage for reuse
+  void Collapse(size_t index)
+  {
+    if(m_iSamples == 1) return;
+
+    int32_t& slot = m_SampleIndex[index];
+    if(slot >= 0) slot = -slot - 2;
+  }
+
+  //averages the samples of pixel index into m_pPixels
+  void ResolvePixel(size_t index)
+  {
+    int x = (int)(index % m_iWidth), y = (int)(index / m_iWidth);
+    const std::vector<P>& pool = m_SamplePools[(y / TILE_SIZE) * TilesX() + x / TILE_SIZE];
+    m_pPixels[index] = PixelTraits<P>::Resolve(pool.data() + m_SampleIndex[index], m_iSamples);
+  }
+
+  //writes the average of every pixel holding several colors into m_pPixels, where the others
+  //already have theirs. The indices are scanned row by row, 8 pixels per compare with AVX2, so
+  //the pixels inside triangles cost next to nothing. With collapse the averages replace the
+  //samples, for when m_pPixels is about to be written directly.
+  void ResolveSamples(bool collapse = false)
+  {
+    if(m_iSamples == 1) return;
+
+    int tilesX = TilesX();
+    for(int y = 0; y < m_iHeight; y++)
+    {
+      size_t start = (size_t)y * m_iWidth;
+      const int32_t* index = m_SampleIndex.data() + start;
+      const std::vector<P>* pools = m_SamplePools.data() + (y / TILE_SIZE) * tilesX;
+
+      auto resolve = [&](int x)
+      {
+        m_pPixels[start + x] = PixelTraits<P>::Resolve(pools[x / TILE_SIZE].data() + index[x], m_iSamples);
+        if(collapse) Collapse(start + x);
+      };
+
+      int x = 0;
+#if defined(__AVX2__)
+      const __m256i none = _mm256_set1_epi32(-1);
+      for(; x + 8 <= m_iWidth; x += 8)
+      {
+        __m256i slots = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index + x));
+        int expanded = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(slots, none)));
+
+        for(; expanded; expanded &= expanded - 1) resolve(x + __builtin_ctz(expanded));
+      }
+#endif
+
+      for(; x < m_iWidth; x++)
+      {
+        if(index[x] >= 0) resolve(x);
+      }
+    }
+  }
+
+  //records that the inclusive pixel rectangle may have changed since the last delta. Like
+  //ResolveTiles it is called before any write and never leaves a tile-binned worker's tile.
+  void MarkDirty(int x0, int y0, int x1, int y1)
+  {
+    int tilesX = TilesX();
+    for(int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ty++)
+    {
+      for(int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++)
+      {
+        m_TileDirty[ty * tilesX + tx] = 1;
+      }
+    }
+  }
+
+  void MarkAllDirty(){ std::fill(m_TileDirty.begin(), m_TileDirty.end(), 1); }
+
+  //marks the tiles a line may touch inside clip: the line is cut into pieces at most a tile
+  //long along its major axis, and each piece's box (padded to cover the rounding of both the
+  //pieces and the bresenham walk) is marked, so a diagonal does not dirty its whole bounding box
+  void MarkLineDirty(float x0, float y0, float x1, float y1, const TileRect& clip)
+  {
+    int64_t px0 = ToPixel(x0), py0 = ToPixel(y0);
+    int64_t dx = ToPixel(x1) - px0, dy = ToPixel(y1) - py0;
+    int64_t pieces = std::max(std::abs(dx), std::abs(dy)) / TILE_SIZE + 1;
+
+    //a line that long is mostly off-screen; its clipped box is tight enough
+    if(pieces > 4 * (TilesX() + TilesY())) pieces = 1;
+
+    for(int64_t i = 0; i < pieces; i++)
+    {
+      int64_t ax = px0 + dx * i / pieces, bx = px0 + dx * (i + 1) / pieces;
+      int64_t ay = py0 + dy * i / pieces, by = py0 + dy * (i + 1) / pieces;
+
+      int64_t bx0 = std::max((int64_t)clip.x0, std::min(ax, bx) - 2);
+      int64_t by0 = std::max((int64_t)clip.y0, std::min(ay, by) - 2);
+      int64_t bx1 = std::min((int64_t)clip.x1, std::max(ax, bx) + 2);
+      int64_t by1 = std::min((int64_t)clip.y1, std::max(ay, by) + 2);
+
+      if(bx0 <= bx1 && by0 <= by1) MarkDirty((int)bx0, (int)by0, (int)bx1, (int)by1);
+    }
+  }
+
+  void FillTriangle(float x0, float y0, float x1, float y1, float x2, float y2, const P& col,
+    const TileRect& clip)
+  {
+    if(m_iSamples > 1)
+    {
+      TriangleSetup s;
+      if(!SetupTriangle(x0, y0, x1, y1, x2, y2, clip.x0, clip.y0, clip.x1, clip.y1, s, 1)) return;
+
+      ResolveTiles(s.minX, s.minY, s.maxX, s.maxY);
+      MarkDirty(s.minX, s.minY, s.maxX, s.maxY);
+      ShadeSamples<NoDepth>(s, FlatQuads{col}, AttributePlane{}, false);
+      return;
+    }
+
+    RasterizeTriangle(x0, y0, x1, y1, x2, y2, clip, [&](int index, float, float, float)
+    {
+      m_pPixels[index] = col;
+    });
+  }
+
+  //varyings holds the command's varyings, vertex after vertex
+  void ShadeTriangle(const TriangleCmd& cmd, const float* varyings, const TileRect& clip)
+  {
+    //multisampled boxes take in the pixels whose centres are outside but samples may not be
+    TriangleSetup s;
+    if(!SetupTriangle(cmd.x[0], cmd.y[0], cmd.x[1], cmd.y[1], cmd.x[2], cmd.y[2],
+      clip.x0, clip.y0, clip.x1, clip.y1, s, m_iSamples > 1 ? 1 : 0)) return;
+
+    ResolveTiles(s.minX, s.minY, s.maxX, s.maxY);
+    MarkDirty(s.minX, s.minY, s.maxX, s.maxY);
+
+    if(cmd.program)
+    {
+      cmd.program(*this, cmd, s, varyings);
+      return;
+    }
+
+    //planes of every varying, set up once; the colors are the first three
+    VaryingPlanes v;
+    SetupVaryings(s, cmd.w, varyings, cmd.count, v);
+    for(int i = cmd.count; i < 3; i++) v.a[i] = AttributePlane{};
+
+    //multisampling shades in quads, which only fragment programs provide
+    if(m_iSamples > 1)
+    {
+      ColorProgram color;
+      Shade(cmd, s, ProgramQuads<3, ColorProgram>{s, v, color});
+      return;
+    }
+
+    Shade(cmd, s, ColorSpans{s, v});
+  }
+
+  //the built-in shading: varyings 0, 1 and 2 as r, g, b
+  struct ColorSpans
+  {
+    static constexpr bool QUADS = false;
+
+    const TriangleSetup& s;
+    const VaryingPlanes& v;
+
+    template<bool Masked, typename D>
+    void Span(P* row, int y, int x0, int x1, const int32_t* e, const int32_t* step, const SpanDepth<D>& depth)const
+    {
+      SpanColor col{v.a[0].Row(s, y), v.a[1].Row(s, y), v.a[2].Row(s, y), v.a[0].dx, v.a[1].dx, v.a[2].dx,
+        v.invW.Row(s, y), v.invW.dx, v.perspective, s.originX};
+      ShadeSpan<Masked>(row, x0, x1, e, step, col, depth);
+    }
+  };
+
+  //a fragment shader fs run on 2x2 quads: its N varyings are interpolated perspective-correctly
+  //for a whole block of quads at once (8 lanes with AVX2, 4 with SSE4.1) and
+  //fs(const float* varyings) returns each shaded pixel's r, g, b in [0, 255]. N is a
+  //compile-time constant, so the interpolation is unrolled to exactly the shader's attributes.
+  //A shader callable as fs(varyings, ddx, ddy) also gets every varying's screen-space
+  //derivatives, the differences across its quad (right minus left, bottom minus top of the top
+  //left pixel's row and column, shared by the quad). Lanes of a quad outside the triangle are
+  //helpers: interpolated for the differences but never shaded.
+  template<int N, typename F>
+  struct ProgramQuads
+  {
+    static constexpr bool QUADS = true;
+    static constexpr bool DERIVATIVES = std::is_invocable<const F&, const float*, const float*, const float*>::value;
+    static constexpr int LANES = 2 * QUAD_BLOCK;
+
+    const TriangleSetup& s;
+    const VaryingPlanes& v;
+    const F& fs;
+
+    //the planes at x = originX of each lane's row of a row pair; base[N] is 1/w
+    struct Pair
+    {
+      alignas(32) float base[N + 1][LANES];
+    };
+
+    void Setup(int y, Pair& pair)const
+    {
+      for(int k = 0; k <= N; k++)
+      {
+        const AttributePlane& plane = k < N ? v.a[k] : v.invW;
+        float top = plane.Row(s, y), bottom = plane.Row(s, y + 1);
+        for(int i = 0; i < LANES; i++) pair.base[k][i] = i < QUAD_BLOCK ? top : bottom;
+      }
+    }
+
+    //shades the pixels of mask (lanes as in CoverQuads) in the block of the pair from x, handing
+    //each one's color to store(lane, px)
+    template<typename Store>
+    void Block(const Pair& pair, int x, int mask, QuadStats& stats, Store&& store)const
+    {
+      const float (&base)[N + 1][LANES] = pair.base;
+      float dq = v.invW.dx;
+      bool perspective = v.perspective;
+      alignas(32) float in[N][LANES];
+
+#if defined(__AVX2__)
+      const __m256 one = _mm256_set1_ps(1.0f);
+      __m256 t = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x - s.originX),
+        _mm256_setr_epi32(0, 1, 2, 3, 0, 1, 2, 3)));
+      __m256 w = perspective ?
+        _mm256_div_ps(one, _mm256_add_ps(_mm256_load_ps(base[N]), _mm256_mul_ps(_mm256_set1_ps(dq), t))) : one;
+      for(int k = 0; k < N; k++)
+      {
+        _mm256_store_ps(in[k], _mm256_mul_ps(_mm256_add_ps(_mm256_load_ps(base[k]),
+          _mm256_mul_ps(_mm256_set1_ps(v.a[k].dx), t)), w));
+      }
+#elif defined(__SSE4_1__)
+      const __m128 one = _mm_set1_ps(1.0f);
+      __m128 t = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x - s.originX), _mm_setr_epi32(0, 1, 0, 1)));
+      __m128 w = perspective ? _mm_div_ps(one, _mm_add_ps(_mm_load_ps(base[N]), _mm_mul_ps(_mm_set1_ps(dq), t))) : one;
+      for(int k = 0; k < N; k++)
+      {
+        _mm_store_ps(in[k], _mm_mul_ps(_mm_add_ps(_mm_load_ps(base[k]), _mm_mul_ps(_mm_set1_ps(v.a[k].dx), t)), w));
+      }
+#else
+      for(int i = 0; i < LANES; i++)
+      {
+        float t = (float)(x + i % QUAD_BLOCK - s.originX);
+        float w = perspective ? 1.0f / (base[N][i] + dq * t) : 1.0f;
+        for(int k = 0; k < N; k++) in[k][i] = (base[k][i] + v.a[k].dx * t) * w;
+      }
+#endif
+
+      auto clamp = [](float c){ return c > 0.0f ? (c < 255.0f ? c : 255.0f) : 0.0f; };
+
+      for(int q = 0; q < QUAD_BLOCK / 2; q++)
+      {
+        int quad = mask & ((3 << (2 * q)) | (3 << (QUAD_BLOCK + 2 * q)));
+        if(!quad) continue;
+
+        stats.quads++;
+        stats.pixels += __builtin_popcount(quad);
+
+        //top left, top right and bottom left lanes of the quad
+        int tl = 2 * q, tr = tl + 1, bl = tl + QUAD_BLOCK;
+        float ddx[N], ddy[N];
+        if constexpr(DERIVATIVES)
+        {
+          for(int k = 0; k < N; k++)
+          {
+            ddx[k] = in[k][tr] - in[k][tl];
+            ddy[k] = in[k][bl] - in[k][tl];
+          }
+        }
+
+        for(; quad; quad &= quad - 1)
+        {
+          int i = __builtin_ctz(quad);
+
+          float pixel[N];
+          for(int k = 0; k < N; k++) pixel[k] = in[k][i];
+
+          Vec3 c;
+          if constexpr(DERIVATIVES) c = fs(pixel, ddx, ddy);
+          else c = fs(pixel);
+
+          P px;
+          PixelTraits<P>::Shade(px, clamp(c.X()), clamp(c.Y()), clamp(c.Z()));
+          store(i, px);
+        }
+      }
+    }
+  };
+
+  //the built-in shading as a fragment program, for multisampled triangles
+  struct ColorProgram
+  {
+    Vec3 operator()(const float* in)const{ return Vec3(in[0], in[1], in[2]); }
+  };
+
+  //a flat color as quads, for multisampled fills: every pixel gets col
+  struct FlatQuads
+  {
+    static constexpr bool QUADS = true;
+
+    struct Pair{};
+
+    const P& col;
+
+    void Setup(int, Pair&)const{}
+
+    template<typename Store>
+    void Block(const Pair&, int, int mask, QuadStats&, Store&& store)const
+    {
+      for(; mask; mask &= mask - 1) store(__builtin_ctz(mask), col);
+    }
+  };
+
+  //shades a triangle with a fragment program; cmd.fs is the F it was recorded with
+  template<int N, typename F>
+  static void ShadeProgram(TFramebuffer& fb, const TriangleCmd& cmd, const TriangleSetup& s, const float* varyings)
+  {
+    VaryingPlanes v;
+    SetupVaryings(s, cmd.w, varyings, N, v);
+
+    fb.Shade(cmd, s, ProgramQuads<N, F>{s, v, *static_cast<const F*>(cmd.fs)});
+  }
+
+  //runs spans over the setup's box, through the hierarchical-z tiles of the depth format if any
+  template<typename Spans>
+  void Shade(const TriangleCmd& cmd, const TriangleSetup& s, const Spans& spans)
+  {
+    if(m_DepthFormat == DepthFormat::F32) ShadeTiles<float>(cmd, s, spans);
+    else if(m_DepthFormat == DepthFormat::UNORM16) ShadeTiles<uint16_t>(cmd, s, spans);
+    else ShadeBox<NoDepth>(s, spans, AttributePlane{}, false);
+  }
+
+  //shades the setup's box row by row, or in quads for spans that ask for them, per sample when
+  //multisampled
+  template<typename D, typename Spans>
+  void ShadeBox(const TriangleSetup& s, const Spans& spans, const AttributePlane& z, bool test)
+  {
+    if constexpr(Spans::QUADS)
+    {
+      if(m_iSamples > 1) ShadeSamples<D>(s, spans, z, test);
+      else ShadeQuads<D>(s, spans, z, test);
+    }
+    else
+    {
+      ShadeRows<D>(s, spans, z, test);
+    }
+  }
+
+  //shades every row of the setup's box, depth testing against D unless it is NoDepth
+  template<typename D, typename Spans>
+  void ShadeRows(const TriangleSetup& s, const Spans& spans, const AttributePlane& z, bool test)
+  {
+    //wide rows are solved for their exact covered range; narrow triangles walk the box with
+    //32-bit edge tests. Huge triangles whose edges overflow 32 bits always use exact spans.
+    bool exact = !s.fits32 || s.maxX - s.minX >= 32;
+
+    int32_t step[3] = {(int32_t)s.StepX(0), (int32_t)s.StepX(1), (int32_t)s.StepX(2)};
+
+    for(int y = s.minY; y <= s.maxY; y++)
+    {
+      SpanDepth<D> depth{DepthRow<D>(y), z.Row(s, y), z.dx, test};
+      P* row = m_pPixels + y * m_iWidth;
+
+      if(exact)
+      {
+        int x0, x1;
+        if(s.RowSpan(y, x0, x1)) spans.template Span<false>(row, y, x0, x1, nullptr, nullptr, depth);
+      }
+      else
+      {
+        int32_t e[3] = {(int32_t)s.Edge(0, s.minX, y), (int32_t)s.Edge(1, s.minX, y),
+          (int32_t)s.Edge(2, s.minX, y)};
+        spans.template Span<true>(row, y, s.minX, s.maxX, e, step, depth);
+      }
+    }
+  }
+
+  //shades the box in row pairs starting at an even row, so quads line up with the framebuffer's
+  //even coordinates. The quads shaded are counted against the tile holding the box's corner:
+  //with several threads the box is one tile, owned by the calling worker.
+  template<typename D, typename Quads>
+  void ShadeQuads(const TriangleSetup& s, const Quads& quads, const AttributePlane& z, bool test)
+  {
+    QuadStats stats{0, 0};
+    typename Quads::Pair pair;
+
+    for(int y = s.minY & ~1; y <= s.maxY; y += 2)
+    {
+      P* rows[2] = {nullptr, nullptr};
+      int x0[2] = {1, 1}, x1[2] = {0, 0};
+      SpanDepth<D> depth[2] = {};
+
+      for(int r = 0; r < 2; r++)
+      {
+        int row = y + r;
+        if(row < s.minY || row > s.maxY || !s.RowSpan(row, x0[r], x1[r]))
+        {
+          x0[r] = 1;
+          x1[r] = 0;
+          continue;
+        }
+
+        rows[r] = m_pPixels + row * m_iWidth;
+        depth[r] = SpanDepth<D>{DepthRow<D>(row), z.Row(s, row), z.dx, test};
+      }
+      if(!rows[0] && !rows[1]) continue;
+
+      quads.Setup(y, pair);
+      CoverQuads<D>(x0, x1, s.originX, depth, [&](int x, int mask)
+      {
+        quads.Block(pair, x, mask, stats, [&](int i, const P& px){ rows[i / QUAD_BLOCK][x + i % QUAD_BLOCK] = px; });
+      });
+    }
+
+    AddQuadStats(s, stats);
+  }
+
+  void AddQuadStats(const TriangleSetup& s, const QuadStats& stats)
+  {
+    if(!stats.quads) return;
+
+    QuadStats& tile = m_QuadStats[(s.minY / TILE_SIZE) * TilesX() + s.minX / TILE_SIZE];
+    tile.quads += stats.quads;
+    tile.pixels += stats.pixels;
+  }
+
+  //multisampled shading of the box in row pairs. Pixels inside a row's inner span have every
+  //sample covered, so their coverage is not tested and their samples are depth tested a run at a
+  //time; those passing whole are stored as one color, like single-sampled pixels. Only the pixels
+  //between the inner and outer spans, and inner ones passing in part, take the per-sample path.
+  //Either way the quads shade each pixel once, at its centre.
+  template<typename D, typename Quads>
+  void ShadeSamples(const TriangleSetup& s, const Quads& quads, const AttributePlane& z, bool test)
+  {
+    constexpr bool HasDepth = !std::is_same<D, NoDepth>::value;
+
+    SampleCoverage cover;
+    SetupSamples(s, m_iSamples, cover);
+    int full = (1 << m_iSamples) - 1;
+
+    //depth change from a pixel's centre to each sample
+    const int8_t* pattern = SamplePattern(m_iSamples);
+    alignas(32) float dz[MAX_SAMPLES] = {};
+    for(int k = 0; k < m_iSamples; k++)
+    {
+      dz[k] = (z.dx * (float)pattern[2 * k] + z.dy * (float)pattern[2 * k + 1]) / (float)SUBPIXEL_ONE;
+    }
+
+    QuadStats stats{0, 0};
+    typename Quads::Pair pair;
+
+    for(int y = s.minY & ~1; y <= s.maxY; y += 2)
+    {
+      int ox0[2] = {1, 1}, ox1[2] = {0, 0}, ix0[2] = {1, 1}, ix1[2] = {0, 0};
+      float centre[2] = {0.0f, 0.0f};
+      int lo = INT32_MAX, hi = INT32_MIN;
+
+      for(int r = 0; r < 2; r++)
+      {
+        int row = y + r;
+        if(row < s.minY || row > s.maxY || !cover.outer.RowSpan(row, ox0[r], ox1[r]))
+        {
+          ox0[r] = 1;
+          ox1[r] = 0;
+          continue;
+        }
+        if(!cover.inner.RowSpan(row, ix0[r], ix1[r]))
+        {
+          ix0[r] = 1;
+          ix1[r] = 0;
+        }
+
+        centre[r] = z.Row(s, row);
+        lo = std::min(lo, ox0[r]);
+        hi = std::max(hi, ox1[r]);
+      }
+      if(lo > hi) continue;
+
+      quads.Setup(y, pair);
+
+      for(int x = lo & ~(QUAD_BLOCK - 1); x <= hi; x += QUAD_BLOCK)
+      {
+        //lanes (as in CoverQuads) inside the inner spans, and those between them and the outer ones
+        int inner = 0, band = 0;
+        for(int r = 0; r < 2; r++)
+        {
+          inner |= LaneRange(ix0[r] - x, ix1[r] - x) << (r * QUAD_BLOCK);
+          band |= LaneRange(ox0[r] - x, ox1[r] - x) << (r * QUAD_BLOCK);
+        }
+        band &= ~inner;
+
+        //the samples left per lane of the per-sample path
+        int samples[2 * QUAD_BLOCK];
+
+        if constexpr(HasDepth)
+        {
+          int partial = 0;
+          for(int r = 0; r < 2; r++)
+          {
+            int lanes = (inner >> (r * QUAD_BLOCK)) & ((1 << QUAD_BLOCK) - 1);
+            if(!lanes) continue;
+
+            //a row's inner lanes are consecutive
+            int a = __builtin_ctz(lanes), b = 31 - __builtin_clz(lanes);
+            int* passed = samples + r * QUAD_BLOCK;
+            TestSampleRun(DepthRow<D>(y + r), x + a, x + b, centre[r], z.dx, s.originX, dz, test, passed + a);
+
+            for(int i = a; i <= b; i++)
+            {
+              if(passed[i] == full) continue;
+
+              inner &= ~(1 << (r * QUAD_BLOCK + i));
+              if(passed[i]) partial |= 1 << (r * QUAD_BLOCK + i);
+            }
+          }
+
+          for(int bits = band; bits; bits &= bits - 1)
+          {
+            int i = __builtin_ctz(bits), r = i / QUAD_BLOCK, px = x + i % QUAD_BLOCK;
+
+            int m = cover.Mask(s, px, y + r);
+            if(m) m = TestSamples(DepthRow<D>(y + r), px, centre[r] + z.dx * (float)(px - s.originX), dz, m, test);
+
+            samples[i] = m;
+            if(!m) band &= ~(1 << i);
+          }
+          band |= partial;
+        }
+        else
+        {
+          for(int bits = band; bits; bits &= bits - 1)
+          {
+            int i = __builtin_ctz(bits);
+
+            samples[i] = cover.Mask(s, x + i % QUAD_BLOCK, y + i / QUAD_BLOCK);
+            if(!samples[i]) band &= ~(1 << i);
+          }
+        }
+
+        int mask = inner | band;
+        if(!mask) continue;
+
+        quads.Block(pair, x, mask, stats, [&](int i, const P& px)
+        {
+          size_t index = (size_t)(y + i / QUAD_BLOCK) * m_iWidth + x + i % QUAD_BLOCK;
+          if(inner >> i & 1)
+          {
+            m_pPixels[index] = px;
+            Collapse(index);
+          }
+          else
+          {
+            StoreSamples(x + i % QUAD_BLOCK, y + i / QUAD_BLOCK, px, samples[i]);
+          }
+        });
+      }
+    }
+
+    AddQuadStats(s, stats);
+  }
+
+  //depth tests the samples of mask of multisampled pixel x of depth row row, whose centre has
+  //depth at (sample k at at + dz[k]), and returns those that passed
+  template<typename D>
+  int TestSamples(D* row, int x, float at, const float* dz, int mask, bool test)
+  {
+    D* depth = row + x * m_iSamples;
+
+#if defined(__AVX2__)
+    //a pixel's samples are adjacent, one block of lanes
+    return DepthTraits<D>::TestBlock(depth, _mm256_add_ps(_mm256_set1_ps(at), _mm256_load_ps(dz)), mask,
+      m_iSamples == 8, test);
+#else
+    for(int bits = mask; bits; bits &= bits - 1)
+    {
+      int k = __builtin_ctz(bits);
+      if(!DepthTraits<D>::Test(depth[k], at + dz[k], test)) mask &= ~(1 << k);
+    }
+    return mask;
+#endif
+  }
+
+  //tests every sample of pixels x0..x1 of a row whose centre depth is z + dx * (x - originX),
+  //with passed[x - x0] set to pixel x's passing samples. At 4 samples two pixels share a block.
+  template<typename D>
+  void TestSampleRun(D* row, int x0, int x1, float z, float dx, int originX, const float* dz, bool test,
+    int* passed)
+  {
+    int x = x0;
+
+#if defined(__AVX2__)
+    if(m_iSamples == 4)
+    {
+      __m128 offsets = _mm_load_ps(dz);
+      for(; x < x1; x += 2)
+      {
+        float a = z + dx * (float)(x - originX), b = z + dx * (float)(x + 1 - originX);
+        __m256 at = _mm256_set_m128(_mm_add_ps(_mm_set1_ps(b), offsets), _mm_add_ps(_mm_set1_ps(a), offsets));
+
+        int m = DepthTraits<D>::TestBlock(row + x * 4, at, 0xFF, true, test);
+        passed[x - x0] = m & 15;
+        passed[x + 1 - x0] = m >> 4;
+      }
+    }
+#endif
+
+    for(; x <= x1; x++)
+    {
+      passed[x - x0] = TestSamples(row, x, z + dx * (float)(x - originX), dz, (1 << m_iSamples) - 1, test);
+    }
+  }
+
+  //stores px to the samples of mask of pixel (x, y): a pixel whose samples are all written
+  //collapses to that single color, a partly written one is expanded into its tile's pool first
+  void StoreSamples(int x, int y, const P& px, int mask)
+  {
+    size_t index = (size_t)y * m_iWidth + x;
+    int32_t& slot = m_SampleIndex[index];
+
+    if(mask == (1 << m_iSamples) - 1)
+    {
+      m_pPixels[index] = px;
+      Collapse(index);
+      return;
+    }
+
+    std::vector<P>& pool = m_SamplePools[(y / TILE_SIZE) * TilesX() + x / TILE_SIZE];
+    if(slot == -1)
+    {
+      slot = (int32_t)pool.size();
+      pool.resize(pool.size() + m_iSamples, m_pPixels[index]);
+    }
+    else if(slot < -1)
+    {
+      slot = -slot - 2;
+      std::fill(pool.begin() + slot, pool.begin() + slot + m_iSamples, m_pPixels[index]);
+    }
+
+    P* samples = pool.data() + slot;
+    for(; mask; mask &= mask - 1) samples[__builtin_ctz(mask)] = px;
+  }
+
+  //depth-tested shading, one tile of the box at a time. Every tile keeps the min/max of the
+  //depths stored in it (hierarchical z): where the triangle's nearest possible depth is not in
+  //front of the tile's farthest, the tile is skipped without visiting a pixel, and where its
+  //farthest is in front of the tile's nearest, the per-pixel comparison is skipped.
+  template<typename D, typename Spans>
+  void ShadeTiles(const TriangleCmd& cmd, const TriangleSetup& s, const Spans& spans)
+  {
+    AttributePlane z = SetupPlane(s, cmd.z[0], cmd.z[1], cmd.z[2]);
+    float zMin = std::fmin(cmd.z[0], std::fmin(cmd.z[1], cmd.z[2]));
+    float zMax = std::fmax(cmd.z[0], std::fmax(cmd.z[1], cmd.z[2]));
+    int tilesX = TilesX();
+
+    for(int ty = s.minY / TILE_SIZE; ty <= s.maxY / TILE_SIZE; ty++)
+    {
+      for(int tx = s.minX / TILE_SIZE; tx <= s.maxX / TILE_SIZE; tx++)
+      {
+        TileRect tile{
+          tx * TILE_SIZE,
+          ty * TILE_SIZE,
+          std::min((tx + 1) * TILE_SIZE, m_iWidth) - 1,
+          std::min((ty + 1) * TILE_SIZE, m_iHeight) - 1
+        };
+
+        TriangleSetup t = s;
+        t.minX = std::max(s.minX, tile.x0);
+        t.minY = std::max(s.minY, tile.y0);
+        t.maxX = std::min(s.maxX, tile.x1);
+        t.maxY = std::min(s.maxY, tile.y1);
+
+        //depth is linear, so over the block it lies between its values at the block corners,
+        //and inside the triangle between the vertex depths
+        float c0 = z.Row(t, t.minY) + z.dx * (float)(t.minX - t.originX);
+        float c1 = z.Row(t, t.minY) + z.dx * (float)(t.maxX - t.originX);
+        float c2 = z.Row(t, t.maxY) + z.dx * (float)(t.minX - t.originX);
+        float c3 = z.Row(t, t.maxY) + z.dx * (float)(t.maxX - t.originX);
+        float lo = std::fmax(zMin, std::fmin(std::fmin(c0, c1), std::fmin(c2, c3)));
+        float hi = std::fmin(zMax, std::fmax(std::fmax(c0, c1), std::fmax(c2, c3)));
+
+        //samples lie up to half a pixel off the centres
+        if(m_iSamples > 1)
+        {
+          float reach = 0.5f * (std::fabs(z.dx) + std::fabs(z.dy));
+          lo = std::fmax(zMin, lo - reach);
+          hi = std::fmin(zMax, hi + reach);
+        }
+
+        //widened so rounding in the span kernels can never land outside the bounds
+        float slack = 1e-5f * (1.0f + std::fabs(lo) + std::fabs(hi));
+        float qlo = (float)DepthTraits<D>::Encode(lo - slack);
+        float qhi = (float)DepthTraits<D>::Encode(hi + slack);
+
+        HiZTile& hiz = m_HiZ[ty * tilesX + tx];
+        if(qlo >= hiz.zmax) continue;
+
+        ShadeBox<D>(t, spans, z, !(qhi < hiz.zmin));
+
+        //stored depths only ever decrease, so the old farthest stays a valid bound. It is
+        //tightened when the triangle covers the whole tile, or rescanned once about a tile's
+        //worth of pixels has been drawn into it.
+        hiz.zmin = std::fmin(hiz.zmin, qlo);
+        if(m_iSamples == 1 && Covers(s, tile))
+        {
+          hiz.zmax = std::fmin(hiz.zmax, qhi);
+        }
+        else
+        {
+          hiz.written += (t.maxX - t.minX + 1) * (t.maxY - t.minY + 1);
+          if(hiz.written >= TILE_SIZE * TILE_SIZE) RefreshHiZ<D>(tile, hiz);
+        }
+      }
+    }
+  }
+
+  //true if every pixel centre of the rectangle is inside the triangle; it is convex, so
+  //checking the corners is enough
+  static bool Covers(const TriangleSetup& s, const TileRect& rect)
+  {
+    for(int i = 0; i < 3; i++)
+    {
+      if(s.Edge(i, rect.x0, rect.y0) < 0 || s.Edge(i, rect.x1, rect.y0) < 0 ||
+        s.Edge(i, rect.x0, rect.y1) < 0 || s.Edge(i, rect.x1, rect.y1) < 0) return false;
+    }
+    return true;
+  }
+
+  //recomputes a tile's depth bounds from the depth buffer
+  template<typename D>
+  void RefreshHiZ(const TileRect& tile, HiZTile& hiz)
+  {
+    float zmin = std::numeric_limits<float>::infinity();
+    float zmax = -std::numeric_limits<float>::infinity();
+
+    //a tile row's samples are consecutive
+    for(int y = tile.y0; y <= tile.y1; y++)
+    {
+      DepthTraits<D>::Bounds(DepthRow<D>(y) + tile.x0 * m_iSamples, (tile.x1 - tile.x0 + 1) * m_iSamples,
+        zmin, zmax);
+    }
+
+    hiz = HiZTile{zmin, zmax, 0};
+  }
+
+  //depth row y; multisampled, pixel x's samples are at [x * m_iSamples, (x + 1) * m_iSamples)
+  template<typename D>
+  D* DepthRow(int y)
+  {
+    if constexpr(std::is_same<D, NoDepth>::value) return nullptr;
+    else return static_cast<D*>(m_pDepth) + (size_t)y * m_iWidth * m_iSamples;
+  }
+
+  size_t DepthBytes()const
+  {
+    size_t texel = m_DepthFormat == DepthFormat::F32 ? sizeof(float) :
+      (m_DepthFormat == DepthFormat::UNORM16 ? sizeof(uint16_t) : 0);
+    return texel * m_iWidth * m_iHeight * m_iSamples;
+  }
+
+  //allocates the depth buffer for the current format and size, contents undefined
+  void AllocDepth()
+  {
+    size_t bytes = DepthBytes();
+    m_pDepth = bytes ? ::operator new(bytes, std::align_val_t(PIXEL_ALIGN)) : nullptr;
+
+    if(bytes) m_HiZ.resize(TilesX() * TilesY());
+    else m_HiZ.clear();
+  }
+
+  void FreeDepth()
+  {
+    if(m_pDepth) ::operator delete(m_pDepth, std::align_val_t(PIXEL_ALIGN));
+    m_pDepth = nullptr;
+  }
+
+  template<typename D>
+  void ClearDepthAs(float depth)
+  {
+    D value = DepthTraits<D>::Encode(depth);
+    FillPixels(static_cast<D*>(m_pDepth), m_iWidth * m_iHeight * m_iSamples, MakeFillPattern(value));
+
+    for(HiZTile& hiz : m_HiZ)
+    {
+      hiz = HiZTile{(float)value, (float)value, 0};
+    }
+  }
+
+  //runs an indexed draw through the vertex stage and primitive assembly, then calls emit(v0, v1,
+  //v2) per surviving triangle with corners of x, y, z, 1/w and N varyings. attribute(i, out)
+  //writes vertex i's varyings; corners the clipper created blend those of their sources.
+  template<int N, typename A, typename E>
+  void AssembleShaded(const Mat4& mvp, const VertexBuffer& vertices, const int* indices, size_t indexCount,
+    A&& attribute, E&& emit)
+  {
+    Viewport vp = Viewport::FromSize((float)m_iWidth, (float)m_iHeight);
+    m_VertexCache.Transform(mvp, vp, vertices, indices, indexCount);
+    m_Assembler.Assemble(mvp, vp, vertices, m_VertexCache, indices, indexCount);
+
+    const std::vector<Vec2>& screen = m_Assembler.Positions();
+    const std::vector<int>& tris = m_Assembler.Indices();
+    const std::vector<ClippedVertex>& clipped = m_Assembler.Clipped();
+    const float* z = m_VertexCache.Vertices().Z();
+    const float* invW = m_VertexCache.Vertices().W();
+    int base = (int)m_VertexCache.Screen().size();
+
+    float v[3][4 + N];
+    float source[N];
+    for(size_t i = 0; i + 2 < tris.size(); i += 3)
+    {
+      for(int k = 0; k < 3; k++)
+      {
+        int index = tris[i + k];
+        v[k][0] = screen[index].X();
+        v[k][1] = screen[index].Y();
+
+        if(index < base)
+        {
+          v[k][2] = z[index];
+          v[k][3] = invW[index];
+          attribute(index, v[k] + 4);
+          continue;
+        }
+
+        const ClippedVertex& c = clipped[index - base];
+        v[k][2] = c.z;
+        v[k][3] = c.invW;
+        for(int n = 0; n < N; n++) v[k][4 + n] = 0.0f;
+        for(int j = 0; j < 3; j++)
+        {
+          attribute(c.source[j], source);
+          for(int n = 0; n < N; n++) v[k][4 + n] += c.weight[j] * source[n];
+        }
+      }
+
+      emit(v[0], v[1], v[2]);
+    }
+  }
+
+  void DrawIndexed(const Mat4& mvp, const VertexBuffer& vertices, const int* indices, size_t indexCount,
+    const P& col, DrawMode mode)
+  {
+    Viewport vp = Viewport::FromSize((float)m_iWidth, (float)m_iHeight);
+    m_VertexCache.Transform(mvp, vp, vertices, indices, indexCount);
+    m_Assembler.Assemble(mvp, vp, vertices, m_VertexCache, indices, indexCount);
+
+    const std::vector<Vec2>& screen = m_Assembler.Positions();
+    const std::vector<int>& tris = m_Assembler.Indices();
+
+    if(mode == DrawMode::WIREFRAME)
+    {
+      CollectEdges(screen, tris, 3);
+      DrawEdges(screen, col);
+    }
+    else
+    {
+      for(size_t i = 0; i + 2 < tris.size(); i += 3)
+      {
+        const Vec2& p0 = screen[tris[i]];
+        const Vec2& p1 = screen[tris[i + 1]];
+        const Vec2& p2 = screen[tris[i + 2]];
+
+        if(m_iThreads > 1)
+        {
+          m_Commands.push_back(TriangleCmd{{p0.X(), p1.X(), p2.X()}, {p0.Y(), p1.Y(), p2.Y()}, {}, {}, 0, 0,
+            col, false, nullptr, nullptr, 0});
+          continue;
+        }
+
+        FillTriangle(p0.X(), p0.Y(), p1.X(), p1.Y(), p2.X(), p2.Y(), col, FullRect());
+      }
+    }
+
+    #ifdef DEBUG
+    std::cout << "Rendered an indexed mesh: " << indexCount / 3 << " triangles, " << tris.size() / 3
+      << " after culling and clipping, " << m_VertexCache.Transformed() << " vertices in the post-transform cache"
+      << std::endl;
+    #endif
+  }
+
+  //fills m_Edges with the sorted, de-duplicated edges of an indexed primitive list: stride 3
+  //for triangles (three edges each), 2 for lines
+  void CollectEdges(const std::vector<Vec2>& positions, const std::vector<int>& indices, int stride);
+
+  //draws all edges in m_Edges, split into horizontal bands across threads for large batches
+  void DrawEdges(const std::vector<Vec2>& positions, const P& col);
+
+  //runs job(0) .. job(count - 1) in parallel on the worker pool, which is started on first use
+  void RunWorkers(int count, const std::function<void(int)>& job)
+  {
+    if(count > 1 && !m_pWorkers) m_pWorkers.reset(new WorkerPool());
+
+    if(m_pWorkers) m_pWorkers->Run(count, job);
+    else if(count == 1) job(0);
+  }
+
+  void DrawLine(float x0, float y0, float x1, float y1, const P& col)
+  {
+    if(!m_Commands.empty()) Flush();
+
+    DrawLine(x0, y0, x1, y1, col, FullRect());
+  }
+
+  //integer bresenham walk over the part of a line inside clip, written straight into m_pPixels
+  void DrawLine(float x0, float y0, float x1, float y1, const P& col, const TileRect& clip)
+  {
+    LineSetup l;
+    if(!SetupLine(x0, y0, x1, y1, clip.x0, clip.y0, clip.x1, clip.y1, m_iWidth, l)) return;
+
+    if(m_bClearPending)
+    {
+      ResolveTiles(
+        (int)std::max((int64_t)clip.x0, std::min(ToPixel(x0), ToPixel(x1))),
+        (int)std::max((int64_t)clip.y0, std::min(ToPixel(y0), ToPixel(y1))),
+        (int)std::min((int64_t)clip.x1, std::max(ToPixel(x0), ToPixel(x1))),
+        (int)std::min((int64_t)clip.y1, std::max(ToPixel(y0), ToPixel(y1))));
+    }
+
+    MarkLineDirty(x0, y0, x1, y1, clip);
+
+    P* px = m_pPixels + l.start;
+    int64_t err = l.err;
+
+    bool samples = m_iSamples > 1;
+    for(int i = 0; i < l.count; i++)
+    {
+      *px = col;
+      if(samples) Collapse(px - m_pPixels);
+      px += l.majorStep;
+
+      err += l.errStep;
+      if(err >= l.errMax)
+      {
+        err -= l.errMax;
+        px += l.minorStep;
+      }
+    }
+  }
+
+  //half-space (edge-function) triangle rasterizer on 28.4 fixed-point vertices with a top-left
+  //fill rule. Walks the bounding box of the triangle clamped to clip and, for every covered pixel,
+  //calls shade(index, l0, l1, l2) with the pixel's index into m_pPixels and its barycentric
+  //weights. Wide triangles solve each row's covered span exactly instead of testing every pixel.
+  //Works for both windings and allocates nothing.
+  template<typename Shader>
+  void RasterizeTriangle(float x0, float y0, float x1, float y1, float x2, float y2,
+    const TileRect& clip, Shader&& shade)
+  {
+    TriangleSetup s;
+    if(!SetupTriangle(x0, y0, x1, y1, x2, y2, clip.x0, clip.y0, clip.x1, clip.y1, s)) return;
+
+    ResolveTiles(s.minX, s.minY, s.maxX, s.maxY);
+    MarkDirty(s.minX, s.minY, s.maxX, s.maxY);
+
+    bool exact = s.maxX - s.minX >= 32;
+
+    for(int y = s.minY; y <= s.maxY; y++)
+    {
+      int xs = s.minX;
+      int xe = s.maxX;
+      if(exact && !s.RowSpan(y, xs, xe)) continue;
+
+      int64_t e0 = s.Edge(0, xs, y);
+      int64_t e1 = s.Edge(1, xs, y);
+      int64_t e2 = s.Edge(2, xs, y);
+      int row = y * m_iWidth;
+
+      for(int x = xs; x <= xe; x++)
+      {
+        if((e0 | e1 | e2) >= 0)
+        {
+          shade(row + x, (float)e0 * s.invArea, (float)e1 * s.invArea, (float)e2 * s.invArea);
+        }
+
+        e0 += s.StepX(0);
+        e1 += s.StepX(1);
+        e2 += s.StepX(2);
+      }
+    }
+  }
   
   int m_iWidth;
   int m_iHeight;
   
-  Color* m_pPixels;
+  P* m_pPixels;
+
+  int m_iThreads;
+
+  //file format written by BlitFramebuffer
+  ImageFormat m_ImageFormat;
+
+  //recorded triangles, the varyings of the shaded ones and their per-tile bins (indices into
+  //m_Commands, in submission order)
+  std::vector<TriangleCmd> m_Commands;
+  std::vector<float> m_Varyings;
+  //bytewise copies of the recorded draws' fragment programs
+  std::vector<unsigned char> m_Programs;
+  std::vector<std::vector<int>> m_Bins;
+
+  //threads that rasterize tiles and line bands, kept between flushes; a copy starts its own
+  std::unique_ptr<WorkerPool> m_pWorkers;
+
+  //fast clear state: the pending clear color and which tiles have not received it yet
+  bool m_bFastClear;
+  bool m_bClearPending;
+  FillPattern m_ClearPattern;
+  std::vector<uint8_t> m_TilePending;
+
+  //optional depth attachment (m_DepthFormat decides the element type) and its per-tile bounds
+  DepthFormat m_DepthFormat;
+  void* m_pDepth;
+  std::vector<HiZTile> m_HiZ;
+
+  //tiles written since the last delta, and the frame that delta left behind as packed rgb
+  //(empty until the first one, which is then a keyframe)
+  std::vector<uint8_t> m_TileDirty;
+  bool m_bDeltaOutput;
+  std::vector<Color> m_PrevFrame;
+
+  //scratch list of batched edges, packed as (min index << 32 | max index), plus the buckets
+  //used to de-duplicate them
+  std::vector<uint64_t> m_Edges;
+  std::vector<int> m_EdgeStart;
+  std::vector<int> m_EdgeFill;
+  std::vector<int> m_EdgeOther;
+
+  //the edges of m_Edges binned by the line bands they cross: band b's are the indices from
+  //m_BandStart[b] to m_BandStart[b + 1] of m_BandEdges
+  std::vector<int> m_BandStart;
+  std::vector<int> m_BandEdges;
+
+  //transformed vertices of the last indexed draws, and the culling / clipping stage after them
+  VertexCache m_VertexCache;
+  PrimitiveAssembler m_Assembler;
+
+  //quads shaded by fragment programs, counted per tile so workers never share a counter
+  std::vector<QuadStats> m_QuadStats;
+
+  //multisampling: samples per pixel and, per pixel, where its samples are kept. A pixel whose
+  //samples all hold one color (-1, or <= -2 keeping storage at -index - 2 for reuse) has it in
+  //m_pPixels; otherwise its m_iSamples colors start at the index into its tile's pool. Pools
+  //are per tile so tile-binned workers never grow a shared one.
+  int m_iSamples;
+  std::vector<int32_t> m_SampleIndex;
+  std::vector<std::vector<P>> m_SamplePools;
 
 };
 
-#endif
+using Framebuffer = TFramebuffer<RGB8>;
+using FramebufferRGBA8 = TFramebuffer<RGBA8>;
+using FramebufferRGB565 = TFramebuffer<RGB565>;
+using FramebufferRGBA32F = TFramebuffer<RGBA32F>;
+
+//the out-of-line members are compiled once per format in Framebuffer.cpp
+extern template class TFramebuffer<RGB8>;
+extern template class TFramebuffer<RGBA8>;
+extern template class TFramebuffer<RGB565>;
+extern template class TFramebuffer<RGBA32F>;
 
+#endif
@@ -0,0 +1,567 @@
+#include "./ImageEncoder.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+
+//runs encode(strip, y0, y1) for every strip of rows, strip 0 on the calling thread
+template<typename Fn>
+static void ForEachStrip(int height, int strips, Fn&& encode)
+{
+  auto worker = [&](int s)
+  {
+    encode(s, (int)((int64_t)height * s / strips), (int)((int64_t)height * (s + 1) / strips));
+  };
+
+  std::vector<std::thread> pool;
+  for(int s = 1; s < strips; s++)
+  {
+    pool.emplace_back(worker, s);
+  }
+
+  worker(0);
+
+  for(std::thread& t : pool)
+  {
+    t.join();
+  }
+}
+
+//strips are a whole number of rows and at least 16 of them, so tiny images stay serial
+static int StripCount(int height, int threads)
+{
+  return std::max(1, std::min(threads, height / 16));
+}
+
+static void PutU32BE(std::vector<uint8_t>& out, uint32_t v)
+{
+  out.push_back((uint8_t)(v >> 24));
+  out.push_back((uint8_t)(v >> 16));
+  out.push_back((uint8_t)(v >> 8));
+  out.push_back((uint8_t)v);
+}
+
+//--------------------------------------------------------------------
+//  PPM
+//--------------------------------------------------------------------
+
+static void EncodePPM(const Color* rgb, int width, int height, std::vector<uint8_t>& out)
+{
+  std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+  size_t bytes = (size_t)width * height * sizeof(Color);
+
+  out.resize(header.size() + bytes);
+  std::memcpy(out.data(), header.data(), header.size());
+  std::memcpy(out.data() + header.size(), rgb, bytes);
+}
+
+//--------------------------------------------------------------------
+//  QOI
+//--------------------------------------------------------------------
+
+//QOI is sequential, but a strip can still start mid-stream: its encoder begins with the
+//previous strip's last pixel as the running pixel and an empty index. The decoder's index is a
+//superset of that (it has seen every earlier pixel), and an empty slot never matches an opaque
+//pixel, so every op the strip emits decodes the same as in a serial encoder.
+struct QoiPixel
+{
+  uint8_t r, g, b, a;
+
+  bool operator==(const QoiPixel& o)const{ return r == o.r && g == o.g && b == o.b && a == o.a; }
+};
+
+static void EncodeQOIStrip(const Color* px, int count, QoiPixel prev, std::vector<uint8_t>& out)
+{
+  QoiPixel index[64] = {};
+  int run = 0;
+
+  out.clear();
+  out.reserve((size_t)count * 2);
+
+  for(int i = 0; i < count; i++)
+  {
+    QoiPixel p{px[i].r, px[i].g, px[i].b, 255};
+
+    if(p == prev)
+    {
+      if(++run == 62)
+      {
+        out.push_back((uint8_t)(0xC0 | (run - 1)));
+        run = 0;
+      }
+      continue;
+    }
+
+    if(run > 0)
+    {
+      out.push_back((uint8_t)(0xC0 | (run - 1)));
+      run = 0;
+    }
+
+    int h = (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+    if(index[h] == p)
+    {
+      out.push_back((uint8_t)h);
+    }
+    else
+    {
+      index[h] = p;
+
+      int8_t dr = (int8_t)(p.r - prev.r);
+      int8_t dg = (int8_t)(p.g - prev.g);
+      int8_t db = (int8_t)(p.b - prev.b);
+      int8_t drg = (int8_t)(dr - dg);
+      int8_t dbg = (int8_t)(db - dg);
+
+      if(dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+      {
+        out.push_back((uint8_t)(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+      }
+      else if(dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+      {
+        out.push_back((uint8_t)(0x80 | (dg + 32)));
+        out.push_back((uint8_t)(((drg + 8) << 4) | (dbg + 8)));
+      }
+      else
+      {
+        out.push_back(0xFE);
+        out.push_back(p.r);
+        out.push_back(p.g);
+        out.push_back(p.b);
+      }
+    }
+
+    prev = p;
+  }
+
+  if(run > 0) out.push_back((uint8_t)(0xC0 | (run - 1)));
+}
+
+static void EncodeQOI(const Color* rgb, int width, int height, int threads, std::vector<uint8_t>& out)
+{
+  int strips = StripCount(height, threads);
+  std::vector<std::vector<uint8_t>> parts(strips);
+
+  ForEachStrip(height, strips, [&](int s, int y0, int y1)
+  {
+    const Color* first = rgb + (size_t)y0 * width;
+    QoiPixel prev{0, 0, 0, 255};
+    if(y0 > 0) prev = QoiPixel{first[-1].r, first[-1].g, first[-1].b, 255};
+
+    EncodeQOIStrip(first, (y1 - y0) * width, prev, parts[s]);
+  });
+
+  out.clear();
+  out.insert(out.end(), {'q', 'o', 'i', 'f'});
+  PutU32BE(out, (uint32_t)width);
+  PutU32BE(out, (uint32_t)height);
+  out.push_back(3);  //channels
+  out.push_back(0);  //sRGB with linear alpha
+
+  for(const std::vector<uint8_t>& part : parts)
+  {
+    out.insert(out.end(), part.begin(), part.end());
+  }
+
+  out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+}
+
+//--------------------------------------------------------------------
+//  PNG
+//--------------------------------------------------------------------
+
+//deflate bit stream, least significant bit first
+struct BitWriter
+{
+  std::vector<uint8_t>& out;
+  uint64_t bits;
+  int count;
+
+  void Put(uint32_t value, int n)
+  {
+    bits |= (uint64_t)value << count;
+    count += n;
+
+    if(count >= 32)
+    {
+      uint8_t b[4] = {(uint8_t)bits, (uint8_t)(bits >> 8), (uint8_t)(bits >> 16), (uint8_t)(bits >> 24)};
+      out.insert(out.end(), b, b + 4);
+      bits >>= 32;
+      count -= 32;
+    }
+  }
+
+  //pads to a byte boundary with zero bits
+  void Align()
+  {
+    while(count > 0)
+    {
+      out.push_back((uint8_t)bits);
+      bits >>= 8;
+      count = count > 8 ? count - 8 : 0;
+    }
+    bits = 0;
+  }
+};
+
+//the fixed huffman code of deflate, bit-reversed for the lsb-first stream
+struct FixedCodes
+{
+  uint16_t litCode[288];
+  uint8_t litBits[288];
+  uint8_t distCode[30];
+
+  FixedCodes()
+  {
+    auto reverse = [](uint32_t code, int n)
+    {
+      uint32_t r = 0;
+      for(int i = 0; i < n; i++)
+      {
+        r = (r << 1) | ((code >> i) & 1);
+      }
+      return (uint16_t)r;
+    };
+
+    for(int s = 0; s < 288; s++)
+    {
+      uint32_t code;
+      int n;
+      if(s < 144){ code = 0x30 + s; n = 8; }
+      else if(s < 256){ code = 0x190 + (s - 144); n = 9; }
+      else if(s < 280){ code = s - 256; n = 7; }
+      else{ code = 0xC0 + (s - 280); n = 8; }
+
+      litCode[s] = reverse(code, n);
+      litBits[s] = (uint8_t)n;
+    }
+
+    for(int d = 0; d < 30; d++)
+    {
+      distCode[d] = (uint8_t)reverse((uint32_t)d, 5);
+    }
+  }
+};
+
+static const FixedCodes& Codes()
+{
+  static const FixedCodes codes;
+  return codes;
+}
+
+static inline int Log2(uint32_t v){ return 31 - __builtin_clz(v); }
+
+static void PutMatch(BitWriter& w, const FixedCodes& fc, int length, int distance)
+{
+  //length 3..258 -> symbols 257..285
+  int l = length - 3;
+  if(length == 258)
+  {
+    w.Put(fc.litCode[285], fc.litBits[285]);
+  }
+  else if(l < 8)
+  {
+    w.Put(fc.litCode[257 + l], fc.litBits[257 + l]);
+  }
+  else
+  {
+    int bits = Log2((uint32_t)l);
+    int top = (l >> (bits - 2)) & 3;
+    int sym = 257 + 4 * (bits - 1) + top;
+    w.Put(fc.litCode[sym], fc.litBits[sym]);
+    w.Put((uint32_t)(l - ((4 | top) << (bits - 2))), bits - 2);
+  }
+
+  //distance 1..32768 -> codes 0..29
+  int d = distance - 1;
+  if(d < 4)
+  {
+    w.Put(fc.distCode[d], 5);
+  }
+  else
+  {
+    int bits = Log2((uint32_t)d);
+    int top = (d >> (bits - 1)) & 1;
+    w.Put(fc.distCode[2 * bits + top], 5);
+    w.Put((uint32_t)(d - ((2 | top) << (bits - 1))), bits - 1);
+  }
+}
+
+static inline uint32_t Load32(const uint8_t* p)
+{
+  uint32_t v;
+  std::memcpy(&v, p, 4);
+  return v;
+}
+
+//compresses data as one fixed-huffman block with a single-probe hash match finder. Matches
+//never reach before data, so strips compress independently. A non-final strip ends with an
+//empty stored block, which byte-aligns it so the next strip's bits can simply be appended.
+static void Deflate(const uint8_t* data, size_t size, bool last, std::vector<uint8_t>& out)
+{
+  const int HASH_BITS = 15;
+  const size_t WINDOW = 32768;
+  const FixedCodes& fc = Codes();
+
+  std::vector<int32_t> table((size_t)1 << HASH_BITS, -1);
+  BitWriter w{out, 0, 0};
+
+  w.Put(last ? 1 : 0, 1);  //BFINAL
+  w.Put(1, 2);             //BTYPE fixed huffman
+
+  size_t i = 0;
+  while(i + 4 <= size)
+  {
+    uint32_t word = Load32(data + i);
+    uint32_t h = (word * 2654435761u) >> (32 - HASH_BITS);
+    int32_t cand = table[h];
+    table[h] = (int32_t)i;
+
+    if(cand >= 0 && i - (size_t)cand <= WINDOW && Load32(data + cand) == word)
+    {
+      size_t max = std::min<size_t>(258, size - i);
+      size_t len = 4;
+      while(len < max)
+      {
+        if(len + 8 > max)
+        {
+          if(data[cand + len] != data[i + len]) break;
+          len++;
+          continue;
+        }
+
+        //8 bytes at a time; the first differing byte is the lowest set byte of the xor
+        uint64_t x, y;
+        std::memcpy(&x, data + cand + len, 8);
+        std::memcpy(&y, data + i + len, 8);
+        if(x != y)
+        {
+          len += (size_t)__builtin_ctzll(x ^ y) / 8;
+          break;
+        }
+        len += 8;
+      }
+
+      PutMatch(w, fc, (int)len, (int)(i - (size_t)cand));
+      i += len;
+    }
+    else
+    {
+      w.Put(fc.litCode[data[i]], fc.litBits[data[i]]);
+      i++;
+    }
+  }
+
+  for(; i < size; i++)
+  {
+    w.Put(fc.litCode[data[i]], fc.litBits[data[i]]);
+  }
+
+  w.Put(fc.litCode[256], fc.litBits[256]);
+
+  if(!last)
+  {
+    w.Put(0, 3);  //BFINAL 0, BTYPE stored
+    w.Align();
+    out.insert(out.end(), {0x00, 0x00, 0xFF, 0xFF});
+  }
+  else
+  {
+    w.Align();
+  }
+}
+
+static uint32_t Adler32(const uint8_t* data, size_t size)
+{
+  const uint32_t BASE = 65521;
+  uint32_t a = 1, b = 0;
+
+  while(size > 0)
+  {
+    //5552 is the most bytes that can be summed before b may overflow 32 bits
+    size_t n = std::min<size_t>(size, 5552);
+    for(size_t i = 0; i < n; i++)
+    {
+      a += data[i];
+      b += a;
+    }
+    a %= BASE;
+    b %= BASE;
+    data += n;
+    size -= n;
+  }
+
+  return (b << 16) | a;
+}
+
+//adler32 of the concatenation of two buffers from their checksums and the second's length
+static uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, size_t len2)
+{
+  const uint32_t BASE = 65521;
+  uint32_t rem = (uint32_t)(len2 % BASE);
+  uint32_t sum1 = adler1 & 0xFFFF;
+  uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % BASE);
+
+  sum1 += (adler2 & 0xFFFF) + BASE - 1;
+  sum2 += ((adler1 >> 16) & 0xFFFF) + ((adler2 >> 16) & 0xFFFF) + BASE - rem;
+  if(sum1 >= BASE) sum1 -= BASE;
+  if(sum1 >= BASE) sum1 -= BASE;
+  if(sum2 >= (BASE << 1)) sum2 -= (BASE << 1);
+  if(sum2 >= BASE) sum2 -= BASE;
+
+  return sum1 | (sum2 << 16);
+}
+
+//running crc32 (pre- and post-inversion are left to the caller)
+static uint32_t Crc32Update(uint32_t crc, const uint8_t* data, size_t size)
+{
+  static const struct Table
+  {
+    uint32_t v[256];
+
+    Table()
+    {
+      for(uint32_t n = 0; n < 256; n++)
+      {
+        uint32_t c = n;
+        for(int k = 0; k < 8; k++)
+        {
+          c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        v[n] = c;
+      }
+    }
+  } table;
+
+  for(size_t i = 0; i < size; i++)
+  {
+    crc = table.v[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+//appends a chunk whose type and data are already laid out in body (type first)
+static void PutChunk(std::vector<uint8_t>& out, const std::vector<uint8_t>& body)
+{
+  PutU32BE(out, (uint32_t)(body.size() - 4));
+  out.insert(out.end(), body.begin(), body.end());
+  PutU32BE(out, Crc32Update(0xFFFFFFFFu, body.data(), body.size()) ^ 0xFFFFFFFFu);
+}
+
+//filters one row with Sub or Up, whichever gives the smaller sum of absolute residuals
+static void FilterRow(const uint8_t* row, const uint8_t* up, int bytes, uint8_t* out)
+{
+  uint32_t sumSub = 0, sumUp = 0;
+  for(int i = 0; i < bytes; i++)
+  {
+    int8_t sub = (int8_t)(row[i] - (i >= 3 ? row[i - 3] : 0));
+    sumSub += (uint32_t)(sub < 0 ? -sub : sub);
+    if(up)
+    {
+      int8_t u = (int8_t)(row[i] - up[i]);
+      sumUp += (uint32_t)(u < 0 ? -u : u);
+    }
+  }
+
+  if(up && sumUp < sumSub)
+  {
+    out[0] = 2;
+    for(int i = 0; i < bytes; i++) out[i + 1] = (uint8_t)(row[i] - up[i]);
+  }
+  else
+  {
+    out[0] = 1;
+    for(int i = 0; i < bytes; i++) out[i + 1] = (uint8_t)(row[i] - (i >= 3 ? row[i - 3] : 0));
+  }
+}
+
+static void EncodePNG(const Color* rgb, int width, int height, int threads, std::vector<uint8_t>& out)
+{
+  int strips = StripCount(height, threads);
+  int rowBytes = width * 3;
+
+  //each strip becomes its own IDAT chunk; the zlib header goes in front of the first one and
+  //the adler32 of the whole stream after the last
+  std::vector<std::vector<uint8_t>> chunks(strips);
+  std::vector<uint32_t> adler(strips);
+  std::vector<size_t> filteredSize(strips);
+
+  ForEachStrip(height, strips, [&](int s, int y0, int y1)
+  {
+    std::vector<uint8_t> filtered((size_t)(y1 - y0) * (rowBytes + 1));
+    for(int y = y0; y < y1; y++)
+    {
+      const uint8_t* row = reinterpret_cast<const uint8_t*>(rgb + (size_t)y * width);
+      FilterRow(row, y > 0 ? row - rowBytes : nullptr, rowBytes,
+        filtered.data() + (size_t)(y - y0) * (rowBytes + 1));
+    }
+
+    std::vector<uint8_t>& chunk = chunks[s];
+    chunk = {'I', 'D', 'A', 'T'};
+    if(s == 0) chunk.insert(chunk.end(), {0x78, 0x01});
+
+    Deflate(filtered.data(), filtered.size(), s == strips - 1, chunk);
+
+    adler[s] = Adler32(filtered.data(), filtered.size());
+    filteredSize[s] = filtered.size();
+  });
+
+  uint32_t total = adler[0];
+  for(int s = 1; s < strips; s++)
+  {
+    total = Adler32Combine(total, adler[s], filteredSize[s]);
+  }
+  PutU32BE(chunks[strips - 1], total);
+
+  out.clear();
+  out.insert(out.end(), {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'});
+
+  std::vector<uint8_t> ihdr = {'I', 'H', 'D', 'R'};
+  PutU32BE(ihdr, (uint32_t)width);
+  PutU32BE(ihdr, (uint32_t)height);
+  ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0});  //8-bit rgb, deflate, adaptive filtering, no interlace
+  PutChunk(out, ihdr);
+
+  for(const std::vector<uint8_t>& chunk : chunks)
+  {
+    PutChunk(out, chunk);
+  }
+
+  PutChunk(out, {'I', 'E', 'N', 'D'});
+}
+
+//--------------------------------------------------------------------
+
+const char* ImageExtension(ImageFormat format)
+{
+  switch(format)
+  {
+    case ImageFormat::QOI:
+      return "qoi";
+    case ImageFormat::PNG:
+      return "png";
+
+    default:
+      return "ppm";
+  }
+}
+
+void EncodeImage(ImageFormat format, const Color* rgb, int width, int height, int threads,
+  std::vector<uint8_t>& out)
+{
+  if(threads < 1) threads = 1;
+
+  switch(format)
+  {
+    case ImageFormat::QOI:
+      EncodeQOI(rgb, width, height, threads, out);
+      break;
+    case ImageFormat::PNG:
+      EncodePNG(rgb, width, height, threads, out);
+      break;
+
+    default:
+      EncodePPM(rgb, width, height, out);
+      break;
+  }
+}
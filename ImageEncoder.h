@@ -0,0 +1,35 @@
+#ifndef TINYRASTER_IMAGEENCODER_H
+#define TINYRASTER_IMAGEENCODER_H
+//--------------------------------------------------------------------
+//
+//  Name: ImageEncoder.h
+//
+//  Desc: Built-in encoders for frame output: uncompressed PPM, QOI
+//  and PNG with a fast single-probe deflate. QOI and PNG split the
+//  image into horizontal strips that are encoded on separate threads
+//  and joined into one valid file.
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <cstdint>
+#include <vector>
+#include "./Color.h"
+
+enum class ImageFormat
+{
+  PPM,
+  QOI,
+  PNG
+};
+
+//file extension (without the dot) used for frames of a format
+const char* ImageExtension(ImageFormat format);
+
+//encodes width x height packed 24-bit rgb pixels as a complete file into out, replacing its
+//contents. threads is the number of strips encoded in parallel (1 encodes on the calling thread).
+void EncodeImage(ImageFormat format, const Color* rgb, int width, int height, int threads,
+  std::vector<uint8_t>& out);
+
+#endif
@@ -5,15 +5,75 @@
 //  Name: Math.h
 //
 //  Desc: Header only math library for TinyRaster. Includes vec2, vec3,
-//  vec4 and mat4 classes and implementation.
+//  vec4 and mat4 classes and implementation. Vec4 and Mat4 are 16-byte
+//  aligned and their products, transpose and inverse use SSE when the
+//  compiler targets SSE3 (mat x mat uses AVX when available). All
+//  types are trivially copyable and usable in constant expressions;
+//  Mat4 has constexpr projection, viewport and view builders.
 //
 //  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
 //
 //--------------------------------------------------------------------
 #include <cmath>
 #include <iostream>
+#include <limits>
 #include <vector>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE3__)
+#include <pmmintrin.h>
+#endif
+
+//-------------------------------------constexpr helpers-----------------------------------------
+
+//true while the calling constexpr function is evaluated at compile time; the SIMD paths are
+//only taken at run time (std::is_constant_evaluated is C++20)
+constexpr bool IsConstantEvaluated()
+{
+  return __builtin_is_constant_evaluated();
+}
+
+//std::sqrt at run time; Newton's iteration, from above, in a constant expression
+constexpr double ConstexprSqrt(double x)
+{
+  if(!IsConstantEvaluated()) return std::sqrt(x);
+
+  if(x < 0.0 || x != x) return std::numeric_limits<double>::quiet_NaN();
+  if(x == 0.0 || x == std::numeric_limits<double>::infinity()) return x;
+
+  double y = x > 1.0 ? x : 1.0;
+  while(true)
+  {
+    double next = 0.5 * (y + x / y);
+    if(next >= y) return y;
+    y = next;
+  }
+}
+
+//std::tan at run time; in a constant expression the argument is reduced to [-pi/2, pi/2] and
+//sin / cos are summed as Taylor series
+constexpr double ConstexprTan(double x)
+{
+  if(!IsConstantEvaluated()) return std::tan(x);
+
+  const double pi = 3.14159265358979323846;
+  double k = x / pi;
+  x -= pi * (double)(long long)(k < 0.0 ? k - 0.5 : k + 0.5);
+
+  //term = x^i / i!, added to cos for even i and to sin for odd i with alternating signs
+  double s = 0.0, c = 0.0, term = 1.0;
+  for(int i = 0; i < 30; i++)
+  {
+    double signedTerm = (i / 2) % 2 ? -term : term;
+    if(i % 2) s += signedTerm;
+    else c += signedTerm;
+    term *= x / (i + 1);
+  }
+
+  return s / c;
+}
+
 class Vec2
 {
   
@@ -22,80 +82,64 @@ public:
   class Invalid{};
 
   //constructors for the vec2 class
-  Vec2() : m_fX(0.0f),
+  constexpr Vec2() : m_fX(0.0f),
            m_fY(0.0f)
   {}
 
-  Vec2(float x, float y) : m_fX(x),
+  constexpr Vec2(float x, float y) : m_fX(x),
                            m_fY(y)
   {}
 
   //destructor for the vec2 class
   ~Vec2()=default;
 
-  //copy constructor and assignment for vec2 class
-  Vec2(const Vec2& other) : m_fX(other.m_fX),
-                            m_fY(other.m_fY)
-  {}
-  
-  Vec2& operator=(const Vec2& other)
-  {
-    if(this == &other)
-    {
-      return *this;
-    }
-
-    m_fX = other.m_fX;
-    m_fY = other.m_fY;
-
-    return *this;
-  }
-  
-  //move constructor and assignment operator not required as we are not allocating anything
-  //on the heap memory.
+  //copy constructor and assignment for vec2 class, defaulted so that it stays trivially
+  //copyable (memcpy into batches) and usable in constant expressions
+  Vec2(const Vec2& other)=default;
+  Vec2& operator=(const Vec2& other)=default;
   
   //getters and setters
-  float X()const{ return m_fX; }
-  float Y()const{ return m_fY; }
+  constexpr float X()const{ return m_fX; }
+  constexpr float Y()const{ return m_fY; }
   
   //getters for returning truncated x and y values
-  int iX()const{return (int)m_fX; }
-  int iY()const{return (int)m_fY; }
+  constexpr int iX()const{return (int)m_fX; }
+  constexpr int iY()const{return (int)m_fY; }
 
-  void X(float x){ m_fX = x; }
-  void Y(float y){ m_fY = y; }
+  constexpr void X(float x){ m_fX = x; }
+  constexpr void Y(float y){ m_fY = y; }
 
   //arithmetic operations
   
   //addition operations
-  Vec2 operator+(const Vec2& other)const{ return Vec2(m_fX + other.m_fX, m_fY + other.m_fY); }
-  Vec2& operator+=(const Vec2& other){ m_fX += other.m_fX; m_fY += other.m_fY; return *this;}
+  constexpr Vec2 operator+(const Vec2& other)const{ return Vec2(m_fX + other.m_fX, m_fY + other.m_fY); }
+  constexpr Vec2& operator+=(const Vec2& other){ m_fX += other.m_fX; m_fY += other.m_fY; return *this;}
 
   //subtraction operations
-  Vec2 operator-(const Vec2& other)const{ return Vec2(m_fX - other.m_fX, m_fY - other.m_fY); }
-  Vec2& operator-=(const Vec2& other){ m_fX -= other.m_fX; m_fY -= other.m_fY; return *this;}
+  constexpr Vec2 operator-(const Vec2& other)const{ return Vec2(m_fX - other.m_fX, m_fY - other.m_fY); }
+  constexpr Vec2& operator-=(const Vec2& other){ m_fX -= other.m_fX; m_fY -= other.m_fY; return *this;}
 
   //scalar multiplications
-  Vec2 operator*(float val)const{ return Vec2(m_fX * val, m_fY * val); }
-  Vec2 operator*=(float val){ m_fX *= val; m_fY *= val; return *this;}
+  constexpr Vec2 operator*(float val)const{ return Vec2(m_fX * val, m_fY * val); }
+  constexpr Vec2 operator*=(float val){ m_fX *= val; m_fY *= val; return *this;}
 
   //vector-vector multiplications
-  Vec2 operator*(const Vec2& other)const{ return Vec2(m_fX * other.m_fX, m_fY * other.m_fY); }
-  Vec2& operator*=(const Vec2& other){ m_fX *= other.m_fX; m_fY *= other.m_fY; return *this; }
+  constexpr Vec2 operator*(const Vec2& other)const{ return Vec2(m_fX * other.m_fX, m_fY * other.m_fY); }
+  constexpr Vec2& operator*=(const Vec2& other){ m_fX *= other.m_fX; m_fY *= other.m_fY; return *this; }
 
   //scalar division operations
-  Vec2 operator/(float val)const{ return Vec2(m_fX / val, m_fY / val); }
-  Vec2& operator/=(float val){ m_fX /= val; m_fY /= val; return *this; }
+  constexpr Vec2 operator/(float val)const{ return Vec2(m_fX / val, m_fY / val); }
+  constexpr Vec2& operator/=(float val){ m_fX /= val; m_fY /= val; return *this; }
 
   //vector-vector divisions
-  Vec2 operator/(const Vec2& other)const{ return Vec2(m_fX / other.m_fX, m_fY / other.m_fY); }
-  Vec2& operator/=(const Vec2& other){ m_fX /= other.m_fX; m_fY /= other.m_fY; return *this; }
+  constexpr Vec2 operator/(const Vec2& other)const{ return Vec2(m_fX / other.m_fX, m_fY / other.m_fY); }
+  constexpr Vec2& operator/=(const Vec2& other){ m_fX /= other.m_fX; m_fY /= other.m_fY; return *this; }
 
   //dot-product method
-  float Dot(const Vec2& other)const { return ((m_fX * other.m_fX) + (m_fY * other.m_fY)); }
+  constexpr float Dot(const Vec2& other)const { return ((m_fX * other.m_fX) + (m_fY * other.m_fY)); }
   
   //operator overloading for indexing vec2
-  float operator[](int index)
+  constexpr float operator[](int index)const
   {
     switch(index)
     {
@@ -125,12 +169,12 @@ public:
   class Invalid{};
 
   //constructors for the vec3 class
-  Vec3() : m_fX(0.0f),
+  constexpr Vec3() : m_fX(0.0f),
            m_fY(0.0f),
            m_fZ(0.0f)
   {}
 
-  Vec3(float x, float y, float z) : m_fX(x),
+  constexpr Vec3(float x, float y, float z) : m_fX(x),
                            m_fY(y),
                            m_fZ(z)
   {}
@@ -138,83 +182,64 @@ public:
   //destructor for the vec3 class
   ~Vec3()=default;
 
-  //copy constructor and assignment for vec3 class
-  Vec3(const Vec3& other) : m_fX(other.m_fX),
-                            m_fY(other.m_fY),
-                            m_fZ(other.m_fZ)
-  {}
-  
-  Vec3& operator=(const Vec3& other)
-  {
-    if(this == &other)
-    {
-      return *this;
-    }
-
-    m_fX = other.m_fX;
-    m_fY = other.m_fY;
-    m_fZ = other.m_fZ;
-
-    return *this;
-  }
-  
-  //move constructor and assignment operator not required as we are not allocating anything
-  //on the heap memory.
+  //copy constructor and assignment for vec3 class (trivial, as for vec2)
+  Vec3(const Vec3& other)=default;
+  Vec3& operator=(const Vec3& other)=default;
   
   //getters and setters
-  float X()const{ return m_fX; }
-  float Y()const{ return m_fY; }
-  float Z()const{ return m_fZ; }
+  constexpr float X()const{ return m_fX; }
+  constexpr float Y()const{ return m_fY; }
+  constexpr float Z()const{ return m_fZ; }
   
-  Vec2 XY()const{ return Vec2(m_fX, m_fY); }
-  Vec2 YX()const{ return Vec2(m_fY, m_fX); }
-  Vec2 YZ()const{ return Vec2(m_fY, m_fZ); }
-  Vec2 ZY()const{ return Vec2(m_fZ, m_fY); }
-  Vec2 XZ()const{ return Vec2(m_fX, m_fZ); }
-  Vec2 ZX()const{ return Vec2(m_fZ, m_fX); }
+  constexpr Vec2 XY()const{ return Vec2(m_fX, m_fY); }
+  constexpr Vec2 YX()const{ return Vec2(m_fY, m_fX); }
+  constexpr Vec2 YZ()const{ return Vec2(m_fY, m_fZ); }
+  constexpr Vec2 ZY()const{ return Vec2(m_fZ, m_fY); }
+  constexpr Vec2 XZ()const{ return Vec2(m_fX, m_fZ); }
+  constexpr Vec2 ZX()const{ return Vec2(m_fZ, m_fX); }
 
   //getters for returning truncated x, y and z values
-  int iX()const{ return (int)m_fX; }
-  int iY()const{ return (int)m_fY; }
-  int iZ()const{ return (int)m_fZ; }
+  constexpr int iX()const{ return (int)m_fX; }
+  constexpr int iY()const{ return (int)m_fY; }
+  constexpr int iZ()const{ return (int)m_fZ; }
 
-  void X(float x){ m_fX = x; }
-  void Y(float y){ m_fY = y; }
-  void Z(float z){ m_fZ = z; }
+  constexpr void X(float x){ m_fX = x; }
+  constexpr void Y(float y){ m_fY = y; }
+  constexpr void Z(float z){ m_fZ = z; }
 
   //arithmetic operations
   
   //addition operations
-  Vec3 operator+(const Vec3& other)const{ return Vec3(m_fX + other.m_fX, m_fY + other.m_fY, m_fZ + other.m_fZ); }
-  Vec3& operator+=(const Vec3& other){ m_fX += other.m_fX; m_fY += other.m_fY; m_fZ += other.m_fZ; return *this;}
+  constexpr Vec3 operator+(const Vec3& other)const{ return Vec3(m_fX + other.m_fX, m_fY + other.m_fY, m_fZ + other.m_fZ); }
+  constexpr Vec3& operator+=(const Vec3& other){ m_fX += other.m_fX; m_fY += other.m_fY; m_fZ += other.m_fZ; return *this;}
 
   //subtraction operations
-  Vec3 operator-(const Vec3& other)const{ return Vec3(m_fX - other.m_fX, m_fY - other.m_fY, m_fZ - other.m_fZ); }
-  Vec3& operator-=(const Vec3& other){ m_fX -= other.m_fX; m_fY -= other.m_fY; m_fZ -= other.m_fZ; return *this;}
+  constexpr Vec3 operator-(const Vec3& other)const{ return Vec3(m_fX - other.m_fX, m_fY - other.m_fY, m_fZ - other.m_fZ); }
+  constexpr Vec3& operator-=(const Vec3& other){ m_fX -= other.m_fX; m_fY -= other.m_fY; m_fZ -= other.m_fZ; return *this;}
   
   //scalar multiplications
-  Vec3 operator*(float val)const{ return Vec3(m_fX * val, m_fY * val, m_fZ * val); }
-  Vec3 operator*=(float val){ m_fX *= val; m_fY *= val; m_fZ *= val; return *this;}
+  constexpr Vec3 operator*(float val)const{ return Vec3(m_fX * val, m_fY * val, m_fZ * val); }
+  constexpr Vec3 operator*=(float val){ m_fX *= val; m_fY *= val; m_fZ *= val; return *this;}
 
   //vector-vector multiplications
-  Vec3 operator*(const Vec3& other)const{ return Vec3(m_fX * other.m_fX, m_fY * other.m_fY, m_fZ * other.m_fZ); }
-  Vec3& operator*=(const Vec3& other){ m_fX *= other.m_fX; m_fY *= other.m_fY; m_fZ *= other.m_fZ; return *this; }
+  constexpr Vec3 operator*(const Vec3& other)const{ return Vec3(m_fX * other.m_fX, m_fY * other.m_fY, m_fZ * other.m_fZ); }
+  constexpr Vec3& operator*=(const Vec3& other){ m_fX *= other.m_fX; m_fY *= other.m_fY; m_fZ *= other.m_fZ; return *this; }
 
   //scalar division operations
-  Vec3 operator/(float val)const{ return Vec3(m_fX / val, m_fY / val, m_fZ / val); }
-  Vec3& operator/=(float val){ m_fX /= val; m_fY /= val; m_fZ /= val; return *this; }
+  constexpr Vec3 operator/(float val)const{ return Vec3(m_fX / val, m_fY / val, m_fZ / val); }
+  constexpr Vec3& operator/=(float val){ m_fX /= val; m_fY /= val; m_fZ /= val; return *this; }
 
   //vector-vector divisions
-  Vec3 operator/(const Vec3& other)const{ return Vec3(m_fX / other.m_fX, m_fY / other.m_fY, m_fZ / other.m_fZ); }
-  Vec3& operator/=(const Vec3& other){ m_fX /= other.m_fX; m_fY /= other.m_fY; m_fZ /= other.m_fZ; return *this; }
+  constexpr Vec3 operator/(const Vec3& other)const{ return Vec3(m_fX / other.m_fX, m_fY / other.m_fY, m_fZ / other.m_fZ); }
+  constexpr Vec3& operator/=(const Vec3& other){ m_fX /= other.m_fX; m_fY /= other.m_fY; m_fZ /= other.m_fZ; return *this; }
 
   //dot-product method
-  float Dot(const Vec3& other)const { return ((m_fX * other.m_fX) + (m_fY * other.m_fY) + (m_fZ * other.m_fZ)); }
+  constexpr float Dot(const Vec3& other)const { return ((m_fX * other.m_fX) + (m_fY * other.m_fY) + (m_fZ * other.m_fZ)); }
   
   //cross-product method
-  Vec3 Cross(const Vec3& other)const { return Vec3(((m_fY * other.m_fZ) - (m_fZ * other.m_fY)), ((m_fZ * other.m_fX) - (m_fX * other.m_fZ)), ((m_fX * other.m_fY) - (m_fY * other.m_fX))); }
+  constexpr Vec3 Cross(const Vec3& other)const { return Vec3(((m_fY * other.m_fZ) - (m_fZ * other.m_fY)), ((m_fZ * other.m_fX) - (m_fX * other.m_fZ)), ((m_fX * other.m_fY) - (m_fY * other.m_fX))); }
   //operator overloading for indexing vec2
-  float operator[](int index)
+  constexpr float operator[](int index)const
   {
     switch(index)
     {
@@ -238,26 +263,26 @@ private:
   float m_fZ;
 };
 
-class Vec4{
+class alignas(16) Vec4{
   
 public:
   //empty invalid class for error handling 
   class Invalid{};
 
   //constructors for the vec3 class
-  Vec4() : m_fX(0.0f),
+  constexpr Vec4() : m_fX(0.0f),
            m_fY(0.0f),
            m_fZ(0.0f),
            m_fW(1.0f)
   {}
 
-  Vec4(float x, float y, float z, float w) : m_fX(x),
+  constexpr Vec4(float x, float y, float z, float w) : m_fX(x),
                            m_fY(y),
                            m_fZ(z),
                            m_fW(w)
   {}
   
-  Vec4(const Vec3& v, float w) : m_fX(v.X()),
+  constexpr Vec4(const Vec3& v, float w) : m_fX(v.X()),
                                  m_fY(v.Y()),
                                  m_fZ(v.Z()),
                                  m_fW(w)
@@ -266,99 +291,78 @@ public:
   //destructor for the vec3 class
   ~Vec4()=default;
 
-  //copy constructor and assignment for vec3 class
-  Vec4(const Vec4& other) : m_fX(other.m_fX),
-                            m_fY(other.m_fY),
-                            m_fZ(other.m_fZ),
-                            m_fW(other.m_fW)
-  {}
-  
-  Vec4& operator=(const Vec4& other)
-  {
-    if(this == &other)
-    {
-      return *this;
-    }
-
-    m_fX = other.m_fX;
-    m_fY = other.m_fY;
-    m_fZ = other.m_fZ;
-    m_fW = other.m_fW;
-
-    return *this;
-  }
-  
-  //move constructor and assignment operator not required as we are not allocating anything
-  //on the heap memory.
+  //copy constructor and assignment for vec4 class (trivial, as for vec2)
+  Vec4(const Vec4& other)=default;
+  Vec4& operator=(const Vec4& other)=default;
   
   //getters and setters
-  float X()const{ return m_fX; }
-  float Y()const{ return m_fY; }
-  float Z()const{ return m_fZ; }
-  float W()const{ return m_fW; }
-  
-  Vec2 XY()const{ return Vec2(m_fX, m_fY); }
-  Vec2 YX()const{ return Vec2(m_fY, m_fX); }
-  Vec2 YZ()const{ return Vec2(m_fY, m_fZ); }
-  Vec2 ZY()const{ return Vec2(m_fZ, m_fY); }
-  Vec2 XZ()const{ return Vec2(m_fX, m_fZ); }
-  Vec2 ZX()const{ return Vec2(m_fZ, m_fX); }
-  Vec2 XW()const{ return Vec2(m_fX, m_fW); }
-  Vec2 WX()const{ return Vec2(m_fW, m_fX); }
-  Vec2 YW()const{ return Vec2(m_fY, m_fW); }
-  Vec2 WY()const{ return Vec2(m_fW, m_fY); }
-  Vec2 ZW()const{ return Vec2(m_fZ, m_fW); }
-  Vec2 WZ()const{ return Vec2(m_fW, m_fZ); }
-
-  Vec3 XYZ()const{ return Vec3(m_fX, m_fY, m_fZ); }
-  Vec3 XZY()const{ return Vec3(m_fX, m_fZ, m_fY); }
-  Vec3 YXZ()const{ return Vec3(m_fY, m_fX, m_fZ); }
-  Vec3 YZX()const{ return Vec3(m_fY, m_fZ, m_fX); }
-  Vec3 ZXY()const{ return Vec3(m_fZ, m_fX, m_fY); }
-  Vec3 ZYX()const{ return Vec3(m_fZ, m_fY, m_fX); }
+  constexpr float X()const{ return m_fX; }
+  constexpr float Y()const{ return m_fY; }
+  constexpr float Z()const{ return m_fZ; }
+  constexpr float W()const{ return m_fW; }
+  
+  constexpr Vec2 XY()const{ return Vec2(m_fX, m_fY); }
+  constexpr Vec2 YX()const{ return Vec2(m_fY, m_fX); }
+  constexpr Vec2 YZ()const{ return Vec2(m_fY, m_fZ); }
+  constexpr Vec2 ZY()const{ return Vec2(m_fZ, m_fY); }
+  constexpr Vec2 XZ()const{ return Vec2(m_fX, m_fZ); }
+  constexpr Vec2 ZX()const{ return Vec2(m_fZ, m_fX); }
+  constexpr Vec2 XW()const{ return Vec2(m_fX, m_fW); }
+  constexpr Vec2 WX()const{ return Vec2(m_fW, m_fX); }
+  constexpr Vec2 YW()const{ return Vec2(m_fY, m_fW); }
+  constexpr Vec2 WY()const{ return Vec2(m_fW, m_fY); }
+  constexpr Vec2 ZW()const{ return Vec2(m_fZ, m_fW); }
+  constexpr Vec2 WZ()const{ return Vec2(m_fW, m_fZ); }
+
+  constexpr Vec3 XYZ()const{ return Vec3(m_fX, m_fY, m_fZ); }
+  constexpr Vec3 XZY()const{ return Vec3(m_fX, m_fZ, m_fY); }
+  constexpr Vec3 YXZ()const{ return Vec3(m_fY, m_fX, m_fZ); }
+  constexpr Vec3 YZX()const{ return Vec3(m_fY, m_fZ, m_fX); }
+  constexpr Vec3 ZXY()const{ return Vec3(m_fZ, m_fX, m_fY); }
+  constexpr Vec3 ZYX()const{ return Vec3(m_fZ, m_fY, m_fX); }
   
   //getters for returning truncated x, y and z values
-  int iX()const{ return (int)m_fX; }
-  int iY()const{ return (int)m_fY; }
-  int iZ()const{ return (int)m_fZ; }
-  int iW()const{ return (int)m_fW; }
+  constexpr int iX()const{ return (int)m_fX; }
+  constexpr int iY()const{ return (int)m_fY; }
+  constexpr int iZ()const{ return (int)m_fZ; }
+  constexpr int iW()const{ return (int)m_fW; }
 
-  void X(float x){ m_fX = x; }
-  void Y(float y){ m_fY = y; }
-  void Z(float z){ m_fZ = z; }
-  void W(float w){ m_fW = w; }
+  constexpr void X(float x){ m_fX = x; }
+  constexpr void Y(float y){ m_fY = y; }
+  constexpr void Z(float z){ m_fZ = z; }
+  constexpr void W(float w){ m_fW = w; }
 
   //arithmetic operations
   
   //addition operations
-  Vec4 operator+(const Vec4& other)const{ return Vec4(m_fX + other.m_fX, m_fY + other.m_fY, m_fZ + other.m_fZ, m_fW + other.m_fW); }
-  Vec4& operator+=(const Vec4& other){ m_fX += other.m_fX; m_fY += other.m_fY; m_fZ += other.m_fZ; m_fW += other.m_fW; return *this;}
+  constexpr Vec4 operator+(const Vec4& other)const{ return Vec4(m_fX + other.m_fX, m_fY + other.m_fY, m_fZ + other.m_fZ, m_fW + other.m_fW); }
+  constexpr Vec4& operator+=(const Vec4& other){ m_fX += other.m_fX; m_fY += other.m_fY; m_fZ += other.m_fZ; m_fW += other.m_fW; return *this;}
 
   //subtraction operations
-  Vec4 operator-(const Vec4& other)const{ return Vec4(m_fX - other.m_fX, m_fY - other.m_fY, m_fZ - other.m_fZ, m_fW - other.m_fW); }
-  Vec4& operator-=(const Vec4& other){ m_fX -= other.m_fX; m_fY -= other.m_fY; m_fZ -= other.m_fZ; m_fW -= other.m_fW; return *this;}
+  constexpr Vec4 operator-(const Vec4& other)const{ return Vec4(m_fX - other.m_fX, m_fY - other.m_fY, m_fZ - other.m_fZ, m_fW - other.m_fW); }
+  constexpr Vec4& operator-=(const Vec4& other){ m_fX -= other.m_fX; m_fY -= other.m_fY; m_fZ -= other.m_fZ; m_fW -= other.m_fW; return *this;}
   
   //scalar multiplications
-  Vec4 operator*(float val)const{ return Vec4(m_fX * val, m_fY * val, m_fZ * val, m_fW * val); }
-  Vec4 operator*=(float val){ m_fX *= val; m_fY *= val; m_fZ *= val; m_fW *= val; return *this;}
+  constexpr Vec4 operator*(float val)const{ return Vec4(m_fX * val, m_fY * val, m_fZ * val, m_fW * val); }
+  constexpr Vec4 operator*=(float val){ m_fX *= val; m_fY *= val; m_fZ *= val; m_fW *= val; return *this;}
 
   //vector-vector multiplications
-  Vec4 operator*(const Vec4& other)const{ return Vec4(m_fX * other.m_fX, m_fY * other.m_fY, m_fZ * other.m_fZ, m_fW * other.m_fW); }
-  Vec4& operator*=(const Vec4& other){ m_fX *= other.m_fX; m_fY *= other.m_fY; m_fZ *= other.m_fZ; m_fW *= other.m_fW; return *this; }
+  constexpr Vec4 operator*(const Vec4& other)const{ return Vec4(m_fX * other.m_fX, m_fY * other.m_fY, m_fZ * other.m_fZ, m_fW * other.m_fW); }
+  constexpr Vec4& operator*=(const Vec4& other){ m_fX *= other.m_fX; m_fY *= other.m_fY; m_fZ *= other.m_fZ; m_fW *= other.m_fW; return *this; }
 
   //scalar division operations
-  Vec4 operator/(float val)const{ return Vec4(m_fX / val, m_fY / val, m_fZ / val, m_fW / val); }
-  Vec4& operator/=(float val){ m_fX /= val; m_fY /= val; m_fZ /= val; m_fW /= val; return *this; }
+  constexpr Vec4 operator/(float val)const{ return Vec4(m_fX / val, m_fY / val, m_fZ / val, m_fW / val); }
+  constexpr Vec4& operator/=(float val){ m_fX /= val; m_fY /= val; m_fZ /= val; m_fW /= val; return *this; }
 
   //vector-vector divisions
-  Vec4 operator/(const Vec4& other)const{ return Vec4(m_fX / other.m_fX, m_fY / other.m_fY, m_fZ / other.m_fZ, m_fW / other.m_fW); }
-  Vec4& operator/=(const Vec4& other){ m_fX /= other.m_fX; m_fY /= other.m_fY; m_fZ /= other.m_fZ; m_fW /= other.m_fW; return *this; }
+  constexpr Vec4 operator/(const Vec4& other)const{ return Vec4(m_fX / other.m_fX, m_fY / other.m_fY, m_fZ / other.m_fZ, m_fW / other.m_fW); }
+  constexpr Vec4& operator/=(const Vec4& other){ m_fX /= other.m_fX; m_fY /= other.m_fY; m_fZ /= other.m_fZ; m_fW /= other.m_fW; return *this; }
 
   //dot-product method
-  float Dot(const Vec4& other)const { return ((m_fX * other.m_fX) + (m_fY * other.m_fY) + (m_fZ * other.m_fZ) + (m_fW * other.m_fW)); }
+  constexpr float Dot(const Vec4& other)const { return ((m_fX * other.m_fX) + (m_fY * other.m_fY) + (m_fZ * other.m_fZ) + (m_fW * other.m_fW)); }
   
   //operator overloading for indexing vec2
-  float operator[](int index)
+  constexpr float operator[](int index)const
   {
     switch(index)
     {
@@ -383,9 +387,15 @@ private:
   float m_fY;
   float m_fZ;
   float m_fW;
+
+  friend class Mat4;
 };
 
-class Mat4
+//defined with the vec3 methods below, used by Mat4::LookAt
+constexpr Vec3 Normalize(const Vec3& v);
+
+//row-major 4x4 matrix: m_Mat[row][column], each row 16-byte aligned
+class alignas(16) Mat4
 {
 
 public:
@@ -394,116 +404,402 @@ public:
 
   float m_Mat[4][4];
   
-  Mat4()
+  constexpr Mat4() : Mat4(1.0f) {}
+ 
+  constexpr Mat4(float t) : m_Mat{{t, 0.0f, 0.0f, 0.0f},
+                                  {0.0f, t, 0.0f, 0.0f},
+                                  {0.0f, 0.0f, t, 0.0f},
+                                  {0.0f, 0.0f, 0.0f, t}}
+  {}
+
+  ~Mat4() = default;
+  
+  //copy constructor and copy assignment, trivial: the compiler copies whole rows (or row
+  //pairs) per register, which is what a matrix just written by the SIMD products needs
+  Mat4(const Mat4& other) = default;
+  Mat4& operator=(const Mat4& other) = default;
+
+  constexpr Vec4 GetRow(int index)const
   {
-    for(int i = 0; i < 4; i++)
-    {
-      for(int j = 0; j < 4; j++)
-      {
-        if(i == j) m_Mat[i][j] = 1.0f;
-        else m_Mat[i][j] = 0.0f;
-      }
-    }
+    if(index < 0 || index > 3) throw Invalid{};
+
+    return Vec4(m_Mat[index][0], m_Mat[index][1], m_Mat[index][2], m_Mat[index][3]);
   }
- 
-  Mat4(float t)
+  
+  constexpr Vec4 GetColumn(int index)const
+  {
+    if(index < 0 || index > 3) throw Invalid{};
+
+    return Vec4(m_Mat[0][index], m_Mat[1][index], m_Mat[2][index], m_Mat[3][index]);
+  }
+  
+  //the products, transpose and inverse are constexpr; in a constant expression they take the
+  //scalar path, at run time the SIMD one when compiled in
+  constexpr Vec4 operator*(const Vec4& other)const
   {
+#if defined(__SSE3__)
+    if(!IsConstantEvaluated()) return MulSIMD(other);
+#endif
+
+    float r[4] = {};
     for(int i = 0; i < 4; i++)
     {
-      for(int j = 0; j < 4; j++)
-      {
-        if(i == j) m_Mat[i][j] = t;
-        else m_Mat[i][j] = 0.0f;
-      }
+      r[i] = m_Mat[i][0] * other.m_fX + m_Mat[i][1] * other.m_fY + m_Mat[i][2] * other.m_fZ + m_Mat[i][3] * other.m_fW;
     }
-  }
 
-  ~Mat4() = default;
+    return Vec4(r[0], r[1], r[2], r[3]);
+  }
   
-  //copy constructor and copy assignment
-  Mat4(const Mat4& other)
+  constexpr Mat4 operator*(const Mat4& other)const
   {
+#if defined(__SSE3__)
+    if(!IsConstantEvaluated()) return MulSIMD(other);
+#endif
+
+    Mat4 result(0.0f);
     for(int i = 0; i < 4; i++)
     {
       for(int j = 0; j < 4; j++)
       {
-        m_Mat[i][j] = other.m_Mat[i][j];
+        result.m_Mat[i][j] = m_Mat[i][0] * other.m_Mat[0][j] + m_Mat[i][1] * other.m_Mat[1][j] +
+          m_Mat[i][2] * other.m_Mat[2][j] + m_Mat[i][3] * other.m_Mat[3][j];
       }
     }
+
+    return result;
   }
-  
-  Mat4 operator=(const Mat4& other)
+
+  constexpr Mat4 Transpose()const
   {
-    if(this == &other) return *this;
+#if defined(__SSE3__)
+    if(!IsConstantEvaluated()) return TransposeSIMD();
+#endif
 
+    Mat4 result(0.0f);
     for(int i = 0; i < 4; i++)
     {
       for(int j = 0; j < 4; j++)
       {
-        m_Mat[i][j] = other.m_Mat[i][j];
+        result.m_Mat[i][j] = m_Mat[j][i];
       }
     }
 
-    return *this;
+    return result;
   }
 
-  Vec4 GetRow(int index)
+  //general inverse; throws Invalid if the matrix is singular
+  constexpr Mat4 Inverse()const
   {
-    if(index > 3) throw Invalid{};
+#if defined(__SSE3__)
+    if(!IsConstantEvaluated()) return InverseSIMD();
+#endif
 
-    return Vec4(m_Mat[index][0], m_Mat[index][1], m_Mat[index][2], m_Mat[index][3]);
+    Mat4 result(0.0f);
+
+    //cofactor expansion over 2x2 minors of the top and bottom row pairs
+    const float (&m)[4][4] = m_Mat;
+    float s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    float s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    float s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    float s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    float s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    float s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+    float c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    float c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    float c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    float c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    float c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    float c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+    float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    //zero, infinite or nan (std::isfinite is not constexpr)
+    if(det == 0.0f || !(det - det == 0.0f)) throw Invalid{};
+    float inv = 1.0f / det;
+
+    float (&r)[4][4] = result.m_Mat;
+    r[0][0] = ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * inv;
+    r[0][1] = (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * inv;
+    r[0][2] = ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * inv;
+    r[0][3] = (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * inv;
+
+    r[1][0] = (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * inv;
+    r[1][1] = ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * inv;
+    r[1][2] = (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * inv;
+    r[1][3] = ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * inv;
+
+    r[2][0] = ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * inv;
+    r[2][1] = (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * inv;
+    r[2][2] = ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * inv;
+    r[2][3] = (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * inv;
+
+    r[3][0] = (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * inv;
+    r[3][1] = ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * inv;
+    r[3][2] = (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * inv;
+    r[3][3] = ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * inv;
+
+    return result;
   }
   
-  Vec4 GetColumn(int index)
+  static constexpr Mat4 Identity()
   {
-    if(index > 3) throw Invalid{};
+    return Mat4();
+  }
 
-    return Vec4(m_Mat[0][index], m_Mat[1][index], m_Mat[2][index], m_Mat[3][index]);
+  //-----------------------------------------builders------------------------------------------
+  //constexpr, so a fixed camera is folded at compile time:
+  //  constexpr Mat4 proj = Mat4::Perspective(fov, aspect, near, far);
+
+  //the builders follow the usual GL conventions: the camera looks down -z, n and f are positive
+  //distances in front of it, and clip space keeps -w <= x, y, z <= w (z = -w on the near plane)
+
+  //maps the view-space box [l, r] x [b, t] x [-f, -n] onto [-1, 1]^3
+  static constexpr Mat4 Orthographic(float l, float r, float b, float t, float n, float f)
+  {
+    Mat4 m;
+    m.m_Mat[0][0] = 2.0f / (r - l);
+    m.m_Mat[1][1] = 2.0f / (t - b);
+    m.m_Mat[2][2] = -2.0f / (f - n);
+    m.m_Mat[0][3] = -(r + l) / (r - l);
+    m.m_Mat[1][3] = -(t + b) / (t - b);
+    m.m_Mat[2][3] = -(f + n) / (f - n);
+    return m;
   }
-  
-  Vec4 operator*(const Vec4& other)
+
+  //perspective projection with vertical field of view fovY (radians) and aspect = width /
+  //height; clip w is the distance in front of the camera (-z)
+  static constexpr Mat4 Perspective(float fovY, float aspect, float n, float f)
   {
-    return Vec4(GetRow(0).Dot(other), GetRow(1).Dot(other), GetRow(2).Dot(other), GetRow(3).Dot(other));
+    float t = (float)(ConstexprTan(fovY / 2.0f) * n);
+    float r = t * aspect;
+
+    Mat4 m(0.0f);
+    m.m_Mat[0][0] = n / r;
+    m.m_Mat[1][1] = n / t;
+    m.m_Mat[2][2] = -(f + n) / (f - n);
+    m.m_Mat[2][3] = -(2.0f * f * n) / (f - n);
+    m.m_Mat[3][2] = -1.0f;
+    return m;
+  }
+
+  //normalized device coordinates onto the pixel centers of a top-down framebuffer (y = 1 is
+  //row 0), z onto the depth range [0, 1] (the matrix form of Viewport::FromSize in
+  //VertexBuffer.h)
+  static constexpr Mat4 Viewport(float width, float height)
+  {
+    Mat4 m;
+    m.m_Mat[0][0] = width / 2.0f;
+    m.m_Mat[1][1] = -height / 2.0f;
+    m.m_Mat[2][2] = 0.5f;
+    m.m_Mat[0][3] = (width - 1.0f) / 2.0f;
+    m.m_Mat[1][3] = (height - 1.0f) / 2.0f;
+    m.m_Mat[2][3] = 0.5f;
+    return m;
+  }
+
+  //view matrix of a camera at eye looking at target: rows u, v, w with w pointing back from
+  //target to eye and u = up x w. If up is (nearly) parallel to the view direction the x axis is
+  //used instead.
+  static constexpr Mat4 LookAt(const Vec3& eye, const Vec3& target, const Vec3& up)
+  {
+    Vec3 w = Normalize(eye - target);
+    Vec3 top = Normalize(up);
+    float cosine = w.Dot(top);
+    if(cosine > 0.99f || cosine < -0.99f) top = Vec3(1.0f, 0.0f, 0.0f);
+
+    Vec3 u = Normalize(top.Cross(w));
+    Vec3 v = Normalize(w.Cross(u));
+
+    Mat4 m;
+    m.m_Mat[0][0] = u.X();
+    m.m_Mat[0][1] = u.Y();
+    m.m_Mat[0][2] = u.Z();
+    m.m_Mat[0][3] = -u.Dot(eye);
+
+    m.m_Mat[1][0] = v.X();
+    m.m_Mat[1][1] = v.Y();
+    m.m_Mat[1][2] = v.Z();
+    m.m_Mat[1][3] = -v.Dot(eye);
+
+    m.m_Mat[2][0] = w.X();
+    m.m_Mat[2][1] = w.Y();
+    m.m_Mat[2][2] = w.Z();
+    m.m_Mat[2][3] = -w.Dot(eye);
+    return m;
+  }
+
+private:
+
+#if defined(__SSE3__)
+  Vec4 MulSIMD(const Vec4& other)const
+  {
+    Vec4 result;
+
+    //the four row products, summed horizontally: hadd twice leaves (r0.v, r1.v, r2.v, r3.v)
+    __m128 v = _mm_load_ps(&other.m_fX);
+    __m128 p0 = _mm_mul_ps(_mm_load_ps(m_Mat[0]), v);
+    __m128 p1 = _mm_mul_ps(_mm_load_ps(m_Mat[1]), v);
+    __m128 p2 = _mm_mul_ps(_mm_load_ps(m_Mat[2]), v);
+    __m128 p3 = _mm_mul_ps(_mm_load_ps(m_Mat[3]), v);
+
+    _mm_store_ps(&result.m_fX, _mm_hadd_ps(_mm_hadd_ps(p0, p1), _mm_hadd_ps(p2, p3)));
+
+    return result;
   }
   
-  Mat4 operator*(Mat4& other)
+  Mat4 MulSIMD(const Mat4& other)const
   {
-    Mat4 result(0.0f); // initialize all to 0
+    Mat4 result(0.0f);
+
+#if defined(__AVX__)
+    //row i of the product is the rows of other weighted by the entries of row i; two rows per
+    //register, each half broadcasting its own row's entries. Summed as a tree so a chain of
+    //products waits on two additions per step, not three.
+    __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(other.m_Mat[0]));
+    __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(other.m_Mat[1]));
+    __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(other.m_Mat[2]));
+    __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(other.m_Mat[3]));
+
+    for(int i = 0; i < 4; i += 2)
+    {
+      __m256 a = _mm256_loadu_ps(m_Mat[i]);
+      __m256 r01 = _mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(a, 0x00), b0), _mm256_mul_ps(_mm256_permute_ps(a, 0x55), b1));
+      __m256 r23 = _mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(a, 0xAA), b2), _mm256_mul_ps(_mm256_permute_ps(a, 0xFF), b3));
+      _mm256_storeu_ps(result.m_Mat[i], _mm256_add_ps(r01, r23));
+    }
+#elif defined(__SSE3__)
+    //as above, one row per register
+    __m128 b0 = _mm_load_ps(other.m_Mat[0]);
+    __m128 b1 = _mm_load_ps(other.m_Mat[1]);
+    __m128 b2 = _mm_load_ps(other.m_Mat[2]);
+    __m128 b3 = _mm_load_ps(other.m_Mat[3]);
 
     for(int i = 0; i < 4; i++)
     {
-      for(int j = 0; j < 4; j++)
-      {
-        result.m_Mat[i][j] =
-        GetRow(i).Dot(other.GetColumn(j));
-      }
+      __m128 a = _mm_load_ps(m_Mat[i]);
+      __m128 r01 = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), b0),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+      __m128 r23 = _mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), b2),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+      _mm_store_ps(result.m_Mat[i], _mm_add_ps(r01, r23));
     }
+#endif
 
     return result;
   }
-  
-  static Mat4 Identity()
+
+  Mat4 TransposeSIMD()const
   {
-    Mat4 r = {};
-    
-    r.m_Mat[0][0] = 1.0f;
-    r.m_Mat[1][1] = 1.0f;
-    r.m_Mat[2][2] = 1.0f;
-    r.m_Mat[3][3] = 1.0f;
-    
-    return r;
-  }  
+    Mat4 result(0.0f);
+
+    __m128 r0 = _mm_load_ps(m_Mat[0]);
+    __m128 r1 = _mm_load_ps(m_Mat[1]);
+    __m128 r2 = _mm_load_ps(m_Mat[2]);
+    __m128 r3 = _mm_load_ps(m_Mat[3]);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_store_ps(result.m_Mat[0], r0);
+    _mm_store_ps(result.m_Mat[1], r1);
+    _mm_store_ps(result.m_Mat[2], r2);
+    _mm_store_ps(result.m_Mat[3], r3);
+
+    return result;
+  }
+
+  //inverse by 2x2 blocks
+  Mat4 InverseSIMD()const
+  {
+    Mat4 result(0.0f);
+
+    //split into 2x2 blocks | A B |, each packed row-major into one register
+    //                      | C D |
+    __m128 r0 = _mm_load_ps(m_Mat[0]);
+    __m128 r1 = _mm_load_ps(m_Mat[1]);
+    __m128 r2 = _mm_load_ps(m_Mat[2]);
+    __m128 r3 = _mm_load_ps(m_Mat[3]);
+
+    __m128 A = _mm_movelh_ps(r0, r1);
+    __m128 B = _mm_movehl_ps(r1, r0);
+    __m128 C = _mm_movelh_ps(r2, r3);
+    __m128 D = _mm_movehl_ps(r3, r2);
+
+    //(|A|, |B|, |C|, |D|)
+    __m128 detSub = _mm_sub_ps(
+      _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1))),
+      _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0))));
+    __m128 detA = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 detB = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 detC = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 detD = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(3, 3, 3, 3));
+
+    //with # the adjugate: the inverse is 1/|M| * | X Y | where X# = |D|A - B(D#C),
+    //                                             | Z W |
+    //W# = |A|D - C(A#B), Y# = |B|C - D(A#B)#, Z# = |C|B - A(D#C)#
+    __m128 D_C = Mat2AdjMul(D, C);
+    __m128 A_B = Mat2AdjMul(A, B);
+    __m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), Mat2Mul(B, D_C));
+    __m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), Mat2Mul(C, A_B));
+    __m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), Mat2MulAdj(D, A_B));
+    __m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), Mat2MulAdj(A, D_C));
+
+    //|M| = |A||D| + |B||C| - tr((A#B)(D#C))
+    __m128 tr = _mm_mul_ps(A_B, _mm_shuffle_ps(D_C, D_C, _MM_SHUFFLE(3, 1, 2, 0)));
+    tr = _mm_hadd_ps(tr, tr);
+    tr = _mm_hadd_ps(tr, tr);
+    __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+    float det = _mm_cvtss_f32(detM);
+    if(det == 0.0f || !std::isfinite(det)) throw Invalid{};
+
+    //the signs undo the adjugate of each block
+    __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+    X_ = _mm_mul_ps(X_, rDetM);
+    Y_ = _mm_mul_ps(Y_, rDetM);
+    Z_ = _mm_mul_ps(Z_, rDetM);
+    W_ = _mm_mul_ps(W_, rDetM);
+
+    //adjugate shuffle and block layout in one step
+    _mm_store_ps(result.m_Mat[0], _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_store_ps(result.m_Mat[1], _mm_shuffle_ps(X_, Y_, _MM_SHUFFLE(0, 2, 0, 2)));
+    _mm_store_ps(result.m_Mat[2], _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_store_ps(result.m_Mat[3], _mm_shuffle_ps(Z_, W_, _MM_SHUFFLE(0, 2, 0, 2)));
+
+    return result;
+  }
+
+  //2x2 products on blocks packed row-major as (m00, m01, m10, m11); # is the adjugate
+
+  //A * B
+  static __m128 Mat2Mul(__m128 a, __m128 b)
+  {
+    return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+      _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+  }
+
+  //A# * B
+  static __m128 Mat2AdjMul(__m128 a, __m128 b)
+  {
+    return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+      _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+  }
+
+  //A * B#
+  static __m128 Mat2MulAdj(__m128 a, __m128 b)
+  {
+    return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+      _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+  }
+#endif
 };
 
 //--------------------------------------vec2 methods------------------------------------------
 
 //operator overloading for bi-directional operations
-inline Vec2 operator*(float val, const Vec2& v) { return Vec2(v.X() * val, v.Y() * val); }
+constexpr Vec2 operator*(float val, const Vec2& v) { return Vec2(v.X() * val, v.Y() * val); }
 
-//method to get a normalized vec2
-inline Vec2 Normalize(const Vec2& v)
+//method to get a normalized vec2 (the squares are summed in double, as pow(x, 2) did)
+constexpr Vec2 Normalize(const Vec2& v)
 {
-  float mag = sqrt(pow(v.X(), 2) + pow(v.Y(), 2));
+  float mag = (float)ConstexprSqrt((double)v.X() * v.X() + (double)v.Y() * v.Y());
   return Vec2(v.X()/mag, v.Y()/mag);
 }
 
@@ -542,12 +838,12 @@ inline std::ostream& operator<<(std::ostream& os, const Vec2& v)
 //----------------------------------methods for vec3--------------------------------------------
 
 //operator overloading for bi-directional operations
-inline Vec3 operator*(float val, const Vec3& v) { return Vec3(v.X() * val, v.Y() * val, v.Z() * val); }
+constexpr Vec3 operator*(float val, const Vec3& v) { return Vec3(v.X() * val, v.Y() * val, v.Z() * val); }
 
 //method to get a normalized vec3
-inline Vec3 Normalize(const Vec3& v)
+constexpr Vec3 Normalize(const Vec3& v)
 {
-  float mag = sqrt(pow(v.X(), 2) + pow(v.Y(), 2) + pow(v.Z(), 2));
+  float mag = (float)ConstexprSqrt((double)v.X() * v.X() + (double)v.Y() * v.Y() + (double)v.Z() * v.Z());
   return Vec3(v.X()/mag, v.Y()/mag, v.Z()/mag);
 }
 
@@ -623,7 +919,7 @@ inline std::vector<float> Interpolate_(const Vec2& v1, const Vec2& v2)
   return Interpolate(v1.Y(), v1.X(), v2.Y(), v2.X());
 }
 
-inline Vec3 Lerp(const Vec3& a, const Vec3& b, float t)
+constexpr Vec3 Lerp(const Vec3& a, const Vec3& b, float t)
 {
   return a + (b - a) * t;
 }
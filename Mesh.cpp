@@ -0,0 +1,981 @@
+#include "./Mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+static const uint32_t CACHE_VERSION = 1;
+static const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+static const uint32_t CACHE_COLORS = 1;
+static const uint64_t CACHE_ALIGN = 64;
+
+//text chunks smaller than this are not worth a thread
+static const size_t MIN_CHUNK_BYTES = 1 << 20;
+
+//fixed part of a cache file, written and read as is (so in native byte order)
+struct CacheHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint32_t flags;
+  uint32_t vertexCount;
+  uint32_t indexCount;
+  float bounds[6];
+  uint64_t sourceSize;
+  uint64_t sourceTime;
+  uint64_t offsets[9];
+};
+
+//a whole file mapped read-only; an empty file maps to no data
+class MappedFile
+{
+
+public:
+
+  explicit MappedFile(const std::string& path) : m_pData(nullptr), m_uSize(0), m_uTime(0)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) throw Mesh::Invalid{};
+
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+      close(fd);
+      throw Mesh::Invalid{};
+    }
+
+    m_uSize = (size_t)st.st_size;
+    m_uTime = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+
+    if(m_uSize > 0)
+    {
+      void* data = mmap(nullptr, m_uSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(data == MAP_FAILED)
+      {
+        close(fd);
+        throw Mesh::Invalid{};
+      }
+      m_pData = static_cast<const char*>(data);
+    }
+
+    close(fd);
+  }
+
+  ~MappedFile()
+  {
+    if(m_pData) munmap(const_cast<char*>(m_pData), m_uSize);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  //the parsers read front to back once
+  void AdviseSequential()const
+  {
+    if(m_pData) madvise(const_cast<char*>(m_pData), m_uSize, MADV_SEQUENTIAL);
+  }
+
+  const char* Data()const{return m_pData;}
+  size_t Size()const{return m_uSize;}
+  uint64_t Time()const{return m_uTime;}
+
+private:
+
+  const char* m_pData;
+  size_t m_uSize;
+  uint64_t m_uTime;
+
+};
+
+//tokenizer: every function works on [p, end) of the mapping in place and never allocates
+
+static bool IsSpace(char c){ return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+static bool IsDigit(char c){ return c >= '0' && c <= '9'; }
+
+static void SkipSpace(const char*& p, const char* end)
+{
+  while(p < end && IsSpace(*p)) p++;
+}
+
+//to the first character of the next line
+static void SkipLine(const char*& p, const char* end)
+{
+  const void* nl = std::memchr(p, '\n', (size_t)(end - p));
+  p = nl ? static_cast<const char*>(nl) + 1 : end;
+}
+
+//skips spaces and newlines alike, for formats that do not care about lines
+static void SkipWhite(const char*& p, const char* end)
+{
+  while(p < end && (IsSpace(*p) || *p == '\n')) p++;
+}
+
+static double Pow10(int e)
+{
+  static const double table[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  return e <= 22 ? table[e] : std::pow(10.0, e);
+}
+
+//a decimal number ([sign] digits [. digits] [e [sign] digits]) at p. Up to 19 significant
+//digits are kept exactly, which covers any integer index and float coordinate; the rest only
+//scale the result. Returns false, leaving p as it was, if there is no number.
+static bool ParseNumber(const char*& p, const char* end, double& out)
+{
+  const char* s = p;
+  bool negative = false;
+  if(s < end && (*s == '-' || *s == '+'))
+  {
+    negative = *s == '-';
+    s++;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any = false;
+
+  for(; s < end && IsDigit(*s); s++)
+  {
+    any = true;
+    if(digits < 19)
+    {
+      mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+      if(mantissa) digits++;
+    }
+    else exponent++;
+  }
+
+  if(s < end && *s == '.')
+  {
+    for(s++; s < end && IsDigit(*s); s++)
+    {
+      any = true;
+      if(digits < 19)
+      {
+        mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+        if(mantissa) digits++;
+        exponent--;
+      }
+    }
+  }
+
+  if(!any) return false;
+
+  if(s < end && (*s == 'e' || *s == 'E'))
+  {
+    const char* e = s + 1;
+    bool negativeE = false;
+    if(e < end && (*e == '-' || *e == '+'))
+    {
+      negativeE = *e == '-';
+      e++;
+    }
+
+    if(e < end && IsDigit(*e))
+    {
+      int value = 0;
+      for(; e < end && IsDigit(*e); e++)
+      {
+        if(value < 10000) value = value * 10 + (*e - '0');
+      }
+      exponent += negativeE ? -value : value;
+      s = e;
+    }
+  }
+
+  double v = (double)mantissa;
+  if(exponent < 0) v = exponent < -330 ? 0.0 : v / Pow10(-exponent);
+  else if(exponent > 0) v = v * Pow10(std::min(exponent, 330));
+
+  out = negative ? -v : v;
+  p = s;
+  return true;
+}
+
+static bool ParseFloat(const char*& p, const char* end, float& out)
+{
+  double v;
+  if(!ParseNumber(p, end, v)) return false;
+  out = (float)v;
+  return true;
+}
+
+static bool ParseInt(const char*& p, const char* end, long& out)
+{
+  const char* s = p;
+  bool negative = false;
+  if(s < end && (*s == '-' || *s == '+'))
+  {
+    negative = *s == '-';
+    s++;
+  }
+
+  if(s >= end || !IsDigit(*s)) return false;
+
+  long value = 0;
+  for(; s < end && IsDigit(*s); s++)
+  {
+    if(value < (1l << 40)) value = value * 10 + (*s - '0');
+  }
+
+  out = negative ? -value : value;
+  p = s;
+  return true;
+}
+
+//true if the word at p is exactly w, followed by a space or the end of the line
+static bool IsKeyword(const char* p, const char* end, const char* w)
+{
+  size_t n = std::strlen(w);
+  if((size_t)(end - p) < n || std::memcmp(p, w, n) != 0) return false;
+  return p + n == end || IsSpace(p[n]) || p[n] == '\n';
+}
+
+//the word at p (up to a space or newline), advancing p past it
+static std::pair<const char*, size_t> NextWord(const char*& p, const char* end)
+{
+  SkipSpace(p, end);
+  const char* s = p;
+  while(p < end && !IsSpace(*p) && *p != '\n') p++;
+  return {s, (size_t)(p - s)};
+}
+
+static bool WordIs(const std::pair<const char*, size_t>& word, const char* w)
+{
+  return word.second == std::strlen(w) && std::memcmp(word.first, w, word.second) == 0;
+}
+
+//OBJ
+
+//what one thread parses from its chunk of lines. Indices are stored 0-based; those given
+//relative to the current vertex (negative in the file) are counted from the chunk's first
+//vertex and listed in relative, to be rebased once the vertex counts of earlier chunks are known.
+struct ObjChunk
+{
+  std::vector<float> x, y, z;
+  std::vector<float> r, g, b;
+  std::vector<int> indices;
+  std::vector<size_t> relative;
+  bool colors = false;
+  bool failed = false;
+};
+
+//one "f" corner: the vertex index of "v", "v/t", "v//n" or "v/t/n"
+static bool ParseObjCorner(const char*& p, const char* end, const ObjChunk& chunk, int& index, bool& relative)
+{
+  long v;
+  if(!ParseInt(p, end, v) || v == 0 || v > INT32_MAX || v < -(long)INT32_MAX) return false;
+
+  while(p < end && !IsSpace(*p) && *p != '\n') p++;
+
+  relative = v < 0;
+  index = relative ? (int)((long)chunk.x.size() + v) : (int)(v - 1);
+  return true;
+}
+
+static void PushIndex(ObjChunk& chunk, int index, bool relative)
+{
+  if(relative) chunk.relative.push_back(chunk.indices.size());
+  chunk.indices.push_back(index);
+}
+
+static void ParseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+  while(p < end)
+  {
+    SkipSpace(p, end);
+
+    if(IsKeyword(p, end, "v"))
+    {
+      p++;
+      float values[7];
+      int n = 0;
+      for(; n < 7; n++)
+      {
+        SkipSpace(p, end);
+        if(!ParseFloat(p, end, values[n])) break;
+      }
+
+      if(n < 3)
+      {
+        chunk.failed = true;
+        return;
+      }
+
+      chunk.x.push_back(values[0]);
+      chunk.y.push_back(values[1]);
+      chunk.z.push_back(values[2]);
+
+      //"v x y z r g b": the chunk's colors start at its first colored vertex, earlier ones white
+      if(n >= 6)
+      {
+        if(!chunk.colors)
+        {
+          chunk.colors = true;
+          chunk.r.assign(chunk.x.size() - 1, 1.0f);
+          chunk.g.assign(chunk.x.size() - 1, 1.0f);
+          chunk.b.assign(chunk.x.size() - 1, 1.0f);
+        }
+        chunk.r.push_back(values[n - 3]);
+        chunk.g.push_back(values[n - 2]);
+        chunk.b.push_back(values[n - 1]);
+      }
+      else if(chunk.colors)
+      {
+        chunk.r.push_back(1.0f);
+        chunk.g.push_back(1.0f);
+        chunk.b.push_back(1.0f);
+      }
+    }
+    else if(IsKeyword(p, end, "f"))
+    {
+      p++;
+
+      //a polygon is fanned around its first corner as it is read
+      int first = 0, prev = 0;
+      bool firstRel = false, prevRel = false;
+      int corners = 0;
+
+      for(;;)
+      {
+        SkipSpace(p, end);
+        if(p >= end || *p == '\n' || *p == '#') break;
+
+        int index;
+        bool relative;
+        if(!ParseObjCorner(p, end, chunk, index, relative))
+        {
+          chunk.failed = true;
+          return;
+        }
+
+        if(corners >= 2)
+        {
+          PushIndex(chunk, first, firstRel);
+          PushIndex(chunk, prev, prevRel);
+          PushIndex(chunk, index, relative);
+        }
+
+        if(corners == 0)
+        {
+          first = index;
+          firstRel = relative;
+        }
+        prev = index;
+        prevRel = relative;
+        corners++;
+      }
+
+      if(corners < 3)
+      {
+        chunk.failed = true;
+        return;
+      }
+    }
+
+    SkipLine(p, end);
+  }
+}
+
+static void ParseOBJ(const MappedFile& file, int threads, VertexBuffer& positions, VertexBuffer& colors,
+  bool& hasColors, std::vector<int>& indices)
+{
+  const char* data = file.Data();
+  size_t size = file.Size();
+
+  //chunks start on a line
+  int chunks = (int)std::max<size_t>(1, std::min<size_t>((size_t)std::max(threads, 1), size / MIN_CHUNK_BYTES));
+  std::vector<const char*> bounds(chunks + 1);
+  bounds[0] = data;
+  bounds[chunks] = data + size;
+  for(int c = 1; c < chunks; c++)
+  {
+    const char* p = std::max(bounds[c - 1], data + size * c / chunks);
+    if(p > data && p[-1] != '\n') SkipLine(p, data + size);
+    bounds[c] = p;
+  }
+
+  std::vector<ObjChunk> parsed(chunks);
+  std::vector<std::thread> pool;
+  for(int c = 1; c < chunks; c++)
+  {
+    pool.emplace_back([&, c](){ ParseObjChunk(bounds[c], bounds[c + 1], parsed[c]); });
+  }
+
+  ParseObjChunk(bounds[0], bounds[1], parsed[0]);
+
+  for(std::thread& t : pool)
+  {
+    t.join();
+  }
+
+  //concatenate, rebasing relative indices on the vertices of earlier chunks
+  size_t vertexCount = 0, indexCount = 0;
+  hasColors = false;
+  for(const ObjChunk& chunk : parsed)
+  {
+    if(chunk.failed) throw Mesh::Invalid{};
+    vertexCount += chunk.x.size();
+    indexCount += chunk.indices.size();
+    hasColors = hasColors || chunk.colors;
+  }
+
+  if(vertexCount > (size_t)INT32_MAX || indexCount > (size_t)UINT32_MAX) throw Mesh::Invalid{};
+
+  positions.Resize((int)vertexCount);
+  colors.Resize(hasColors ? (int)vertexCount : 0);
+  indices.resize(indexCount);
+
+  float* px = positions.X();
+  float* py = positions.Y();
+  float* pz = positions.Z();
+  float* cr = colors.X();
+  float* cg = colors.Y();
+  float* cb = colors.Z();
+
+  size_t vertexBase = 0, indexBase = 0;
+  for(const ObjChunk& chunk : parsed)
+  {
+    size_t n = chunk.x.size();
+    std::copy(chunk.x.begin(), chunk.x.end(), px + vertexBase);
+    std::copy(chunk.y.begin(), chunk.y.end(), py + vertexBase);
+    std::copy(chunk.z.begin(), chunk.z.end(), pz + vertexBase);
+
+    //colors are [0, 1] in the file
+    for(size_t i = 0; hasColors && i < n; i++)
+    {
+      cr[vertexBase + i] = (chunk.colors ? chunk.r[i] : 1.0f) * 255.0f;
+      cg[vertexBase + i] = (chunk.colors ? chunk.g[i] : 1.0f) * 255.0f;
+      cb[vertexBase + i] = (chunk.colors ? chunk.b[i] : 1.0f) * 255.0f;
+    }
+
+    std::copy(chunk.indices.begin(), chunk.indices.end(), indices.begin() + indexBase);
+    for(size_t k : chunk.relative)
+    {
+      indices[indexBase + k] += (int)vertexBase;
+    }
+
+    vertexBase += n;
+    indexBase += chunk.indices.size();
+  }
+}
+
+//PLY
+
+enum class PlyType
+{
+  INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64, NONE
+};
+
+struct PlyProperty
+{
+  PlyType type;
+  PlyType countType;  //NONE unless a list
+  std::pair<const char*, size_t> name;
+};
+
+struct PlyElement
+{
+  std::pair<const char*, size_t> name;
+  size_t count;
+  std::vector<PlyProperty> properties;
+};
+
+static PlyType ParsePlyType(const std::pair<const char*, size_t>& word)
+{
+  if(WordIs(word, "char") || WordIs(word, "int8")) return PlyType::INT8;
+  if(WordIs(word, "uchar") || WordIs(word, "uint8")) return PlyType::UINT8;
+  if(WordIs(word, "short") || WordIs(word, "int16")) return PlyType::INT16;
+  if(WordIs(word, "ushort") || WordIs(word, "uint16")) return PlyType::UINT16;
+  if(WordIs(word, "int") || WordIs(word, "int32")) return PlyType::INT32;
+  if(WordIs(word, "uint") || WordIs(word, "uint32")) return PlyType::UINT32;
+  if(WordIs(word, "float") || WordIs(word, "float32")) return PlyType::FLOAT32;
+  if(WordIs(word, "double") || WordIs(word, "float64")) return PlyType::FLOAT64;
+  throw Mesh::Invalid{};
+}
+
+static size_t PlySize(PlyType type)
+{
+  switch(type)
+  {
+    case PlyType::INT8: case PlyType::UINT8: return 1;
+    case PlyType::INT16: case PlyType::UINT16: return 2;
+    case PlyType::INT32: case PlyType::UINT32: case PlyType::FLOAT32: return 4;
+    case PlyType::FLOAT64: return 8;
+    default: return 0;
+  }
+}
+
+//fewest bytes one instance of an element can take: every scalar and every list's count at
+//their binary sizes, or one byte per value when ascii (a list may be empty)
+static size_t PlyMinSize(const PlyElement& e, bool ascii)
+{
+  size_t size = 0;
+  for(const PlyProperty& prop : e.properties)
+  {
+    size += ascii ? 1 : PlySize(prop.countType != PlyType::NONE ? prop.countType : prop.type);
+  }
+  return size;
+}
+
+//reads PLY values of either encoding from [p, end), throwing Invalid past the end
+class PlyReader
+{
+
+public:
+
+  PlyReader(const char* p, const char* end, bool ascii, bool swap) : m_pPos(p), m_pEnd(end),
+                                                                      m_bAscii(ascii), m_bSwap(swap) {}
+
+  double Read(PlyType type)
+  {
+    if(m_bAscii)
+    {
+      double v;
+      SkipWhite(m_pPos, m_pEnd);
+      if(!ParseNumber(m_pPos, m_pEnd, v)) throw Mesh::Invalid{};
+      return v;
+    }
+
+    size_t n = PlySize(type);
+    if((size_t)(m_pEnd - m_pPos) < n) throw Mesh::Invalid{};
+
+    uint8_t b[8];
+    for(size_t i = 0; i < n; i++)
+    {
+      b[i] = (uint8_t)m_pPos[m_bSwap ? n - 1 - i : i];
+    }
+    m_pPos += n;
+
+    switch(type)
+    {
+      case PlyType::INT8: return (double)(int8_t)b[0];
+      case PlyType::UINT8: return (double)b[0];
+      case PlyType::INT16: { int16_t v; std::memcpy(&v, b, 2); return v; }
+      case PlyType::UINT16: { uint16_t v; std::memcpy(&v, b, 2); return v; }
+      case PlyType::INT32: { int32_t v; std::memcpy(&v, b, 4); return v; }
+      case PlyType::UINT32: { uint32_t v; std::memcpy(&v, b, 4); return v; }
+      case PlyType::FLOAT32: { float v; std::memcpy(&v, b, 4); return v; }
+      case PlyType::FLOAT64: { double v; std::memcpy(&v, b, 8); return v; }
+      default: throw Mesh::Invalid{};
+    }
+  }
+
+  //bytes not read yet
+  size_t Remaining()const{return (size_t)(m_pEnd - m_pPos);}
+
+  //skips one property of an element instance
+  void Skip(const PlyProperty& prop)
+  {
+    if(prop.countType == PlyType::NONE)
+    {
+      Read(prop.type);
+      return;
+    }
+
+    double count = Read(prop.countType);
+    if(count < 0.0) throw Mesh::Invalid{};
+    for(size_t i = 0; i < (size_t)count; i++) Read(prop.type);
+  }
+
+private:
+
+  const char* m_pPos;
+  const char* m_pEnd;
+  bool m_bAscii;
+  bool m_bSwap;
+
+};
+
+static void ParsePLY(const MappedFile& file, VertexBuffer& positions, VertexBuffer& colors, bool& hasColors,
+  std::vector<int>& indices)
+{
+  const char* p = file.Data();
+  const char* end = p + file.Size();
+
+  if(!IsKeyword(p, end, "ply")) throw Mesh::Invalid{};
+  SkipLine(p, end);
+
+  bool ascii = false, swap = false, format = false;
+  std::vector<PlyElement> elements;
+
+  for(;;)
+  {
+    if(p >= end) throw Mesh::Invalid{};
+
+    auto word = NextWord(p, end);
+    if(WordIs(word, "end_header"))
+    {
+      SkipLine(p, end);
+      break;
+    }
+
+    if(WordIs(word, "format"))
+    {
+      auto kind = NextWord(p, end);
+      ascii = WordIs(kind, "ascii");
+      bool little = WordIs(kind, "binary_little_endian");
+      if(!ascii && !little && !WordIs(kind, "binary_big_endian")) throw Mesh::Invalid{};
+
+      uint32_t probe = 1;
+      uint8_t first;
+      std::memcpy(&first, &probe, 1);
+      swap = !ascii && (little != (first == 1));
+      format = true;
+    }
+    else if(WordIs(word, "element"))
+    {
+      PlyElement e;
+      e.name = NextWord(p, end);
+      long count;
+      SkipSpace(p, end);
+      if(!ParseInt(p, end, count) || count < 0) throw Mesh::Invalid{};
+      e.count = (size_t)count;
+      elements.push_back(e);
+    }
+    else if(WordIs(word, "property"))
+    {
+      if(elements.empty()) throw Mesh::Invalid{};
+
+      PlyProperty prop;
+      auto type = NextWord(p, end);
+      if(WordIs(type, "list"))
+      {
+        prop.countType = ParsePlyType(NextWord(p, end));
+        prop.type = ParsePlyType(NextWord(p, end));
+      }
+      else
+      {
+        prop.countType = PlyType::NONE;
+        prop.type = ParsePlyType(type);
+      }
+      prop.name = NextWord(p, end);
+      elements.back().properties.push_back(prop);
+    }
+
+    SkipLine(p, end);
+  }
+
+  if(!format) throw Mesh::Invalid{};
+
+  PlyReader in(p, end, ascii, swap);
+  hasColors = false;
+  indices.clear();
+
+  for(const PlyElement& e : elements)
+  {
+    //the counts come from the header, so they are checked against what is left of the file
+    //before anything is sized by them
+    size_t least = PlyMinSize(e, ascii);
+    if(least > 0 && e.count > in.Remaining() / least) throw Mesh::Invalid{};
+
+    if(WordIs(e.name, "vertex"))
+    {
+      //where each wanted value sits among the element's properties
+      int slot[6] = {-1, -1, -1, -1, -1, -1};
+      const char* names[6] = {"x", "y", "z", "red", "green", "blue"};
+      for(size_t k = 0; k < e.properties.size(); k++)
+      {
+        for(int s = 0; s < 6; s++)
+        {
+          if(WordIs(e.properties[k].name, names[s]) && e.properties[k].countType == PlyType::NONE) slot[s] = (int)k;
+        }
+      }
+
+      if(slot[0] < 0 || slot[1] < 0 || slot[2] < 0 || e.count > (size_t)INT32_MAX) throw Mesh::Invalid{};
+      hasColors = slot[3] >= 0 && slot[4] >= 0 && slot[5] >= 0;
+
+      //float colors are [0, 1], integer ones already 0-255
+      float colorScale = hasColors && (e.properties[slot[3]].type == PlyType::FLOAT32 ||
+        e.properties[slot[3]].type == PlyType::FLOAT64) ? 255.0f : 1.0f;
+
+      positions.Resize((int)e.count);
+      colors.Resize(hasColors ? (int)e.count : 0);
+      float* out[6] = {positions.X(), positions.Y(), positions.Z(), colors.X(), colors.Y(), colors.Z()};
+
+      for(size_t i = 0; i < e.count; i++)
+      {
+        for(size_t k = 0; k < e.properties.size(); k++)
+        {
+          const PlyProperty& prop = e.properties[k];
+          if(prop.countType != PlyType::NONE)
+          {
+            in.Skip(prop);
+            continue;
+          }
+
+          double v = in.Read(prop.type);
+          for(int s = 0; s < 6; s++)
+          {
+            if(slot[s] == (int)k && (s < 3 || hasColors)) out[s][i] = s < 3 ? (float)v : (float)v * colorScale;
+          }
+        }
+      }
+    }
+    else if(WordIs(e.name, "face"))
+    {
+      int list = -1;
+      for(size_t k = 0; k < e.properties.size(); k++)
+      {
+        const PlyProperty& prop = e.properties[k];
+        if(prop.countType != PlyType::NONE && (WordIs(prop.name, "vertex_indices") || WordIs(prop.name, "vertex_index")))
+        {
+          list = (int)k;
+        }
+      }
+      if(list < 0) throw Mesh::Invalid{};
+
+      indices.reserve(indices.size() + e.count * 3);
+
+      for(size_t i = 0; i < e.count; i++)
+      {
+        for(size_t k = 0; k < e.properties.size(); k++)
+        {
+          const PlyProperty& prop = e.properties[k];
+          if((int)k != list)
+          {
+            in.Skip(prop);
+            continue;
+          }
+
+          double count = in.Read(prop.countType);
+          if(count < 3.0) throw Mesh::Invalid{};
+
+          auto readIndex = [&]()
+          {
+            double v = in.Read(prop.type);
+            if(!(v >= 0.0 && v <= (double)INT32_MAX)) throw Mesh::Invalid{};
+            return (int)v;
+          };
+
+          //fanned around the first corner
+          int first = readIndex();
+          int prev = readIndex();
+          for(size_t c = 2; c < (size_t)count; c++)
+          {
+            int index = readIndex();
+            indices.insert(indices.end(), {first, prev, index});
+            prev = index;
+          }
+        }
+      }
+    }
+    else if(least > 0)
+    {
+      for(size_t i = 0; i < e.count; i++)
+      {
+        for(const PlyProperty& prop : e.properties) in.Skip(prop);
+      }
+    }
+  }
+
+  if(indices.size() > (size_t)UINT32_MAX) throw Mesh::Invalid{};
+}
+
+Mesh Mesh::Load(const std::string& path, int threads)
+{
+  MappedFile file(path);
+  file.AdviseSequential();
+
+  Mesh mesh;
+  if(IsKeyword(file.Data(), file.Data() + file.Size(), "ply"))
+  {
+    ParsePLY(file, mesh.m_Positions, mesh.m_Colors, mesh.m_bColors, mesh.m_Indices);
+  }
+  else
+  {
+    ParseOBJ(file, threads, mesh.m_Positions, mesh.m_Colors, mesh.m_bColors, mesh.m_Indices);
+  }
+
+  //every index must name a vertex
+  int count = mesh.m_Positions.Size();
+  int lo = 0, hi = count - 1;
+  for(int index : mesh.m_Indices)
+  {
+    lo = std::min(lo, index);
+    hi = std::max(hi, index);
+  }
+  if(lo < 0 || hi >= count) throw Invalid{};
+
+  mesh.m_uIndexCount = mesh.m_Indices.size();
+
+  if(count > 0)
+  {
+    const float* axes[3] = {mesh.m_Positions.X(), mesh.m_Positions.Y(), mesh.m_Positions.Z()};
+    float lo3[3], hi3[3];
+    for(int a = 0; a < 3; a++)
+    {
+      auto range = std::minmax_element(axes[a], axes[a] + count);
+      lo3[a] = *range.first;
+      hi3[a] = *range.second;
+    }
+    mesh.m_BoundsMin = Vec3(lo3[0], lo3[1], lo3[2]);
+    mesh.m_BoundsMax = Vec3(hi3[0], hi3[1], hi3[2]);
+  }
+
+  return mesh;
+}
+
+Mesh Mesh::LoadCached(const std::string& path, int threads)
+{
+  struct stat st;
+  if(stat(path.c_str(), &st) != 0) throw Invalid{};
+
+  uint64_t size = (uint64_t)st.st_size;
+  uint64_t time = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+  std::string cache = path + ".trmc";
+
+  try
+  {
+    return MapCache(cache, size, time);
+  }
+  catch(Invalid)
+  {
+  }
+
+  Mesh mesh = Load(path, threads);
+
+  //a cache that cannot be written (e.g. a read-only directory) only costs the next run a parse
+  try
+  {
+    mesh.WriteCache(cache, size, time);
+  }
+  catch(Invalid)
+  {
+  }
+
+  return mesh;
+}
+
+static uint64_t AlignUp(uint64_t v)
+{
+  return (v + CACHE_ALIGN - 1) & ~(CACHE_ALIGN - 1);
+}
+
+Mesh Mesh::MapCache(const std::string& path, uint64_t sourceSize, uint64_t sourceTime)
+{
+  auto file = std::make_shared<MappedFile>(path);
+
+  CacheHeader h;
+  if(file->Size() < sizeof(h)) throw Invalid{};
+  std::memcpy(&h, file->Data(), sizeof(h));
+
+  if(std::memcmp(h.magic, "TRMC", 4) != 0 || h.version != CACHE_VERSION || h.byteOrder != CACHE_BYTE_ORDER ||
+    h.vertexCount > (uint32_t)INT32_MAX) throw Invalid{};
+  if(sourceSize != 0 && (h.sourceSize != sourceSize || h.sourceTime != sourceTime)) throw Invalid{};
+
+  bool colors = (h.flags & CACHE_COLORS) != 0;
+  uint64_t padded = ((uint64_t)h.vertexCount + 7) & ~(uint64_t)7;
+
+  //every stream in the file and aligned for its type
+  auto stream = [&](int k, uint64_t bytes) -> const char*
+  {
+    uint64_t offset = h.offsets[k];
+    if(offset % CACHE_ALIGN != 0 || offset > file->Size() || file->Size() - offset < bytes) throw Invalid{};
+    return file->Data() + offset;
+  };
+
+  const float* s[8];
+  for(int k = 0; k < (colors ? 8 : 4); k++)
+  {
+    s[k] = reinterpret_cast<const float*>(stream(k, padded * sizeof(float)));
+  }
+
+  Mesh mesh;
+  mesh.m_Positions = VertexBuffer(s[0], s[1], s[2], s[3], (int)h.vertexCount, file);
+  if(colors) mesh.m_Colors = VertexBuffer(s[4], s[5], s[6], s[7], (int)h.vertexCount, file);
+  mesh.m_bColors = colors;
+
+  //indices are not range-checked here; DrawIndexed checks them on every draw
+  mesh.m_pIndices = reinterpret_cast<const int*>(stream(8, (uint64_t)h.indexCount * sizeof(int)));
+  mesh.m_uIndexCount = h.indexCount;
+
+  mesh.m_BoundsMin = Vec3(h.bounds[0], h.bounds[1], h.bounds[2]);
+  mesh.m_BoundsMax = Vec3(h.bounds[3], h.bounds[4], h.bounds[5]);
+  mesh.m_pMapping = file;
+  return mesh;
+}
+
+void Mesh::WriteCache(const std::string& path, uint64_t sourceSize, uint64_t sourceTime)const
+{
+  CacheHeader h{};
+  std::memcpy(h.magic, "TRMC", 4);
+  h.version = CACHE_VERSION;
+  h.byteOrder = CACHE_BYTE_ORDER;
+  h.flags = m_bColors ? CACHE_COLORS : 0;
+  h.vertexCount = (uint32_t)m_Positions.Size();
+  h.indexCount = (uint32_t)m_uIndexCount;
+  h.bounds[0] = m_BoundsMin.X();
+  h.bounds[1] = m_BoundsMin.Y();
+  h.bounds[2] = m_BoundsMin.Z();
+  h.bounds[3] = m_BoundsMax.X();
+  h.bounds[4] = m_BoundsMax.Y();
+  h.bounds[5] = m_BoundsMax.Z();
+  h.sourceSize = sourceSize;
+  h.sourceTime = sourceTime;
+
+  uint64_t padded = ((uint64_t)h.vertexCount + 7) & ~(uint64_t)7;
+  const float* streams[8] = {
+    m_Positions.X(), m_Positions.Y(), m_Positions.Z(), m_Positions.W(),
+    m_Colors.X(), m_Colors.Y(), m_Colors.Z(), m_Colors.W()
+  };
+  int count = m_bColors ? 8 : 4;
+
+  uint64_t offset = AlignUp(sizeof(h));
+  for(int k = 0; k < count; k++)
+  {
+    h.offsets[k] = offset;
+    offset = AlignUp(offset + padded * sizeof(float));
+  }
+  h.offsets[8] = offset;
+
+  //written beside the target and renamed over it, so a reader never maps half a file
+  std::string temp = path + ".tmp";
+  std::ofstream file(temp, std::ios::binary);
+  if(!file) throw Invalid{};
+
+  static const char zeros[CACHE_ALIGN] = {};
+  uint64_t written = 0;
+  auto put = [&](const void* data, uint64_t bytes, uint64_t at)
+  {
+    file.write(zeros, (std::streamsize)(at - written));
+    file.write(static_cast<const char*>(data), (std::streamsize)bytes);
+    written = at + bytes;
+  };
+
+  put(&h, sizeof(h), 0);
+  for(int k = 0; k < count; k++)
+  {
+    put(streams[k], padded * sizeof(float), h.offsets[k]);
+  }
+  put(Indices(), m_uIndexCount * sizeof(int), h.offsets[8]);
+  file.close();
+
+  if(!file || std::rename(temp.c_str(), path.c_str()) != 0)
+  {
+    std::remove(temp.c_str());
+    throw Invalid{};
+  }
+}
+
+Vertex Mesh::GetVertex(int index)const
+{
+  Vec4 p = m_Positions.Get(index);
+
+  Vertex v;
+  v.m_Position = Vec3(p.X(), p.Y(), p.Z());
+  v.m_Color = m_bColors ? Vec3(m_Colors.X()[index], m_Colors.Y()[index], m_Colors.Z()[index]) :
+    Vec3(255.0f, 255.0f, 255.0f);
+  return v;
+}
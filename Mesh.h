@@ -0,0 +1,107 @@
+#ifndef TINYRASTER_MESH_H
+#define TINYRASTER_MESH_H
+//--------------------------------------------------------------------
+//
+//  Name: Mesh.h
+//
+//  Desc: Triangle meshes loaded from Wavefront OBJ or PLY files into
+//  the structure-of-arrays VertexBuffer layout, ready for
+//  Framebuffer::DrawIndexed. Source files are memory-mapped and
+//  parsed in place by a tokenizer that never allocates per token
+//  (OBJ in parallel chunks of lines). A loaded mesh can be written to
+//  a binary cache whose streams are stored exactly as the draw calls
+//  read them, so a later run maps it and renders with no parsing and
+//  no copy.
+//
+//  Cache layout (native byte order, checked on load):
+//    "TRMC" version byteOrder flags vertexCount indexCount (u32 each)
+//    bounds min xyz, max xyz (f32), source size, source mtime (u64)
+//    offsets of the x y z w [r g b a] and index streams (u64)
+//    streams, each 64-byte aligned; vertex streams padded to a
+//    multiple of 8 entries
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "./Math.h"
+#include "./Vertex.h"
+#include "./VertexBuffer.h"
+
+class Mesh
+{
+
+public:
+
+  class Invalid{};
+
+  Mesh() : m_bColors(false), m_pIndices(nullptr), m_uIndexCount(0), m_BoundsMin(0.0f, 0.0f, 0.0f),
+           m_BoundsMax(0.0f, 0.0f, 0.0f) {}
+
+  //parses an OBJ ("v" and "f" records; polygons are fanned, negative indices count back from
+  //the last vertex, "v x y z r g b" colors in [0, 1] are kept) or a PLY file (ascii or binary,
+  //told apart by its header) on up to threads threads. Throws Invalid if the file cannot be
+  //read or is malformed.
+  static Mesh Load(const std::string& path, int threads = 1);
+
+  //Load through the cache next to the source (path + ".trmc"): mapped when it exists and was
+  //written from the source at its current size and modification time, otherwise parsed and
+  //(re)written
+  static Mesh LoadCached(const std::string& path, int threads = 1);
+
+  //maps a cache written by WriteCache; the mesh then views the file in place. Throws Invalid if
+  //it is missing, malformed, from a machine of another byte order, or (when sourceSize is not 0)
+  //not written from a source of that size and modification time.
+  static Mesh MapCache(const std::string& path, uint64_t sourceSize = 0, uint64_t sourceTime = 0);
+
+  //writes the mesh as a cache that MapCache can view; sourceSize and sourceTime identify the
+  //file it was parsed from. Throws Invalid if the file cannot be written.
+  void WriteCache(const std::string& path, uint64_t sourceSize = 0, uint64_t sourceTime = 0)const;
+
+  //positions (w = 1) and, if the source had them, per-vertex colors in the framebuffer's 0-255
+  //range as x, y, z = r, g, b
+  const VertexBuffer& Positions()const{return m_Positions;}
+  const VertexBuffer& Colors()const{return m_Colors;}
+  bool HasColors()const{return m_bColors;}
+
+  int VertexCount()const{return m_Positions.Size();}
+
+  //triangle list, three indices into Positions() each
+  const int* Indices()const{return m_pIndices ? m_pIndices : m_Indices.data();}
+  size_t IndexCount()const{return m_uIndexCount;}
+  size_t TriangleCount()const{return m_uIndexCount / 3;}
+
+  //one vertex in the Vertex layout (white when the mesh has no colors)
+  Vertex GetVertex(int index)const;
+
+  //axis-aligned bounds of the positions
+  const Vec3& BoundsMin()const{return m_BoundsMin;}
+  const Vec3& BoundsMax()const{return m_BoundsMax;}
+
+  //true if the mesh views a mapped cache rather than owning its data
+  bool IsMapped()const{return m_pMapping != nullptr;}
+
+private:
+
+  VertexBuffer m_Positions;
+  VertexBuffer m_Colors;
+  bool m_bColors;
+
+  //owned indices, or a view of the mapping's
+  std::vector<int> m_Indices;
+  const int* m_pIndices;
+  size_t m_uIndexCount;
+
+  Vec3 m_BoundsMin;
+  Vec3 m_BoundsMax;
+
+  std::shared_ptr<const void> m_pMapping;
+
+};
+
+#endif
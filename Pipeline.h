@@ -0,0 +1,146 @@
+#ifndef TINYRASTER_PIPELINE_H
+#define TINYRASTER_PIPELINE_H
+//--------------------------------------------------------------------
+//
+//  Name: Pipeline.h
+//
+//  Desc: Programmable shading bound at compile time. A Pipeline pairs
+//  a vertex shader and a fragment shader as template parameters:
+//  both are plain function objects, so there is no virtual call or
+//  std::function anywhere, and the fragment shader is inlined into
+//  the rasterizer's quad loop, which shades 2x2 pixel quads (two at
+//  a time with AVX2). The varyings the vertex shader hands on are a
+//  struct of floats declared by the shaders, and the interpolator is
+//  specialized to exactly that many attributes.
+//
+//    struct VS
+//    {
+//      using Input = ...;     //one vertex as the draw call gets it
+//      using Varyings = ...;  //floats handed to the fragment shader
+//      Vec4 operator()(const Input& in, Varyings& out)const; //clip position
+//    };
+//
+//    struct FS
+//    {
+//      using Varyings = ...;  //the same type as VS::Varyings
+//      Vec3 operator()(const Varyings& in)const;  //r, g, b in [0, 255]
+//    };
+//
+//  A fragment shader may instead take (in, ddx, ddy): ddx and ddy
+//  then hold the screen-space derivatives of every varying, the
+//  differences across its quad, e.g. to pick a texture's level of
+//  detail (Texture::Lod).
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "./Framebuffer.h"
+#include "./Math.h"
+#include "./VertexBuffer.h"
+
+template<typename VS, typename FS>
+class Pipeline
+{
+
+public:
+
+  using Input = typename VS::Input;
+  using Varyings = typename VS::Varyings;
+
+  //floats per vertex the rasterizer interpolates
+  static constexpr int VARYINGS = (int)(sizeof(Varyings) / sizeof(float));
+
+  static_assert(std::is_same<Varyings, typename FS::Varyings>::value,
+    "the fragment shader must take the vertex shader's varyings");
+  static_assert(std::is_trivially_copyable<Varyings>::value && sizeof(Varyings) % sizeof(float) == 0,
+    "varyings must be a plain struct of floats");
+  static_assert(VARYINGS > 0 && VARYINGS <= MAX_VARYINGS, "a pipeline carries 1 to MAX_VARYINGS varyings");
+
+  Pipeline() : m_VS(), m_FS() {}
+  Pipeline(const VS& vs, const FS& fs) : m_VS(vs), m_FS(fs) {}
+
+  //the shaders, e.g. to set their uniforms between draws
+  VS& VertexShader(){return m_VS;}
+  FS& FragmentShader(){return m_FS;}
+  const VS& VertexShader()const{return m_VS;}
+  const FS& FragmentShader()const{return m_FS;}
+
+  //runs the vertex shader once per vertex, then draws the indexed triangle list (three indices
+  //into vertices per triangle) with the fragment shader. Culling, clipping and depth testing
+  //follow the framebuffer's settings as for DrawIndexed. A multithreaded framebuffer may shade
+  //the triangles later, at its next Flush, with the fragment shader as it is here.
+  template<typename FB>
+  void Draw(FB& fb, const Input* vertices, int vertexCount, const int* indices, size_t indexCount)
+  {
+    if(m_Clip.Size() != vertexCount) m_Clip.Resize(vertexCount);
+    m_Varyings.resize(vertexCount);
+
+    float* x = m_Clip.X();
+    float* y = m_Clip.Y();
+    float* z = m_Clip.Z();
+    float* w = m_Clip.W();
+    for(int i = 0; i < vertexCount; i++)
+    {
+      Vec4 p = m_VS(vertices[i], m_Varyings[i]);
+      x[i] = p.X();
+      y[i] = p.Y();
+      z[i] = p.Z();
+      w[i] = p.W();
+    }
+
+    fb.template DrawProgram<VARYINGS>(m_Clip, reinterpret_cast<const float*>(m_Varyings.data()), indices,
+      indexCount, Program{m_FS});
+  }
+
+  template<typename FB>
+  void Draw(FB& fb, const std::vector<Input>& vertices, const std::vector<int>& indices)
+  {
+    Draw(fb, vertices.data(), (int)vertices.size(), indices.data(), indices.size());
+  }
+
+private:
+
+  static constexpr bool DERIVATIVES =
+    std::is_invocable<const FS&, const Varyings&, const Varyings&, const Varyings&>::value;
+
+  //the fragment shader as the rasterizer calls it, on raw floats; with DERIVATIVES it also takes
+  //their ddx and ddy. It holds a copy of the shader, so a framebuffer that records the draw keeps
+  //the uniforms it was drawn with.
+  struct Program
+  {
+    FS fs;
+
+    template<bool D = DERIVATIVES, typename std::enable_if<!D, int>::type = 0>
+    Vec3 operator()(const float* in)const
+    {
+      Varyings v;
+      std::memcpy(static_cast<void*>(&v), in, sizeof(Varyings));
+      return fs(v);
+    }
+
+    template<bool D = DERIVATIVES, typename std::enable_if<D, int>::type = 0>
+    Vec3 operator()(const float* in, const float* ddx, const float* ddy)const
+    {
+      Varyings v, dx, dy;
+      std::memcpy(static_cast<void*>(&v), in, sizeof(Varyings));
+      std::memcpy(static_cast<void*>(&dx), ddx, sizeof(Varyings));
+      std::memcpy(static_cast<void*>(&dy), ddy, sizeof(Varyings));
+      return fs(v, dx, dy);
+    }
+  };
+
+  VS m_VS;
+  FS m_FS;
+
+  //vertex shader output: clip positions and varyings, one per vertex
+  VertexBuffer m_Clip;
+  std::vector<Varyings> m_Varyings;
+
+};
+
+#endif
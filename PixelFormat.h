@@ -0,0 +1,503 @@
+#ifndef TINYRASTER_PIXELFORMAT_H
+#define TINYRASTER_PIXELFORMAT_H
+//----------------------------------------------------------
+//
+//  Name: PixelFormat.h
+//
+//  Desc: Pixel formats a framebuffer can be stored in (RGB8,
+//  RGBA8, RGB565 and float RGBA), depth formats (float32 and
+//  16-bit unorm) and the traits used to write and read them.
+//  Every format is trivially copyable, so framebuffers are
+//  cleared and copied with wide memory operations.
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//----------------------------------------------------------
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "./Color.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+//24-bit rgb, the layout written to ppm files
+using RGB8 = Color;
+
+//32-bit rgba, one pixel per aligned 32-bit word
+struct alignas(4) RGBA8
+{
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+  uint8_t a;
+};
+
+//16-bit 5:6:5 rgb, red in the top bits
+struct RGB565
+{
+  uint16_t v;
+};
+
+//one float per channel in [0, 1]
+struct alignas(16) RGBA32F
+{
+  float r;
+  float g;
+  float b;
+  float a;
+};
+
+static_assert(std::is_trivially_copyable<RGB8>::value && sizeof(RGB8) == 3, "RGB8 must be 3 packed bytes");
+static_assert(std::is_trivially_copyable<RGBA8>::value && sizeof(RGBA8) == 4, "RGBA8 must be 4 bytes");
+static_assert(std::is_trivially_copyable<RGB565>::value && sizeof(RGB565) == 2, "RGB565 must be 2 bytes");
+static_assert(std::is_trivially_copyable<RGBA32F>::value && sizeof(RGBA32F) == 16, "RGBA32F must be 16 bytes");
+
+//per-format conversions. Pack takes 8-bit channels, Shade takes interpolated channels already
+//clamped to [0, 255], Unpack gives the 8-bit color that is written to a ppm. StoreBlock writes
+//8 consecutive shaded pixels from clamped AVX2 lanes. Resolve averages the count (4 or 8)
+//samples of a multisampled pixel, rounding to nearest.
+template<typename P>
+struct PixelTraits;
+
+template<>
+struct PixelTraits<RGB8>
+{
+  static RGB8 Pack(uint8_t r, uint8_t g, uint8_t b){ return RGB8(r, g, b); }
+
+  static void Shade(RGB8& px, float r, float g, float b)
+  {
+    px.r = (uint8_t)r;
+    px.g = (uint8_t)g;
+    px.b = (uint8_t)b;
+  }
+
+  static Color Unpack(const RGB8& px){ return px; }
+
+  static RGB8 Resolve(const RGB8* samples, int count)
+  {
+#if defined(__AVX2__)
+    //four samples (12 bytes) per step, spread to rgbx and widened to 16-bit channel sums
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i sum = _mm_setzero_si128();
+    for(int k = 0; k < count; k += 4)
+    {
+      const uint8_t* bytes = reinterpret_cast<const uint8_t*>(samples + k);
+      int32_t tail;
+      std::memcpy(&tail, bytes + 8, 4);
+
+      __m128i v = _mm_insert_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes)), tail, 2);
+      v = _mm_shuffle_epi8(v, spread);
+      sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_cvtepu8_epi16(v), _mm_cvtepu8_epi16(_mm_srli_si128(v, 8))));
+    }
+    sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+    sum = _mm_srl_epi16(_mm_add_epi16(sum, _mm_set1_epi16((short)(count / 2))), _mm_cvtsi32_si128(count == 8 ? 3 : 2));
+
+    int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+    return RGB8((uint8_t)packed, (uint8_t)(packed >> 8), (uint8_t)(packed >> 16));
+#else
+    int r = 0, g = 0, b = 0;
+    for(int k = 0; k < count; k++)
+    {
+      r += samples[k].r;
+      g += samples[k].g;
+      b += samples[k].b;
+    }
+    int half = count / 2;
+    return RGB8((uint8_t)((r + half) / count), (uint8_t)((g + half) / count), (uint8_t)((b + half) / count));
+#endif
+  }
+
+#if defined(__AVX2__)
+  static void StoreBlock(RGB8* dst, __m256 r, __m256 g, __m256 b)
+  {
+    __m256i rgb = _mm256_or_si256(_mm256_cvttps_epi32(r), _mm256_or_si256(
+      _mm256_slli_epi32(_mm256_cvttps_epi32(g), 8), _mm256_slli_epi32(_mm256_cvttps_epi32(b), 16)));
+
+    //squeeze 8 rgbx lanes into 24 contiguous bytes
+    const __m256i squeeze = _mm256_setr_epi8(
+      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m256i bytes = _mm256_shuffle_epi8(rgb, squeeze);
+    __m128i lo = _mm256_castsi256_si128(bytes);
+    __m128i hi = _mm256_extracti128_si256(bytes, 1);
+
+    uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 12), hi);
+    int32_t tail = _mm_extract_epi32(hi, 2);
+    std::memcpy(out + 20, &tail, 4);
+  }
+#endif
+};
+
+template<>
+struct PixelTraits<RGBA8>
+{
+  static RGBA8 Pack(uint8_t r, uint8_t g, uint8_t b){ return RGBA8{r, g, b, 255}; }
+
+  static void Shade(RGBA8& px, float r, float g, float b)
+  {
+    px = RGBA8{(uint8_t)r, (uint8_t)g, (uint8_t)b, 255};
+  }
+
+  static Color Unpack(const RGBA8& px){ return Color(px.r, px.g, px.b); }
+
+  static RGBA8 Resolve(const RGBA8* samples, int count)
+  {
+#if defined(__AVX2__)
+    //four samples per load, widened to 16-bit channel sums
+    __m128i sum = _mm_setzero_si128();
+    for(int k = 0; k < count; k += 4)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + k));
+      sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_cvtepu8_epi16(v), _mm_cvtepu8_epi16(_mm_srli_si128(v, 8))));
+    }
+    sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+    sum = _mm_srl_epi16(_mm_add_epi16(sum, _mm_set1_epi16((short)(count / 2))), _mm_cvtsi32_si128(count == 8 ? 3 : 2));
+
+    int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+    RGBA8 px;
+    std::memcpy(&px, &packed, sizeof(px));
+    return px;
+#else
+    int r = 0, g = 0, b = 0, a = 0;
+    for(int k = 0; k < count; k++)
+    {
+      r += samples[k].r;
+      g += samples[k].g;
+      b += samples[k].b;
+      a += samples[k].a;
+    }
+    int half = count / 2;
+    return RGBA8{(uint8_t)((r + half) / count), (uint8_t)((g + half) / count), (uint8_t)((b + half) / count),
+      (uint8_t)((a + half) / count)};
+#endif
+  }
+
+#if defined(__AVX2__)
+  static void StoreBlock(RGBA8* dst, __m256 r, __m256 g, __m256 b)
+  {
+    __m256i rgba = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cvttps_epi32(r), _mm256_slli_epi32(_mm256_cvttps_epi32(g), 8)),
+      _mm256_or_si256(_mm256_slli_epi32(_mm256_cvttps_epi32(b), 16), _mm256_set1_epi32((int32_t)0xFF000000)));
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), rgba);
+  }
+#endif
+};
+
+template<>
+struct PixelTraits<RGB565>
+{
+  static RGB565 Pack(uint8_t r, uint8_t g, uint8_t b)
+  {
+    return RGB565{(uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3))};
+  }
+
+  static void Shade(RGB565& px, float r, float g, float b)
+  {
+    px = Pack((uint8_t)r, (uint8_t)g, (uint8_t)b);
+  }
+
+  //the top bits are replicated into the low ones so full intensity stays 255
+  static Color Unpack(const RGB565& px)
+  {
+    uint8_t r = (uint8_t)(px.v >> 11);
+    uint8_t g = (uint8_t)((px.v >> 5) & 0x3F);
+    uint8_t b = (uint8_t)(px.v & 0x1F);
+    return Color((uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)),
+      (uint8_t)((b << 3) | (b >> 2)));
+  }
+
+  //averaged per 5/6/5-bit field
+  static RGB565 Resolve(const RGB565* samples, int count)
+  {
+#if defined(__AVX2__)
+    //the fields of up to eight samples in 16-bit lanes, summed across them by pairwise adds
+    __m128i v = count == 8 ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples)) :
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples));
+    __m128i r = _mm_srli_epi16(v, 11);
+    __m128i g = _mm_and_si128(_mm_srli_epi16(v, 5), _mm_set1_epi16(0x3F));
+    __m128i b = _mm_and_si128(v, _mm_set1_epi16(0x1F));
+
+    __m128i sum = _mm_hadd_epi16(_mm_hadd_epi16(r, g), _mm_hadd_epi16(b, _mm_setzero_si128()));
+    sum = _mm_hadd_epi16(sum, _mm_setzero_si128());
+    sum = _mm_srl_epi16(_mm_add_epi16(sum, _mm_set1_epi16((short)(count / 2))), _mm_cvtsi32_si128(count == 8 ? 3 : 2));
+
+    return RGB565{(uint16_t)((_mm_extract_epi16(sum, 0) << 11) | (_mm_extract_epi16(sum, 1) << 5) |
+      _mm_extract_epi16(sum, 2))};
+#else
+    int r = 0, g = 0, b = 0;
+    for(int k = 0; k < count; k++)
+    {
+      r += samples[k].v >> 11;
+      g += (samples[k].v >> 5) & 0x3F;
+      b += samples[k].v & 0x1F;
+    }
+    int half = count / 2;
+    return RGB565{(uint16_t)((((r + half) / count) << 11) | (((g + half) / count) << 5) | ((b + half) / count))};
+#endif
+  }
+
+#if defined(__AVX2__)
+  static void StoreBlock(RGB565* dst, __m256 r, __m256 g, __m256 b)
+  {
+    __m256i v = _mm256_or_si256(
+      _mm256_slli_epi32(_mm256_srli_epi32(_mm256_cvttps_epi32(r), 3), 11),
+      _mm256_or_si256(_mm256_slli_epi32(_mm256_srli_epi32(_mm256_cvttps_epi32(g), 2), 5),
+        _mm256_srli_epi32(_mm256_cvttps_epi32(b), 3)));
+
+    //narrow to 16 bits: packus works per 128-bit half, so gather the two low qwords
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(packed));
+  }
+#endif
+};
+
+template<>
+struct PixelTraits<RGBA32F>
+{
+  static RGBA32F Pack(uint8_t r, uint8_t g, uint8_t b)
+  {
+    return RGBA32F{(float)r / 255.0f, (float)g / 255.0f, (float)b / 255.0f, 1.0f};
+  }
+
+  static void Shade(RGBA32F& px, float r, float g, float b)
+  {
+    px = RGBA32F{r / 255.0f, g / 255.0f, b / 255.0f, 1.0f};
+  }
+
+  static Color Unpack(const RGBA32F& px)
+  {
+    auto channel = [](float v)
+    {
+      return v > 0.0f ? (v < 1.0f ? (uint8_t)(v * 255.0f + 0.5f) : (uint8_t)255) : (uint8_t)0;
+    };
+    return Color(channel(px.r), channel(px.g), channel(px.b));
+  }
+
+  static RGBA32F Resolve(const RGBA32F* samples, int count)
+  {
+#if defined(__AVX2__)
+    __m128 sum = _mm_setzero_ps();
+    for(int k = 0; k < count; k++) sum = _mm_add_ps(sum, _mm_load_ps(&samples[k].r));
+
+    RGBA32F px;
+    _mm_store_ps(&px.r, _mm_mul_ps(sum, _mm_set1_ps(1.0f / (float)count)));
+    return px;
+#else
+    RGBA32F px{0.0f, 0.0f, 0.0f, 0.0f};
+    for(int k = 0; k < count; k++)
+    {
+      px.r += samples[k].r;
+      px.g += samples[k].g;
+      px.b += samples[k].b;
+      px.a += samples[k].a;
+    }
+    float inv = 1.0f / (float)count;
+    return RGBA32F{px.r * inv, px.g * inv, px.b * inv, px.a * inv};
+#endif
+  }
+
+#if defined(__AVX2__)
+  static void StoreBlock(RGBA32F* dst, __m256 r, __m256 g, __m256 b)
+  {
+    const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+    r = _mm256_mul_ps(r, scale);
+    g = _mm256_mul_ps(g, scale);
+    b = _mm256_mul_ps(b, scale);
+    __m256 a = _mm256_set1_ps(1.0f);
+
+    //4x8 transpose: each 128-bit half of p04 holds pixel 0 and pixel 4, and so on
+    __m256 rgLo = _mm256_unpacklo_ps(r, g);
+    __m256 rgHi = _mm256_unpackhi_ps(r, g);
+    __m256 baLo = _mm256_unpacklo_ps(b, a);
+    __m256 baHi = _mm256_unpackhi_ps(b, a);
+    __m256 p04 = _mm256_shuffle_ps(rgLo, baLo, 0x44);
+    __m256 p15 = _mm256_shuffle_ps(rgLo, baLo, 0xEE);
+    __m256 p26 = _mm256_shuffle_ps(rgHi, baHi, 0x44);
+    __m256 p37 = _mm256_shuffle_ps(rgHi, baHi, 0xEE);
+
+    float* out = reinterpret_cast<float*>(dst);
+    _mm256_storeu_ps(out, _mm256_permute2f128_ps(p04, p15, 0x20));
+    _mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(p26, p37, 0x20));
+    _mm256_storeu_ps(out + 16, _mm256_permute2f128_ps(p04, p15, 0x31));
+    _mm256_storeu_ps(out + 24, _mm256_permute2f128_ps(p26, p37, 0x31));
+  }
+#endif
+};
+
+//depth attachment formats. Depth is tested with LESS: smaller values are nearer. UNORM16 maps
+//[0, 1] to 0..65535; F32 stores the interpolated value as is.
+enum class DepthFormat
+{
+  NONE,
+  F32,
+  UNORM16
+};
+
+//per-format depth conversions. Encode turns an interpolated depth into the stored value, Test
+//does one pixel's depth test and write (write only when test is false). TestBlock does the same
+//for 8 consecutive pixels selected by mask and returns the mask of pixels that passed; full
+//means all 8 pixels lie inside the span and may be loaded and stored together. Bounds widens
+//[lo, hi] to take in count consecutive stored values.
+template<typename D>
+struct DepthTraits;
+
+template<>
+struct DepthTraits<float>
+{
+  static float Encode(float z){ return z; }
+  static float Decode(float d){ return d; }
+
+  static bool Test(float& stored, float z, bool test)
+  {
+    if(test && !(z < stored)) return false;
+    stored = z;
+    return true;
+  }
+
+  static void Bounds(const float* src, int count, float& lo, float& hi)
+  {
+    int i = 0;
+#if defined(__AVX2__)
+    if(count >= 8)
+    {
+      __m256 vlo = _mm256_set1_ps(lo), vhi = _mm256_set1_ps(hi);
+      for(; i + 8 <= count; i += 8)
+      {
+        __m256 v = _mm256_loadu_ps(src + i);
+        vlo = _mm256_min_ps(vlo, v);
+        vhi = _mm256_max_ps(vhi, v);
+      }
+
+      alignas(32) float l[8], h[8];
+      _mm256_store_ps(l, vlo);
+      _mm256_store_ps(h, vhi);
+      for(int k = 0; k < 8; k++)
+      {
+        lo = std::min(lo, l[k]);
+        hi = std::max(hi, h[k]);
+      }
+    }
+#endif
+    for(; i < count; i++)
+    {
+      lo = std::min(lo, src[i]);
+      hi = std::max(hi, src[i]);
+    }
+  }
+
+#if defined(__AVX2__)
+  static int TestBlock(float* dst, __m256 z, int mask, bool, bool test)
+  {
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    if(test)
+    {
+      __m256i lanes = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), bits), bits);
+      __m256 stored = _mm256_maskload_ps(dst, lanes);
+      mask &= _mm256_movemask_ps(_mm256_cmp_ps(z, stored, _CMP_LT_OQ));
+    }
+
+    __m256i pass = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), bits), bits);
+    _mm256_maskstore_ps(dst, pass, z);
+    return mask;
+  }
+#endif
+};
+
+template<>
+struct DepthTraits<uint16_t>
+{
+  static uint16_t Encode(float z)
+  {
+    z = z > 0.0f ? (z < 1.0f ? z : 1.0f) : 0.0f;
+    return (uint16_t)(z * 65535.0f + 0.5f);
+  }
+
+  static float Decode(uint16_t d){ return (float)d / 65535.0f; }
+
+  static bool Test(uint16_t& stored, float z, bool test)
+  {
+    uint16_t q = Encode(z);
+    if(test && !(q < stored)) return false;
+    stored = q;
+    return true;
+  }
+
+  static void Bounds(const uint16_t* src, int count, float& lo, float& hi)
+  {
+    int i = 0;
+    uint16_t l = 0xFFFF, h = 0;
+#if defined(__AVX2__)
+    if(count >= 16)
+    {
+      __m256i vlo = _mm256_set1_epi16(-1), vhi = _mm256_setzero_si256();
+      for(; i + 16 <= count; i += 16)
+      {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        vlo = _mm256_min_epu16(vlo, v);
+        vhi = _mm256_max_epu16(vhi, v);
+      }
+
+      alignas(32) uint16_t ls[16], hs[16];
+      _mm256_store_si256(reinterpret_cast<__m256i*>(ls), vlo);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(hs), vhi);
+      for(int k = 0; k < 16; k++)
+      {
+        l = std::min(l, ls[k]);
+        h = std::max(h, hs[k]);
+      }
+    }
+#endif
+    for(; i < count; i++)
+    {
+      l = std::min(l, src[i]);
+      h = std::max(h, src[i]);
+    }
+
+    if(count == 0) return;
+    lo = std::min(lo, (float)l);
+    hi = std::max(hi, (float)h);
+  }
+
+#if defined(__AVX2__)
+  static int TestBlock(uint16_t* dst, __m256 z, int mask, bool full, bool test)
+  {
+    if(!full)
+    {
+      alignas(32) float lz[8];
+      _mm256_store_ps(lz, z);
+
+      for(int m = mask; m; m &= m - 1)
+      {
+        int i = __builtin_ctz(m);
+        if(!Test(dst[i], lz[i], test)) mask &= ~(1 << i);
+      }
+      return mask;
+    }
+
+    __m256 clamped = _mm256_min_ps(_mm256_max_ps(z, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    __m256i q = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, _mm256_set1_ps(65535.0f)),
+      _mm256_set1_ps(0.5f)));
+
+    __m256i stored = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(dst)));
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    if(test) mask &= _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(stored, q)));
+
+    __m256i pass = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), bits), bits);
+    __m256i merged = _mm256_blendv_epi8(stored, q, pass);
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(merged, merged), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(packed));
+    return mask;
+  }
+#endif
+};
+
+#endif
@@ -0,0 +1,351 @@
+#ifndef TINYRASTER_PRIMITIVEASSEMBLY_H
+#define TINYRASTER_PRIMITIVEASSEMBLY_H
+//--------------------------------------------------------------------
+//
+//  Name: PrimitiveAssembly.h
+//
+//  Desc: Primitive assembly for indexed drawing. Triangles are built
+//  from post-transform vertices, rejected when they lie entirely
+//  outside the view frustum or face the wrong way, and those crossing
+//  the near plane (or leaving the rasterizer's guard band) are clipped
+//  in homogeneous clip space with Sutherland-Hodgman before the
+//  divide. The other planes are left to the guard band: the
+//  rasterizers already scissor to the framebuffer.
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "./Math.h"
+#include "./Raster.h"
+#include "./VertexBuffer.h"
+
+//which triangles are dropped by facing
+enum class CullMode
+{
+  NONE,
+  BACK,
+  FRONT
+};
+
+//winding of front faces in normalized device coordinates (x right, y up)
+enum class Winding
+{
+  CCW,
+  CW
+};
+
+//running totals of the assembly stage
+struct ClipStats
+{
+  uint64_t triangles;      //assembled from indices
+  uint64_t culledFacing;   //dropped by the cull mode (degenerate triangles included)
+  uint64_t culledFrustum;  //entirely outside one frustum plane, behind the near plane included
+  uint64_t clipped;        //crossed the near plane or the guard band and went through the clipper
+};
+
+//a vertex created by the clipper: its depth and 1/w after the viewport map, and the weights of
+//the three source vertices it lies between in clip space, so any per-vertex attribute can be
+//interpolated for it
+struct ClippedVertex
+{
+  float z;
+  float invW;
+  int source[3];
+  float weight[3];
+};
+
+class PrimitiveAssembler
+{
+
+public:
+
+  PrimitiveAssembler() : m_CullMode(CullMode::NONE),
+                         m_FrontFace(Winding::CCW),
+                         m_Stats{},
+                         m_pPositions(nullptr)
+  {}
+
+  void SetCullMode(CullMode mode){ m_CullMode = mode; }
+  CullMode GetCullMode()const{ return m_CullMode; }
+
+  void SetFrontFace(Winding winding){ m_FrontFace = winding; }
+  Winding GetFrontFace()const{ return m_FrontFace; }
+
+  const ClipStats& Stats()const{ return m_Stats; }
+  void ResetStats(){ m_Stats = ClipStats{}; }
+
+  //assembles the triangle list indices (three per triangle) over vertices, which cache holds
+  //transformed by m and vp. The surviving triangles are left in Indices(), as indices into
+  //Positions(): the cache's screen positions followed by any vertices the clipper created,
+  //which are described in the same order by Clipped().
+  void Assemble(const Mat4& m, const Viewport& vp, const VertexBuffer& vertices, const VertexCache& cache,
+    const std::vector<int>& indices)
+  {
+    Assemble(m, vp, vertices, cache, indices.data(), indices.size());
+  }
+
+  void Assemble(const Mat4& m, const Viewport& vp, const VertexBuffer& vertices, const VertexCache& cache,
+    const int* indices, size_t indexCount)
+  {
+    const std::vector<Vec2>& screen = cache.Screen();
+    const float* sz = cache.Vertices().Z();
+    const float* iw = cache.Vertices().W();
+
+    m_pPositions = &screen;
+    m_Indices.clear();
+    m_Extra.clear();
+    m_Clipped.clear();
+
+    Frustum f = MakeFrustum(vp);
+
+    for(size_t t = 0; t + 2 < indexCount; t += 3)
+    {
+      int i0 = indices[t], i1 = indices[t + 1], i2 = indices[t + 2];
+      m_Stats.triangles++;
+
+      uint32_t c0 = Outcode(f, screen[i0], sz[i0], iw[i0]);
+      uint32_t c1 = Outcode(f, screen[i1], sz[i1], iw[i1]);
+      uint32_t c2 = Outcode(f, screen[i2], sz[i2], iw[i2]);
+
+      if(c0 & c1 & c2 & OUT_REJECT)
+      {
+        m_Stats.culledFrustum++;
+        continue;
+      }
+
+      if((c0 | c1 | c2) & OUT_CLIP)
+      {
+        m_Stats.clipped++;
+        ClipTriangle(m, vp, f, vertices, screen, i0, i1, i2);
+        continue;
+      }
+
+      const Vec2& p0 = screen[i0];
+      const Vec2& p1 = screen[i1];
+      const Vec2& p2 = screen[i2];
+      float area = (p1.X() - p0.X()) * (p2.Y() - p0.Y()) - (p2.X() - p0.X()) * (p1.Y() - p0.Y());
+      if(Culled(area, f))
+      {
+        m_Stats.culledFacing++;
+        continue;
+      }
+
+      m_Indices.insert(m_Indices.end(), {i0, i1, i2});
+    }
+
+    //clipped vertices need a position list of their own; otherwise the cache's is used as is
+    if(!m_Extra.empty())
+    {
+      m_Positions.assign(screen.begin(), screen.end());
+      m_Positions.insert(m_Positions.end(), m_Extra.begin(), m_Extra.end());
+      m_pPositions = &m_Positions;
+    }
+  }
+
+  const std::vector<Vec2>& Positions()const{ return *m_pPositions; }
+  const std::vector<int>& Indices()const{ return m_Indices; }
+  const std::vector<ClippedVertex>& Clipped()const{ return m_Clipped; }
+
+private:
+
+  //outcode bits. A triangle is rejected when all three corners share a bit of OUT_REJECT and
+  //clipped when any corner has a bit of OUT_CLIP.
+  static constexpr uint32_t OUT_NEAR = 1;
+  static constexpr uint32_t OUT_FAR = 2;
+  static constexpr uint32_t OUT_LEFT = 4;
+  static constexpr uint32_t OUT_RIGHT = 8;
+  static constexpr uint32_t OUT_BOTTOM = 16;
+  static constexpr uint32_t OUT_TOP = 32;
+  static constexpr uint32_t OUT_GUARD = 64;
+  static constexpr uint32_t OUT_REJECT = OUT_NEAR | OUT_FAR | OUT_LEFT | OUT_RIGHT | OUT_BOTTOM | OUT_TOP;
+  static constexpr uint32_t OUT_CLIP = OUT_NEAR | OUT_GUARD;
+
+  //the viewport inverted back to normalized device coordinates, and the guard band: half the
+  //rasterizer's, in pixels and as ndc bounds for the clip planes
+  struct Frustum
+  {
+    float invScaleX, invScaleY, invScaleZ;
+    float offsetX, offsetY, offsetZ;
+    float band;
+    float loX, hiX, loY, hiY;
+    bool flipped;
+  };
+
+  //a polygon corner during clipping: clip-space position, the source vertex (or -1 for one
+  //created by the clipper) and its weights over the triangle's three source vertices
+  struct ClipVertex
+  {
+    Vec4 p;
+    int index;
+    Vec3 weight;
+  };
+
+  static Frustum MakeFrustum(const Viewport& vp)
+  {
+    Frustum f{};
+    f.invScaleX = 1.0f / vp.scaleX;
+    f.invScaleY = 1.0f / vp.scaleY;
+    f.invScaleZ = 1.0f / vp.scaleZ;
+    f.offsetX = vp.offsetX;
+    f.offsetY = vp.offsetY;
+    f.offsetZ = vp.offsetZ;
+    f.band = (float)(GUARD_BAND / 2);
+
+    float x0 = (-f.band - vp.offsetX) * f.invScaleX, x1 = (f.band - vp.offsetX) * f.invScaleX;
+    float y0 = (-f.band - vp.offsetY) * f.invScaleY, y1 = (f.band - vp.offsetY) * f.invScaleY;
+    f.loX = std::min(x0, x1);
+    f.hiX = std::max(x0, x1);
+    f.loY = std::min(y0, y1);
+    f.hiY = std::max(y0, y1);
+
+    //a viewport that mirrors one axis (the usual top-down y) reverses screen-space winding
+    f.flipped = (vp.scaleX < 0.0f) != (vp.scaleY < 0.0f);
+    return f;
+  }
+
+  //classifies a transformed vertex from its screen position, depth and 1/w. A vertex on or
+  //behind the eye (w <= 0) is only marked OUT_NEAR: its divided position means nothing.
+  static uint32_t Outcode(const Frustum& f, const Vec2& s, float z, float invW)
+  {
+    if(!(invW > 0.0f)) return OUT_NEAR;
+
+    float x = (s.X() - f.offsetX) * f.invScaleX;
+    float y = (s.Y() - f.offsetY) * f.invScaleY;
+    float d = (z - f.offsetZ) * f.invScaleZ;
+
+    uint32_t code = 0;
+    if(d < -1.0f) code |= OUT_NEAR;
+    if(d > 1.0f) code |= OUT_FAR;
+    if(x < -1.0f) code |= OUT_LEFT;
+    if(x > 1.0f) code |= OUT_RIGHT;
+    if(y < -1.0f) code |= OUT_BOTTOM;
+    if(y > 1.0f) code |= OUT_TOP;
+    if(!(std::fabs(s.X()) <= f.band && std::fabs(s.Y()) <= f.band)) code |= OUT_GUARD;
+    return code;
+  }
+
+  //true if a polygon with this screen-space signed area is dropped by the cull mode
+  bool Culled(float area, const Frustum& f)const
+  {
+    if(m_CullMode == CullMode::NONE) return false;
+    if(area == 0.0f) return true;
+
+    bool ccw = (area > 0.0f) != f.flipped;
+    bool front = ccw == (m_FrontFace == Winding::CCW);
+    return front == (m_CullMode == CullMode::FRONT);
+  }
+
+  //Sutherland-Hodgman against the near plane (z >= -w) and the guard band planes, then the
+  //divide and a fan over the remaining polygon. New points are always interpolated from the
+  //inside corner, so an edge shared by two clipped triangles is cut at the same point.
+  void ClipTriangle(const Mat4& m, const Viewport& vp, const Frustum& f, const VertexBuffer& vertices,
+    const std::vector<Vec2>& screen, int i0, int i1, int i2)
+  {
+    m_Poly.clear();
+    m_Poly.push_back(ClipVertex{m * vertices.Get(i0), i0, Vec3(1.0f, 0.0f, 0.0f)});
+    m_Poly.push_back(ClipVertex{m * vertices.Get(i1), i1, Vec3(0.0f, 1.0f, 0.0f)});
+    m_Poly.push_back(ClipVertex{m * vertices.Get(i2), i2, Vec3(0.0f, 0.0f, 1.0f)});
+
+    const Vec4 planes[5] = {
+      Vec4(0.0f, 0.0f, 1.0f, 1.0f),
+      Vec4(1.0f, 0.0f, 0.0f, -f.loX),
+      Vec4(-1.0f, 0.0f, 0.0f, f.hiX),
+      Vec4(0.0f, 1.0f, 0.0f, -f.loY),
+      Vec4(0.0f, -1.0f, 0.0f, f.hiY)
+    };
+
+    for(const Vec4& plane : planes)
+    {
+      m_Next.clear();
+      size_t n = m_Poly.size();
+      for(size_t k = 0; k < n; k++)
+      {
+        const ClipVertex& a = m_Poly[k];
+        const ClipVertex& b = m_Poly[(k + 1) % n];
+        float da = a.p.Dot(plane);
+        float db = b.p.Dot(plane);
+
+        if(da >= 0.0f) m_Next.push_back(a);
+        if((da >= 0.0f) != (db >= 0.0f))
+        {
+          const ClipVertex& in = da >= 0.0f ? a : b;
+          const ClipVertex& out = da >= 0.0f ? b : a;
+          float t = da >= 0.0f ? da / (da - db) : db / (db - da);
+          m_Next.push_back(ClipVertex{in.p + (out.p - in.p) * t, -1, in.weight + (out.weight - in.weight) * t});
+        }
+      }
+
+      m_Poly.swap(m_Next);
+      if(m_Poly.size() < 3) return;
+    }
+
+    //screen positions: the cached ones for original corners, divided and mapped for new ones
+    size_t n = m_Poly.size();
+    int base = (int)screen.size();
+    m_PolyIndex.resize(n);
+    m_PolyScreen.resize(n);
+    for(size_t k = 0; k < n; k++)
+    {
+      const ClipVertex& c = m_Poly[k];
+      if(c.index >= 0)
+      {
+        m_PolyIndex[k] = c.index;
+        m_PolyScreen[k] = screen[c.index];
+        continue;
+      }
+
+      float invW = 1.0f / c.p.W();
+      Vec2 s(c.p.X() * invW * vp.scaleX + vp.offsetX, c.p.Y() * invW * vp.scaleY + vp.offsetY);
+      m_PolyIndex[k] = base + (int)m_Extra.size();
+      m_PolyScreen[k] = s;
+      m_Extra.push_back(s);
+      m_Clipped.push_back(ClippedVertex{c.p.Z() * invW * vp.scaleZ + vp.offsetZ, invW, {i0, i1, i2},
+        {c.weight.X(), c.weight.Y(), c.weight.Z()}});
+    }
+
+    //the clipped polygon is planar and convex, so its winding decides for every fan triangle
+    float area = 0.0f;
+    for(size_t k = 0; k < n; k++)
+    {
+      const Vec2& a = m_PolyScreen[k];
+      const Vec2& b = m_PolyScreen[(k + 1) % n];
+      area += a.X() * b.Y() - b.X() * a.Y();
+    }
+
+    if(Culled(area, f))
+    {
+      m_Stats.culledFacing++;
+      return;
+    }
+
+    for(size_t k = 1; k + 1 < n; k++)
+    {
+      m_Indices.insert(m_Indices.end(), {m_PolyIndex[0], m_PolyIndex[k], m_PolyIndex[k + 1]});
+    }
+  }
+
+  CullMode m_CullMode;
+  Winding m_FrontFace;
+  ClipStats m_Stats;
+
+  //output: surviving triangles, and the position list they index when clipping added vertices
+  const std::vector<Vec2>* m_pPositions;
+  std::vector<int> m_Indices;
+  std::vector<Vec2> m_Positions;
+  std::vector<Vec2> m_Extra;
+  std::vector<ClippedVertex> m_Clipped;
+
+  //clipper scratch
+  std::vector<ClipVertex> m_Poly;
+  std::vector<ClipVertex> m_Next;
+  std::vector<int> m_PolyIndex;
+  std::vector<Vec2> m_PolyScreen;
+
+};
+
+#endif
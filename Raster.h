@@ -0,0 +1,837 @@
+#ifndef TINYRASTER_RASTER_H
+#define TINYRASTER_RASTER_H
+//--------------------------------------------------------------------
+//
+//  Name: Raster.h
+//
+//  Desc: Triangle setup and span kernels shared by the rasterizers.
+//  Vertices are snapped to 28.4 fixed point and edges are evaluated
+//  with exact integer arithmetic and a top-left fill rule, so pixels
+//  on shared edges are written exactly once. Spans are evaluated 8
+//  (AVX2) or 4 (SSE4.1) pixels at a time when the compiler targets
+//  those instruction sets, scalar otherwise.
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "./PixelFormat.h"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+//sub-pixel precision of the rasterizer: 4 fractional bits (28.4)
+#define SUBPIXEL_BITS 4
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+#define SUBPIXEL_HALF (SUBPIXEL_ONE / 2)
+
+//vertices are clamped to this many pixels from the origin so setup products stay within 64 bits
+#define GUARD_BAND (1 << 20)
+
+//most float attributes (varyings) a vertex can carry into a triangle
+#define MAX_VARYINGS 16
+
+//most samples per pixel of a multisampled framebuffer
+#define MAX_SAMPLES 8
+
+//pixels across a block of quads (2x2 pixels each) that fragment programs are run on: two quads
+//side by side with AVX2, so a block fills one 8-lane register, one quad otherwise
+#if defined(__AVX2__)
+#define QUAD_BLOCK 4
+#else
+#define QUAD_BLOCK 2
+#endif
+
+//snaps a screen coordinate to 28.4 fixed point
+inline int64_t ToFixed(float v)
+{
+  if(v > (float)GUARD_BAND) v = (float)GUARD_BAND;
+  if(v < -(float)GUARD_BAND) v = -(float)GUARD_BAND;
+  return (int64_t)std::lround(v * (float)SUBPIXEL_ONE);
+}
+
+//index of the pixel containing a screen coordinate, clamped to the guard band
+inline int64_t ToPixel(float v)
+{
+  if(v > (float)GUARD_BAND) v = (float)GUARD_BAND;
+  if(v < -(float)GUARD_BAND) v = -(float)GUARD_BAND;
+  return (int64_t)std::floor(v);
+}
+
+//integer division rounding towards negative infinity
+inline int64_t FloorDiv(int64_t a, int64_t b)
+{
+  int64_t q = a / b;
+  if((a % b != 0) && ((a < 0) != (b < 0))) q--;
+  return q;
+}
+
+//one pixel repeated over 96 bytes: a whole number of pixels of every format (2, 3, 4 or 16
+//bytes) and of 32-byte registers
+struct FillPattern
+{
+  alignas(32) uint8_t bytes[96];
+};
+
+template<typename P>
+inline FillPattern MakeFillPattern(const P& px)
+{
+  static_assert(96 % sizeof(P) == 0, "pixel size must divide the fill pattern");
+
+  FillPattern p;
+  for(size_t i = 0; i < 96; i += sizeof(P))
+  {
+    std::memcpy(p.bytes + i, &px, sizeof(P));
+  }
+  return p;
+}
+
+//fills count consecutive pixels with a pattern using wide stores
+template<typename P>
+inline void FillPixels(P* dst, int count, const FillPattern& p)
+{
+  uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+  size_t bytes = (size_t)count * sizeof(P);
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i p0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(p.bytes));
+  const __m256i p1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(p.bytes + 32));
+  const __m256i p2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(p.bytes + 64));
+
+  for(; i + 96 <= bytes; i += 96)
+  {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), p0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 32), p1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 64), p2);
+  }
+#else
+  for(; i + 96 <= bytes; i += 96)
+  {
+    std::memcpy(out + i, p.bytes, 96);
+  }
+#endif
+
+  std::memcpy(out + i, p.bytes, bytes - i);
+}
+
+//per-triangle edge equations plus the clipped pixel bounding box to walk
+struct TriangleSetup
+{
+  //edge i is opposite vertex i: e(X, Y) = a*X + b*Y + c with X, Y in 28.4. The top-left bias
+  //is folded into c, so a pixel is covered exactly when all three edges are >= 0.
+  int64_t a[3];
+  int64_t b[3];
+  int64_t c[3];
+
+  //1 / twice the area in 1/256 px^2, turns edge values into barycentric weights
+  float invArea;
+
+  //unclipped bounding box corner, attribute planes are anchored here so interpolated values
+  //do not depend on how the triangle was clipped into tiles
+  int originX;
+  int originY;
+
+  int minX;
+  int minY;
+  int maxX;
+  int maxY;
+
+  //true if every edge value in the box (plus one SIMD block of overhang) fits in 32 bits
+  bool fits32;
+
+  //edge value at the centre of pixel (x, y)
+  int64_t Edge(int i, int x, int y)const
+  {
+    return a[i] * ((int64_t)x * SUBPIXEL_ONE + SUBPIXEL_HALF) +
+      b[i] * ((int64_t)y * SUBPIXEL_ONE + SUBPIXEL_HALF) + c[i];
+  }
+
+  //change of edge i when moving one pixel right / down
+  int64_t StepX(int i)const{ return a[i] * SUBPIXEL_ONE; }
+  int64_t StepY(int i)const{ return b[i] * SUBPIXEL_ONE; }
+
+  //exact [x0, x1] range of row y that is covered, solved per edge with integer division.
+  //Returns false if the row is empty.
+  bool RowSpan(int y, int& x0, int& x1)const
+  {
+    x0 = minX;
+    x1 = maxX;
+
+    for(int i = 0; i < 3; i++)
+    {
+      int64_t e = Edge(i, minX, y);
+      int64_t step = StepX(i);
+
+      if(step > 0)
+      {
+        if(e < 0)
+        {
+          int64_t k = (-e + step - 1) / step;
+          if(k > (int64_t)(maxX - minX)) return false;
+          if(minX + (int)k > x0) x0 = minX + (int)k;
+        }
+      }
+      else if(step < 0)
+      {
+        if(e < 0) return false;
+
+        int64_t k = e / -step;
+        if(k < (int64_t)(maxX - minX) && minX + (int)k < x1) x1 = minX + (int)k;
+      }
+      else if(e < 0)
+      {
+        return false;
+      }
+    }
+
+    return x0 <= x1;
+  }
+};
+
+//computes the edge equations of a triangle and its bounding box clamped to the inclusive
+//rectangle [clipX0, clipX1] x [clipY0, clipY1]. Returns false if nothing is left to draw. pad
+//widens the box by that many pixels before it is clipped, for samples off the pixel centres.
+inline bool SetupTriangle(float fx0, float fy0, float fx1, float fy1, float fx2, float fy2,
+  int clipX0, int clipY0, int clipX1, int clipY1, TriangleSetup& s, int pad = 0)
+{
+  int64_t x0 = ToFixed(fx0), y0 = ToFixed(fy0);
+  int64_t x1 = ToFixed(fx1), y1 = ToFixed(fy1);
+  int64_t x2 = ToFixed(fx2), y2 = ToFixed(fy2);
+
+  int64_t area = (x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0);
+  if(area == 0) return false;
+
+  s.a[0] = y1 - y2; s.b[0] = x2 - x1; s.c[0] = x1 * y2 - y1 * x2;
+  s.a[1] = y2 - y0; s.b[1] = x0 - x2; s.c[1] = x2 * y0 - y2 * x0;
+  s.a[2] = y0 - y1; s.b[2] = x1 - x0; s.c[2] = x0 * y1 - y0 * x1;
+
+  //flip clockwise triangles so that inside is always e >= 0
+  if(area < 0)
+  {
+    for(int i = 0; i < 3; i++)
+    {
+      s.a[i] = -s.a[i];
+      s.b[i] = -s.b[i];
+      s.c[i] = -s.c[i];
+    }
+    area = -area;
+  }
+
+  //top-left rule (y points down): the interior lies right of a left edge (a > 0) and below a
+  //top edge (a == 0, b > 0). Samples exactly on any other edge belong to the neighbour.
+  for(int i = 0; i < 3; i++)
+  {
+    bool topLeft = s.a[i] > 0 || (s.a[i] == 0 && s.b[i] > 0);
+    if(!topLeft) s.c[i] -= 1;
+  }
+
+  s.invArea = (float)(1.0 / (double)area);
+
+  //pixels whose centres can fall inside the fixed-point bounding box
+  int64_t bx0 = std::min(x0, std::min(x1, x2));
+  int64_t by0 = std::min(y0, std::min(y1, y2));
+  int64_t bx1 = std::max(x0, std::max(x1, x2));
+  int64_t by1 = std::max(y0, std::max(y1, y2));
+
+  s.originX = (int)-FloorDiv(-(bx0 - SUBPIXEL_HALF), SUBPIXEL_ONE);
+  s.originY = (int)-FloorDiv(-(by0 - SUBPIXEL_HALF), SUBPIXEL_ONE);
+
+  s.minX = s.originX - pad;
+  s.minY = s.originY - pad;
+  s.maxX = (int)FloorDiv(bx1 - SUBPIXEL_HALF, SUBPIXEL_ONE) + pad;
+  s.maxY = (int)FloorDiv(by1 - SUBPIXEL_HALF, SUBPIXEL_ONE) + pad;
+
+  if(s.minX < clipX0) s.minX = clipX0;
+  if(s.minY < clipY0) s.minY = clipY0;
+  if(s.maxX > clipX1) s.maxX = clipX1;
+  if(s.maxY > clipY1) s.maxY = clipY1;
+
+  if(s.minX > s.maxX || s.minY > s.maxY) return false;
+
+  //edge functions are linear, so their extremes over the box are at its corners
+  s.fits32 = true;
+  for(int i = 0; i < 3 && s.fits32; i++)
+  {
+    int64_t corners[4] = {
+      s.Edge(i, s.minX, s.minY), s.Edge(i, s.maxX + 8, s.minY),
+      s.Edge(i, s.minX, s.maxY), s.Edge(i, s.maxX + 8, s.maxY)
+    };
+
+    for(int64_t e : corners)
+    {
+      if(e > INT32_MAX || e < INT32_MIN) s.fits32 = false;
+    }
+  }
+
+  return true;
+}
+
+//sample positions of 4x and 8x multisampling, (x, y) offsets from the pixel centre in 1/16
+//pixel (the standard D3D patterns). SUBPIXEL_BITS is 4, so they lie on the fixed-point grid and
+//sample coverage is exactly as watertight as pixel coverage.
+inline const int8_t* SamplePattern(int samples)
+{
+  static const int8_t pattern4[8] = {-2, -6, 6, -2, -6, 2, 2, 6};
+  static const int8_t pattern8[16] = {1, -3, -1, 3, 5, 1, -3, -5, -5, 5, -7, -1, 3, 7, 7, -7};
+  return samples == 8 ? pattern8 : pattern4;
+}
+
+//per-sample coverage of a triangle. Each edge changes by a fixed offset from a pixel's centre
+//to its sample k, so a pixel's samples are all covered exactly when every edge at the centre
+//clears the smallest offset, and may be when it clears the largest: inner and outer are the
+//setup with those folded into c, whose RowSpans are the fully covered pixels of a row and a
+//superset of the partly covered ones. Only pixels between the two need testing per sample.
+struct SampleCoverage
+{
+  TriangleSetup inner;
+  TriangleSetup outer;
+  int64_t offset[3][MAX_SAMPLES];
+  int samples;
+
+  //bit k set for each covered sample of pixel (x, y) of the setup s this was made from
+  int Mask(const TriangleSetup& s, int x, int y)const
+  {
+    int64_t e[3] = {s.Edge(0, x, y), s.Edge(1, x, y), s.Edge(2, x, y)};
+
+    int mask = 0;
+    for(int k = 0; k < samples; k++)
+    {
+      mask |= (int)((e[0] + offset[0][k] >= 0) & (e[1] + offset[1][k] >= 0) & (e[2] + offset[2][k] >= 0)) << k;
+    }
+    return mask;
+  }
+};
+
+inline void SetupSamples(const TriangleSetup& s, int samples, SampleCoverage& c)
+{
+  const int8_t* pattern = SamplePattern(samples);
+
+  c.inner = s;
+  c.outer = s;
+  c.samples = samples;
+  for(int i = 0; i < 3; i++)
+  {
+    int64_t lo = INT64_MAX, hi = INT64_MIN;
+    for(int k = 0; k < samples; k++)
+    {
+      c.offset[i][k] = s.a[i] * pattern[2 * k] + s.b[i] * pattern[2 * k + 1];
+      lo = std::min(lo, c.offset[i][k]);
+      hi = std::max(hi, c.offset[i][k]);
+    }
+    c.inner.c[i] += lo;
+    c.outer.c[i] += hi;
+  }
+}
+
+//an attribute that varies linearly over the triangle, anchored at the setup's origin pixel:
+//v(x, y) = v0 + dx*(x - originX) + dy*(y - originY)
+struct AttributePlane
+{
+  float v0;
+  float dx;
+  float dy;
+
+  //value at the start (x = originX) of row y
+  float Row(const TriangleSetup& s, int y)const{ return v0 + dy * (float)(y - s.originY); }
+};
+
+//builds the screen-space plane of an attribute from its three vertex values
+inline AttributePlane SetupPlane(const TriangleSetup& s, float v0, float v1, float v2)
+{
+  double inv = (double)s.invArea;
+
+  AttributePlane p;
+  p.dx = (float)(((double)v0 * s.StepX(0) + (double)v1 * s.StepX(1) + (double)v2 * s.StepX(2)) * inv);
+  p.dy = (float)(((double)v0 * s.StepY(0) + (double)v1 * s.StepY(1) + (double)v2 * s.StepY(2)) * inv);
+  p.v0 = (float)(((double)v0 * s.Edge(0, s.originX, s.originY) +
+    (double)v1 * s.Edge(1, s.originX, s.originY) +
+    (double)v2 * s.Edge(2, s.originX, s.originY)) * inv);
+  return p;
+}
+
+//the varyings of one triangle. An attribute is not affine in screen space once the vertices
+//have different w, but a/w and 1/w are: both are set up as planes once per triangle and a
+//pixel's value is (a/w) / (1/w), one divide per pixel whatever the attribute count. When all
+//three vertices share one w (screen-space input) the attributes are planes themselves and
+//perspective is false.
+struct VaryingPlanes
+{
+  AttributePlane invW;
+  AttributePlane a[MAX_VARYINGS];
+  int count;
+  bool perspective;
+};
+
+//sets up count varyings given per vertex (vertex k's at v[k * count]) together with each
+//vertex's 1/w. Cost is linear in count; nothing is allocated.
+inline void SetupVaryings(const TriangleSetup& s, const float* invW, const float* v, int count, VaryingPlanes& p)
+{
+  p.count = count;
+  p.perspective = !(invW[0] == invW[1] && invW[1] == invW[2]);
+  p.invW = SetupPlane(s, invW[0], invW[1], invW[2]);
+
+  const float* v0 = v;
+  const float* v1 = v + count;
+  const float* v2 = v + 2 * count;
+
+  for(int i = 0; i < count; i++)
+  {
+    if(p.perspective) p.a[i] = SetupPlane(s, v0[i] * invW[0], v1[i] * invW[1], v2[i] * invW[2]);
+    else p.a[i] = SetupPlane(s, v0[i], v1[i], v2[i]);
+  }
+}
+
+//interpolated rgb for one row: r, g, b are the row's values at x = originX. With perspective
+//they are the planes of color/w, divided per pixel by the 1/w plane q + dq*t.
+struct SpanColor
+{
+  float r, g, b;
+  float dr, dg, db;
+  float q, dq;
+  bool perspective;
+  int originX;
+};
+
+//depth type of spans shaded without a depth attachment
+struct NoDepth{};
+
+//interpolated depth for one row (z is the value at x = originX) and the depth buffer row it is
+//tested against; with test false the depth is written without being compared
+template<typename D>
+struct SpanDepth
+{
+  D* row;
+  float z;
+  float dz;
+  bool test;
+};
+
+//walks one row of a triangle over [x0, x1] and leaves shading to visit. When Masked, e holds the
+//three 32-bit edge values at x0 and step their per-pixel increments, and only covered pixels
+//are passed on; otherwise the caller guarantees the whole span is covered. With a depth type D
+//pixels failing the depth test are dropped (and passing ones have their depth written) first.
+//visit(x, mask) is called per block of 8 (AVX2), 4 (SSE4.1) or 1 pixel starting at x, with
+//bit i of mask set for each pixel x + i to shade; it is a template parameter and inlined.
+template<bool Masked, typename D, typename F>
+inline void CoverSpan(int x0, int x1, const int32_t* e, const int32_t* step, int originX,
+  const SpanDepth<D>& depth, F&& visit)
+{
+  constexpr bool HasDepth = !std::is_same<D, NoDepth>::value;
+  int x = x0;
+
+#if defined(__AVX2__)
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i none = _mm256_set1_epi32(-1);
+
+  __m256i ve0 = none, ve1 = none, ve2 = none, se0 = none, se1 = none, se2 = none;
+  if(Masked)
+  {
+    ve0 = _mm256_add_epi32(_mm256_set1_epi32(e[0]), _mm256_mullo_epi32(_mm256_set1_epi32(step[0]), lane));
+    ve1 = _mm256_add_epi32(_mm256_set1_epi32(e[1]), _mm256_mullo_epi32(_mm256_set1_epi32(step[1]), lane));
+    ve2 = _mm256_add_epi32(_mm256_set1_epi32(e[2]), _mm256_mullo_epi32(_mm256_set1_epi32(step[2]), lane));
+    se0 = _mm256_slli_epi32(_mm256_set1_epi32(step[0]), 3);
+    se1 = _mm256_slli_epi32(_mm256_set1_epi32(step[1]), 3);
+    se2 = _mm256_slli_epi32(_mm256_set1_epi32(step[2]), 3);
+  }
+
+  for(; x <= x1; x += 8)
+  {
+    int mask = 0xFF;
+    if(Masked)
+    {
+      __m256i inside = _mm256_and_si256(_mm256_and_si256(
+        _mm256_cmpgt_epi32(ve0, none), _mm256_cmpgt_epi32(ve1, none)),
+        _mm256_cmpgt_epi32(ve2, none));
+      mask = _mm256_movemask_ps(_mm256_castsi256_ps(inside));
+
+      ve0 = _mm256_add_epi32(ve0, se0);
+      ve1 = _mm256_add_epi32(ve1, se1);
+      ve2 = _mm256_add_epi32(ve2, se2);
+    }
+    if(x1 - x < 7) mask &= (1 << (x1 - x + 1)) - 1;
+    if(!mask) continue;
+
+    if constexpr(HasDepth)
+    {
+      __m256 t = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x - originX), lane));
+      __m256 vz = _mm256_add_ps(_mm256_set1_ps(depth.z), _mm256_mul_ps(_mm256_set1_ps(depth.dz), t));
+      mask = DepthTraits<D>::TestBlock(depth.row + x, vz, mask, x1 - x >= 7, depth.test);
+      if(!mask) continue;
+    }
+
+    visit(x, mask);
+  }
+#elif defined(__SSE4_1__)
+  const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+  const __m128i none = _mm_set1_epi32(-1);
+
+  __m128i ve0 = none, ve1 = none, ve2 = none, se0 = none, se1 = none, se2 = none;
+  if(Masked)
+  {
+    ve0 = _mm_add_epi32(_mm_set1_epi32(e[0]), _mm_mullo_epi32(_mm_set1_epi32(step[0]), lane));
+    ve1 = _mm_add_epi32(_mm_set1_epi32(e[1]), _mm_mullo_epi32(_mm_set1_epi32(step[1]), lane));
+    ve2 = _mm_add_epi32(_mm_set1_epi32(e[2]), _mm_mullo_epi32(_mm_set1_epi32(step[2]), lane));
+    se0 = _mm_slli_epi32(_mm_set1_epi32(step[0]), 2);
+    se1 = _mm_slli_epi32(_mm_set1_epi32(step[1]), 2);
+    se2 = _mm_slli_epi32(_mm_set1_epi32(step[2]), 2);
+  }
+
+  for(; x <= x1; x += 4)
+  {
+    int mask = 0xF;
+    if(Masked)
+    {
+      __m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(ve0, none),
+        _mm_cmpgt_epi32(ve1, none)), _mm_cmpgt_epi32(ve2, none));
+      mask = _mm_movemask_ps(_mm_castsi128_ps(inside));
+
+      ve0 = _mm_add_epi32(ve0, se0);
+      ve1 = _mm_add_epi32(ve1, se1);
+      ve2 = _mm_add_epi32(ve2, se2);
+    }
+    if(x1 - x < 3) mask &= (1 << (x1 - x + 1)) - 1;
+    if(!mask) continue;
+
+    if constexpr(HasDepth)
+    {
+      for(int bits = mask; bits; bits &= bits - 1)
+      {
+        int i = __builtin_ctz(bits);
+        float z = depth.z + depth.dz * (float)(x + i - originX);
+        if(!DepthTraits<D>::Test(depth.row[x + i], z, depth.test)) mask &= ~(1 << i);
+      }
+      if(!mask) continue;
+    }
+
+    visit(x, mask);
+  }
+#else
+  int32_t e0 = 0, e1 = 0, e2 = 0;
+  if(Masked)
+  {
+    e0 = e[0];
+    e1 = e[1];
+    e2 = e[2];
+  }
+
+  for(; x <= x1; x++)
+  {
+    bool inside = !Masked || (e0 >= 0 && e1 >= 0 && e2 >= 0);
+
+    if(Masked)
+    {
+      e0 += step[0];
+      e1 += step[1];
+      e2 += step[2];
+    }
+
+    if(!inside) continue;
+
+    if constexpr(HasDepth)
+    {
+      if(!DepthTraits<D>::Test(depth.row[x], depth.z + depth.dz * (float)(x - originX), depth.test)) continue;
+    }
+
+    visit(x, 1);
+  }
+#endif
+}
+
+//running totals of quad shading: the quads a fragment program ran on and the pixels it wrote.
+//The other 4 * quads - pixels lanes were helpers, evaluated only for the derivatives.
+struct QuadStats
+{
+  uint64_t quads;
+  uint64_t pixels;
+
+  //share of the shaded lanes that wrote a pixel
+  double Utilization()const{ return quads ? (double)pixels / (4.0 * (double)quads) : 0.0; }
+};
+
+//the lanes of a block from lane a to lane b (clamped to the block, none when a > b) as bits
+inline int LaneRange(int a, int b)
+{
+  a = std::max(a, 0);
+  b = std::min(b, QUAD_BLOCK - 1);
+  return a <= b ? (2 << b) - (1 << a) : 0;
+}
+
+//walks the quads of a row pair (an even row and the one below it). Quads sit on even pixel
+//coordinates, so a quad is the same whichever tile or box it is shaded in. Row r's covered range
+//is [x0[r], x1[r]] (empty when x0[r] > x1[r]) and depth[r] its depth row; pixels failing the
+//depth test are dropped (and passing ones have their depth written) first. visit(x, mask) is
+//called per block of QUAD_BLOCK x 2 pixels from column x with anything left to shade, bit i of
+//mask set for each pixel in column x + i % QUAD_BLOCK of row i / QUAD_BLOCK to shade.
+template<typename D, typename F>
+inline void CoverQuads(const int* x0, const int* x1, int originX, const SpanDepth<D>* depth, F&& visit)
+{
+  constexpr bool HasDepth = !std::is_same<D, NoDepth>::value;
+
+  int lo = INT32_MAX, hi = INT32_MIN;
+  for(int r = 0; r < 2; r++)
+  {
+    if(x0[r] > x1[r]) continue;
+    lo = std::min(lo, x0[r]);
+    hi = std::max(hi, x1[r]);
+  }
+
+  for(int x = lo & ~(QUAD_BLOCK - 1); x <= hi; x += QUAD_BLOCK)
+  {
+    int mask = 0;
+    for(int r = 0; r < 2; r++)
+    {
+      mask |= LaneRange(x0[r] - x, x1[r] - x) << (r * QUAD_BLOCK);
+    }
+    if(!mask) continue;
+
+    if constexpr(HasDepth)
+    {
+      for(int bits = mask; bits; bits &= bits - 1)
+      {
+        int i = __builtin_ctz(bits);
+        const SpanDepth<D>& d = depth[i / QUAD_BLOCK];
+        int px = x + i % QUAD_BLOCK;
+        if(!DepthTraits<D>::Test(d.row[px], d.z + d.dz * (float)(px - originX), d.test)) mask &= ~(1 << i);
+      }
+      if(!mask) continue;
+    }
+
+    visit(x, mask);
+  }
+}
+
+//shades one row of a triangle with interpolated rgb over [x0, x1] (coverage and depth as in
+//CoverSpan). Each pixel's color is evaluated from its absolute x (a multiply-add from the row's
+//start, as cheap as a running sum and without its drift), so results do not depend on where a
+//span starts. Channels are clamped to [0, 255] here and converted by the pixel format's traits.
+template<bool Masked, typename P, typename D = NoDepth>
+inline void ShadeSpan(P* row, int x0, int x1, const int32_t* e, const int32_t* step,
+  const SpanColor& col, const SpanDepth<D>& depth = SpanDepth<D>{})
+{
+#if defined(__AVX2__)
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 max = _mm256_set1_ps(255.0f);
+  const __m256 r = _mm256_set1_ps(col.r);
+  const __m256 g = _mm256_set1_ps(col.g);
+  const __m256 b = _mm256_set1_ps(col.b);
+  const __m256 dr = _mm256_set1_ps(col.dr);
+  const __m256 dg = _mm256_set1_ps(col.dg);
+  const __m256 db = _mm256_set1_ps(col.db);
+  const __m256 q = _mm256_set1_ps(col.q);
+  const __m256 dq = _mm256_set1_ps(col.dq);
+  const __m256 one = _mm256_set1_ps(1.0f);
+
+  CoverSpan<Masked>(x0, x1, e, step, col.originX, depth, [&](int x, int mask)
+  {
+    __m256 t = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x - col.originX), lane));
+    __m256 vr = _mm256_add_ps(r, _mm256_mul_ps(dr, t));
+    __m256 vg = _mm256_add_ps(g, _mm256_mul_ps(dg, t));
+    __m256 vb = _mm256_add_ps(b, _mm256_mul_ps(db, t));
+    if(col.perspective)
+    {
+      __m256 w = _mm256_div_ps(one, _mm256_add_ps(q, _mm256_mul_ps(dq, t)));
+      vr = _mm256_mul_ps(vr, w);
+      vg = _mm256_mul_ps(vg, w);
+      vb = _mm256_mul_ps(vb, w);
+    }
+    vr = _mm256_min_ps(_mm256_max_ps(vr, zero), max);
+    vg = _mm256_min_ps(_mm256_max_ps(vg, zero), max);
+    vb = _mm256_min_ps(_mm256_max_ps(vb, zero), max);
+
+    P* dst = row + x;
+    if(mask == 0xFF)
+    {
+      PixelTraits<P>::StoreBlock(dst, vr, vg, vb);
+      return;
+    }
+
+    alignas(32) float lr[8], lg[8], lb[8];
+    _mm256_store_ps(lr, vr);
+    _mm256_store_ps(lg, vg);
+    _mm256_store_ps(lb, vb);
+
+    while(mask)
+    {
+      int i = __builtin_ctz(mask);
+      mask &= mask - 1;
+
+      PixelTraits<P>::Shade(dst[i], lr[i], lg[i], lb[i]);
+    }
+  });
+#elif defined(__SSE4_1__)
+  const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 max = _mm_set1_ps(255.0f);
+  const __m128 r = _mm_set1_ps(col.r);
+  const __m128 g = _mm_set1_ps(col.g);
+  const __m128 b = _mm_set1_ps(col.b);
+  const __m128 dr = _mm_set1_ps(col.dr);
+  const __m128 dg = _mm_set1_ps(col.dg);
+  const __m128 db = _mm_set1_ps(col.db);
+  const __m128 q = _mm_set1_ps(col.q);
+  const __m128 dq = _mm_set1_ps(col.dq);
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  CoverSpan<Masked>(x0, x1, e, step, col.originX, depth, [&](int x, int mask)
+  {
+    __m128 t = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x - col.originX), lane));
+    __m128 vr = _mm_add_ps(r, _mm_mul_ps(dr, t));
+    __m128 vg = _mm_add_ps(g, _mm_mul_ps(dg, t));
+    __m128 vb = _mm_add_ps(b, _mm_mul_ps(db, t));
+    if(col.perspective)
+    {
+      __m128 w = _mm_div_ps(one, _mm_add_ps(q, _mm_mul_ps(dq, t)));
+      vr = _mm_mul_ps(vr, w);
+      vg = _mm_mul_ps(vg, w);
+      vb = _mm_mul_ps(vb, w);
+    }
+
+    alignas(16) float lr[4], lg[4], lb[4];
+    _mm_store_ps(lr, _mm_min_ps(_mm_max_ps(vr, zero), max));
+    _mm_store_ps(lg, _mm_min_ps(_mm_max_ps(vg, zero), max));
+    _mm_store_ps(lb, _mm_min_ps(_mm_max_ps(vb, zero), max));
+
+    P* dst = row + x;
+    while(mask)
+    {
+      int i = __builtin_ctz(mask);
+      mask &= mask - 1;
+
+      PixelTraits<P>::Shade(dst[i], lr[i], lg[i], lb[i]);
+    }
+  });
+#else
+  auto clamp = [](float v){ return v > 0.0f ? (v < 255.0f ? v : 255.0f) : 0.0f; };
+
+  CoverSpan<Masked>(x0, x1, e, step, col.originX, depth, [&](int x, int)
+  {
+    float t = (float)(x - col.originX);
+    float w = col.perspective ? 1.0f / (col.q + col.dq * t) : 1.0f;
+    PixelTraits<P>::Shade(row[x], clamp((col.r + col.dr * t) * w), clamp((col.g + col.dg * t) * w),
+      clamp((col.b + col.db * t) * w));
+  });
+#endif
+}
+
+//an integer line clipped to the framebuffer, expressed as a walk over pixel indices so the
+//inner loop needs no bounds checks
+struct LineSetup
+{
+  int start;       //index (y * width + x) of the first visible pixel
+  int count;       //number of visible pixels
+  int majorStep;   //index change per step along the major axis
+  int minorStep;   //index change when the minor axis advances
+  int64_t err;     //bresenham error term at start
+  int64_t errStep; //2 * minor delta
+  int64_t errMax;  //2 * major delta
+};
+
+//range of steps i >= 0 for which q0 + sign * floor((errStep*i + errMax/2) / errMax) stays
+//within [qMin, qMax]; narrows [lo, hi] in place
+inline void ClipMinorAxis(int64_t q0, int sign, int qMin, int qMax, int64_t errStep, int64_t errMax,
+  int64_t& lo, int64_t& hi)
+{
+  //bounds on the minor offset k = floor((errStep*i + errMax/2) / errMax)
+  int64_t kMin = sign > 0 ? qMin - q0 : q0 - qMax;
+  int64_t kMax = sign > 0 ? qMax - q0 : q0 - qMin;
+
+  if(errStep == 0)
+  {
+    if(kMin > 0 || kMax < 0) hi = lo - 1;
+    return;
+  }
+
+  //k >= kMin  <=>  errStep*i >= errMax*kMin - errMax/2
+  int64_t iMin = -FloorDiv(-(errMax * kMin - errMax / 2), errStep);
+  //k <= kMax  <=>  errStep*i < errMax*(kMax + 1) - errMax/2
+  int64_t iMax = FloorDiv(errMax * (kMax + 1) - errMax / 2 - 1, errStep);
+
+  if(iMin > lo) lo = iMin;
+  if(iMax < hi) hi = iMax;
+}
+
+//sets up a bresenham walk from pixel (floor(x0), floor(y0)) to (floor(x1), floor(y1)), both
+//ends included, clipped Liang-Barsky style to the inclusive rectangle [clipX0, clipX1] x
+//[clipY0, clipY1] of a framebuffer that is width pixels wide: the visible range of steps is
+//solved up front so only pixels inside the rectangle are visited, and they are exactly the pixels
+//the unclipped line would have drawn there. Returns false if the line misses the rectangle.
+inline bool SetupLine(float fx0, float fy0, float fx1, float fy1, int clipX0, int clipY0,
+  int clipX1, int clipY1, int width, LineSetup& l)
+{
+  if(clipX0 > clipX1 || clipY0 > clipY1) return false;
+
+  int64_t x0 = ToPixel(fx0);
+  int64_t y0 = ToPixel(fy0);
+  int64_t x1 = ToPixel(fx1);
+  int64_t y1 = ToPixel(fy1);
+
+  int64_t dx = x1 - x0;
+  int64_t dy = y1 - y0;
+  int sx = dx < 0 ? -1 : 1;
+  int sy = dy < 0 ? -1 : 1;
+  dx = dx < 0 ? -dx : dx;
+  dy = dy < 0 ? -dy : dy;
+
+  bool xMajor = dx >= dy;
+
+  int64_t m0 = xMajor ? x0 : y0;
+  int64_t n0 = xMajor ? y0 : x0;
+  int sm = xMajor ? sx : sy;
+  int sn = xMajor ? sy : sx;
+  int majorMin = xMajor ? clipX0 : clipY0;
+  int majorMax = xMajor ? clipX1 : clipY1;
+  int minorMin = xMajor ? clipY0 : clipX0;
+  int minorMax = xMajor ? clipY1 : clipX1;
+  int64_t majorD = xMajor ? dx : dy;
+  int64_t minorD = xMajor ? dy : dx;
+
+  l.errStep = 2 * minorD;
+  l.errMax = 2 * majorD;
+  if(l.errMax == 0) l.errMax = 2;
+
+  //steps along the major axis that stay on screen
+  int64_t lo = 0;
+  int64_t hi = majorD;
+  int64_t mLo = sm > 0 ? majorMin - m0 : m0 - majorMax;
+  int64_t mHi = sm > 0 ? majorMax - m0 : m0 - majorMin;
+  if(mLo > lo) lo = mLo;
+  if(mHi < hi) hi = mHi;
+
+  //...and whose minor coordinate stays on screen. Lines with both ends inside need no clipping.
+  bool inside = x0 >= clipX0 && x0 <= clipX1 && y0 >= clipY0 && y0 <= clipY1 &&
+    x1 >= clipX0 && x1 <= clipX1 && y1 >= clipY0 && y1 <= clipY1;
+  if(!inside) ClipMinorAxis(n0, sn, minorMin, minorMax, l.errStep, l.errMax, lo, hi);
+  if(lo > hi) return false;
+
+  //state of the walk after lo steps
+  int64_t k = 0;
+  l.err = l.errMax / 2;
+  if(lo > 0)
+  {
+    int64_t num = l.errStep * lo + l.errMax / 2;
+    k = num / l.errMax;
+    l.err = num % l.errMax;
+  }
+
+  int64_t m = m0 + sm * lo;
+  int64_t n = n0 + sn * k;
+  int64_t x = xMajor ? m : n;
+  int64_t y = xMajor ? n : m;
+
+  l.start = (int)(y * width + x);
+  l.count = (int)(hi - lo + 1);
+  l.majorStep = xMajor ? sx : sy * width;
+  l.minorStep = xMajor ? sy * width : sx;
+
+  return true;
+}
+
+#endif
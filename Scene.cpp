@@ -0,0 +1,299 @@
+#include "./Scene.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Aabb Aabb::Empty()
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  return Aabb{{inf, inf, inf}, {-inf, -inf, -inf}};
+}
+
+Aabb Aabb::FromMinMax(const Vec3& lo, const Vec3& hi)
+{
+  return Aabb{{lo.X(), lo.Y(), lo.Z()}, {hi.X(), hi.Y(), hi.Z()}};
+}
+
+void Aabb::Grow(const Aabb& other)
+{
+  for(int a = 0; a < 3; a++)
+  {
+    lo[a] = std::min(lo[a], other.lo[a]);
+    hi[a] = std::max(hi[a], other.hi[a]);
+  }
+}
+
+void Aabb::Grow(float x, float y, float z)
+{
+  lo[0] = std::min(lo[0], x);
+  lo[1] = std::min(lo[1], y);
+  lo[2] = std::min(lo[2], z);
+  hi[0] = std::max(hi[0], x);
+  hi[1] = std::max(hi[1], y);
+  hi[2] = std::max(hi[2], z);
+}
+
+//Arvo's method: each output axis is the translation plus, per input axis, the smaller and the
+//larger of the two scaled extremes
+Aabb Aabb::Transformed(const Mat4& m)const
+{
+  if(IsEmpty()) return *this;
+
+  Aabb out;
+  for(int r = 0; r < 3; r++)
+  {
+    out.lo[r] = out.hi[r] = m.m_Mat[r][3];
+    for(int c = 0; c < 3; c++)
+    {
+      float a = m.m_Mat[r][c] * lo[c];
+      float b = m.m_Mat[r][c] * hi[c];
+      out.lo[r] += std::min(a, b);
+      out.hi[r] += std::max(a, b);
+    }
+  }
+  return out;
+}
+
+ViewFrustum::ViewFrustum(const Mat4& viewProj)
+{
+  //a point is inside when -w <= x, y, z <= w, i.e. row3 +- row0..2 >= 0
+  for(int k = 0; k < 6; k++)
+  {
+    int axis = k / 2;
+    float sign = (k % 2 == 0) ? 1.0f : -1.0f;
+    for(int c = 0; c < 4; c++)
+    {
+      m_Planes[k][c] = viewProj.m_Mat[3][c] + sign * viewProj.m_Mat[axis][c];
+    }
+
+    float len = std::sqrt(m_Planes[k][0] * m_Planes[k][0] + m_Planes[k][1] * m_Planes[k][1] +
+      m_Planes[k][2] * m_Planes[k][2]);
+    if(len > 0.0f)
+    {
+      for(int c = 0; c < 4; c++) m_Planes[k][c] /= len;
+    }
+  }
+}
+
+bool ViewFrustum::Test(const Aabb& box, uint32_t& mask)const
+{
+  if(box.IsEmpty()) return false;
+
+  float cx = (box.lo[0] + box.hi[0]) * 0.5f, ex = (box.hi[0] - box.lo[0]) * 0.5f;
+  float cy = (box.lo[1] + box.hi[1]) * 0.5f, ey = (box.hi[1] - box.lo[1]) * 0.5f;
+  float cz = (box.lo[2] + box.hi[2]) * 0.5f, ez = (box.hi[2] - box.lo[2]) * 0.5f;
+
+  for(int k = 0; k < 6; k++)
+  {
+    uint32_t bit = 1u << k;
+    if(!(mask & bit)) continue;
+
+    const float* p = m_Planes[k];
+    float d = p[0] * cx + p[1] * cy + p[2] * cz + p[3];
+    float r = std::fabs(p[0]) * ex + std::fabs(p[1]) * ey + std::fabs(p[2]) * ez;
+
+    if(d + r < 0.0f) return false;
+    if(d - r >= 0.0f) mask &= ~bit;
+  }
+  return true;
+}
+
+int Scene::Add(const VertexBuffer& vertices, const int* indices, size_t indexCount, const Mat4& model,
+  const Color& color)
+{
+  int count = vertices.Size();
+  const float* x = vertices.X();
+  const float* y = vertices.Y();
+  const float* z = vertices.Z();
+
+  Aabb local = Aabb::Empty();
+  for(size_t k = 0; k < indexCount; k++)
+  {
+    int i = indices[k];
+    if(i < 0 || i >= count) throw Invalid{};
+    local.Grow(x[i], y[i], z[i]);
+  }
+
+  m_Objects.push_back(Object{&vertices, indices, indexCount, model, color, local, local.Transformed(model)});
+  m_bBuilt = false;
+  return (int)m_Objects.size() - 1;
+}
+
+int Scene::Add(const VertexBuffer& vertices, const std::vector<int>& indices, const Mat4& model, CP color)
+{
+  Color c;
+  c.SetColor(color);
+  return Add(vertices, indices.data(), indices.size(), model, c);
+}
+
+int Scene::Add(const Mesh& mesh, const Mat4& model, CP color)
+{
+  Color c;
+  c.SetColor(color);
+
+  //the mesh knows its bounds, so a mapped mesh is not read here
+  Aabb local = mesh.VertexCount() > 0 ? Aabb::FromMinMax(mesh.BoundsMin(), mesh.BoundsMax()) : Aabb::Empty();
+  m_Objects.push_back(Object{&mesh.Positions(), mesh.Indices(), mesh.IndexCount(), model, c, local,
+    local.Transformed(model)});
+  m_bBuilt = false;
+  return (int)m_Objects.size() - 1;
+}
+
+void Scene::SetTransform(int id, const Mat4& model)
+{
+  if(id < 0 || id >= (int)m_Objects.size()) throw Invalid{};
+
+  Object& o = m_Objects[id];
+  o.model = model;
+  o.world = o.local.Transformed(model);
+  m_bRefit = true;
+}
+
+const Mat4& Scene::GetTransform(int id)const
+{
+  if(id < 0 || id >= (int)m_Objects.size()) throw Invalid{};
+  return m_Objects[id].model;
+}
+
+const Aabb& Scene::Bounds(int id)const
+{
+  if(id < 0 || id >= (int)m_Objects.size()) throw Invalid{};
+  return m_Objects[id].world;
+}
+
+Aabb Scene::Bounds()const
+{
+  Aabb box = Aabb::Empty();
+  for(const Object& o : m_Objects) box.Grow(o.world);
+  return box;
+}
+
+void Scene::Build()
+{
+  m_Order.resize(m_Objects.size());
+  for(size_t i = 0; i < m_Order.size(); i++) m_Order[i] = (int)i;
+
+  m_Nodes.clear();
+  m_Nodes.reserve(m_Objects.size() / LEAF_SIZE * 2 + 1);
+  if(!m_Objects.empty()) Build(0, (int)m_Objects.size());
+
+  m_bBuilt = true;
+  m_bRefit = false;
+}
+
+//median split on the longest axis of the centroids; returns the node index
+int Scene::Build(int first, int count)
+{
+  int node = (int)m_Nodes.size();
+  m_Nodes.push_back(Node{Aabb::Empty(), first, count, -1});
+
+  //empty objects sit at the origin for the split
+  Aabb bounds = Aabb::Empty();
+  Aabb centers = Aabb::Empty();
+  auto center = [&](int id, int a)
+  {
+    const Aabb& w = m_Objects[id].world;
+    return w.IsEmpty() ? 0.0f : (w.lo[a] + w.hi[a]) * 0.5f;
+  };
+
+  for(int k = first; k < first + count; k++)
+  {
+    int id = m_Order[k];
+    bounds.Grow(m_Objects[id].world);
+    centers.Grow(center(id, 0), center(id, 1), center(id, 2));
+  }
+  m_Nodes[node].bounds = bounds;
+
+  if(count <= LEAF_SIZE) return node;
+
+  int axis = 0;
+  for(int a = 1; a < 3; a++)
+  {
+    if(centers.hi[a] - centers.lo[a] > centers.hi[axis] - centers.lo[axis]) axis = a;
+  }
+
+  int half = count / 2;
+  std::nth_element(m_Order.begin() + first, m_Order.begin() + first + half, m_Order.begin() + first + count,
+    [&](int a, int b){ return center(a, axis) < center(b, axis); });
+
+  Build(first, half);
+  int right = Build(first + half, count - half);
+  m_Nodes[node].right = right;
+  return node;
+}
+
+//children follow their parent, so walking backwards sees them first
+void Scene::Refit()
+{
+  for(int n = (int)m_Nodes.size() - 1; n >= 0; n--)
+  {
+    Node& node = m_Nodes[n];
+    node.bounds = Aabb::Empty();
+    if(node.right < 0)
+    {
+      for(int k = node.first; k < node.first + node.count; k++)
+      {
+        node.bounds.Grow(m_Objects[m_Order[k]].world);
+      }
+    }
+    else
+    {
+      node.bounds.Grow(m_Nodes[n + 1].bounds);
+      node.bounds.Grow(m_Nodes[node.right].bounds);
+    }
+  }
+
+  m_bRefit = false;
+}
+
+const std::vector<int>& Scene::Cull(const Mat4& viewProj)
+{
+  if(!m_bBuilt) Build();
+  else if(m_bRefit) Refit();
+
+  m_Visible.clear();
+  if(m_Nodes.empty()) return m_Visible;
+
+  ViewFrustum frustum(viewProj);
+
+  m_Stack.clear();
+  m_Stack.push_back({0, ViewFrustum::ALL_PLANES});
+
+  while(!m_Stack.empty())
+  {
+    int n = m_Stack.back().first;
+    uint32_t mask = m_Stack.back().second;
+    m_Stack.pop_back();
+
+    const Node& node = m_Nodes[n];
+    m_Stats.nodesVisited++;
+
+    if(mask && !frustum.Test(node.bounds, mask)) continue;
+
+    //entirely in view: the whole subtree is visible
+    if(mask == 0)
+    {
+      m_Visible.insert(m_Visible.end(), m_Order.begin() + node.first, m_Order.begin() + node.first + node.count);
+      continue;
+    }
+
+    if(node.right < 0)
+    {
+      for(int k = node.first; k < node.first + node.count; k++)
+      {
+        int id = m_Order[k];
+        uint32_t objectMask = mask;
+        m_Stats.objectsTested++;
+        if(frustum.Test(m_Objects[id].world, objectMask)) m_Visible.push_back(id);
+      }
+      continue;
+    }
+
+    m_Stack.push_back({node.right, mask});
+    m_Stack.push_back({n + 1, mask});
+  }
+
+  std::sort(m_Visible.begin(), m_Visible.end());
+  m_Stats.objectsVisible += m_Visible.size();
+  return m_Visible;
+}
@@ -0,0 +1,165 @@
+#ifndef TINYRASTER_SCENE_H
+#define TINYRASTER_SCENE_H
+//--------------------------------------------------------------------
+//
+//  Name: Scene.h
+//
+//  Desc: Object layer over indexed drawing. Every object is a vertex
+//  buffer and index list placed by its own model matrix, with a
+//  world-space bounding box; the boxes are kept in a bounding volume
+//  hierarchy so whole groups outside the view frustum are dropped
+//  before any of their vertices is transformed. Boxes fully inside
+//  the frustum pass their subtree on without further tests, and
+//  planes a box is inside of are not tested again below it.
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "./Color.h"
+#include "./Framebuffer.h"
+#include "./Math.h"
+#include "./Mesh.h"
+#include "./VertexBuffer.h"
+
+//axis-aligned bounding box; an empty box has lo > hi
+struct Aabb
+{
+  float lo[3];
+  float hi[3];
+
+  static Aabb Empty();
+  static Aabb FromMinMax(const Vec3& lo, const Vec3& hi);
+
+  bool IsEmpty()const{return lo[0] > hi[0];}
+
+  void Grow(const Aabb& other);
+  void Grow(float x, float y, float z);
+
+  //the box around this one after m (an affine transform)
+  Aabb Transformed(const Mat4& m)const;
+};
+
+//the six planes of a view-projection matrix (OpenGL clip conventions), pointing inwards
+class ViewFrustum
+{
+
+public:
+
+  //every plane; a test clears the bits of planes the box is entirely inside of
+  static constexpr uint32_t ALL_PLANES = 63;
+
+  explicit ViewFrustum(const Mat4& viewProj);
+
+  //false if box is entirely outside one of the planes in mask. Otherwise the planes it lies
+  //entirely inside of are cleared from mask: 0 means the box is fully in view.
+  bool Test(const Aabb& box, uint32_t& mask)const;
+
+private:
+
+  //a b c d, normalized so a*x + b*y + c*z + d is the signed distance
+  float m_Planes[6][4];
+
+};
+
+//counters of the culling pass, running until reset
+struct CullStats
+{
+  uint64_t nodesVisited;    //bvh nodes whose box was tested or accepted
+  uint64_t objectsTested;   //object boxes tested on their own
+  uint64_t objectsVisible;  //objects handed to the draw calls
+};
+
+class Scene
+{
+
+public:
+
+  class Invalid{};
+
+  Scene() : m_bBuilt(false), m_bRefit(false), m_Stats{} {}
+
+  //adds an object and returns its id. The scene keeps references: vertices, indices and mesh
+  //must outlive it. Positions are taken as points (w = 1). Throws Invalid for an index outside
+  //vertices.
+  int Add(const VertexBuffer& vertices, const int* indices, size_t indexCount, const Mat4& model, const Color& color);
+  int Add(const VertexBuffer& vertices, const std::vector<int>& indices, const Mat4& model, CP color);
+  int Add(const Mesh& mesh, const Mat4& model, CP color);
+
+  int Size()const{return (int)m_Objects.size();}
+
+  //moves an object; the hierarchy is refit before the next cull. Call Build after large
+  //rearrangements, as a refit tree only grows its boxes.
+  void SetTransform(int id, const Mat4& model);
+  const Mat4& GetTransform(int id)const;
+
+  //world-space bounds of one object and of the whole scene
+  const Aabb& Bounds(int id)const;
+  Aabb Bounds()const;
+
+  //rebuilds the hierarchy over the current boxes (done by Cull when objects were added)
+  void Build();
+
+  //ids of the objects whose boxes intersect the frustum of viewProj, in ascending order
+  const std::vector<int>& Cull(const Mat4& viewProj);
+
+  //draws every object that survives Cull with viewProj * model, in the order they were added
+  template<typename FB>
+  void Draw(FB& fb, const Mat4& viewProj, DrawMode mode = DrawMode::WIREFRAME)
+  {
+    for(int id : Cull(viewProj))
+    {
+      const Object& o = m_Objects[id];
+      fb.DrawIndexed(viewProj * o.model, *o.vertices, o.indices, o.indexCount, o.color.r, o.color.g, o.color.b, mode);
+    }
+  }
+
+  const CullStats& Stats()const{return m_Stats;}
+  void ResetStats(){m_Stats = CullStats{};}
+
+private:
+
+  //objects at or below this count per leaf
+  static constexpr int LEAF_SIZE = 4;
+
+  struct Object
+  {
+    const VertexBuffer* vertices;
+    const int* indices;
+    size_t indexCount;
+    Mat4 model;
+    Color color;
+    Aabb local;
+    Aabb world;
+  };
+
+  //nodes are stored depth first: an inner node's left child follows it, right is the index of
+  //the other. Either way the node covers m_Order[first, first + count).
+  struct Node
+  {
+    Aabb bounds;
+    int first;
+    int count;
+    int right;
+  };
+
+  int Build(int first, int count);
+  void Refit();
+
+  std::vector<Object> m_Objects;
+  std::vector<Node> m_Nodes;
+  std::vector<int> m_Order;
+  bool m_bBuilt;
+  bool m_bRefit;
+
+  //cull scratch and output
+  std::vector<std::pair<int, uint32_t>> m_Stack;
+  std::vector<int> m_Visible;
+  CullStats m_Stats;
+
+};
+
+#endif
@@ -0,0 +1,240 @@
+#include "./Texture.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+Texture::Texture(const RGBA8* texels, int width, int height) : m_iWidth(width), m_iHeight(height)
+{
+  if(width <= 0 || height <= 0 || !texels) throw Invalid{};
+
+  Build(std::vector<RGBA8>(texels, texels + (size_t)width * height));
+}
+
+Texture::Texture(const Color* texels, int width, int height) : m_iWidth(width), m_iHeight(height)
+{
+  if(width <= 0 || height <= 0 || !texels) throw Invalid{};
+
+  std::vector<RGBA8> rgba((size_t)width * height);
+  for(size_t i = 0; i < rgba.size(); i++)
+  {
+    rgba[i] = RGBA8{texels[i].r, texels[i].g, texels[i].b, 255};
+  }
+  Build(rgba);
+}
+
+//lays out every level in tiles and fills them, each level a 2x2 box filter of the one above
+//(texels past an odd edge repeat the last row or column)
+void Texture::Build(const std::vector<RGBA8>& level0)
+{
+  uint32_t offset = 0;
+  for(int w = m_iWidth, h = m_iHeight; ; w = std::max(1, w / 2), h = std::max(1, h / 2))
+  {
+    Level l{w, h, (w + TEXTURE_TILE - 1) / TEXTURE_TILE, offset};
+    m_Levels.push_back(l);
+    offset += (uint32_t)(l.tilesX * ((h + TEXTURE_TILE - 1) / TEXTURE_TILE) * TEXTURE_TILE * TEXTURE_TILE);
+
+    if(w == 1 && h == 1) break;
+  }
+  m_Texels.assign(offset, RGBA8{0, 0, 0, 0});
+
+  std::vector<RGBA8> level = level0;
+  std::vector<RGBA8> next;
+  for(size_t i = 0; i < m_Levels.size(); i++)
+  {
+    const Level& l = m_Levels[i];
+    for(int y = 0; y < l.height; y++)
+    {
+      for(int x = 0; x < l.width; x++)
+      {
+        m_Texels[l.offset + Address(l, x, y)] = level[(size_t)y * l.width + x];
+      }
+    }
+
+    if(i + 1 == m_Levels.size()) break;
+
+    const Level& n = m_Levels[i + 1];
+    next.resize((size_t)n.width * n.height);
+    for(int y = 0; y < n.height; y++)
+    {
+      int y0 = std::min(2 * y, l.height - 1), y1 = std::min(2 * y + 1, l.height - 1);
+      for(int x = 0; x < n.width; x++)
+      {
+        int x0 = std::min(2 * x, l.width - 1), x1 = std::min(2 * x + 1, l.width - 1);
+        const RGBA8& a = level[(size_t)y0 * l.width + x0];
+        const RGBA8& b = level[(size_t)y0 * l.width + x1];
+        const RGBA8& c = level[(size_t)y1 * l.width + x0];
+        const RGBA8& d = level[(size_t)y1 * l.width + x1];
+
+        next[(size_t)y * n.width + x] = RGBA8{
+          (uint8_t)((a.r + b.r + c.r + d.r + 2) / 4),
+          (uint8_t)((a.g + b.g + c.g + d.g + 2) / 4),
+          (uint8_t)((a.b + b.b + c.b + d.b + 2) / 4),
+          (uint8_t)((a.a + b.a + c.a + d.a + 2) / 4)
+        };
+      }
+    }
+    level.swap(next);
+  }
+}
+
+#if defined(__AVX2__)
+namespace
+{
+  //per-level sizes gathered by the lanes, indexed by level
+  struct LevelTables
+  {
+    alignas(32) int width[32];
+    alignas(32) int height[32];
+    alignas(32) int tilesX[32];
+    alignas(32) int offset[32];
+  };
+
+  struct Block
+  {
+    __m256 r, g, b, a;
+  };
+
+  //integer texel coordinate c (as float) wrapped onto an axis of n texels
+  inline __m256 WrapBlock(__m256 c, __m256 n, Wrap wrap)
+  {
+    const __m256 zero = _mm256_setzero_ps();
+    if(wrap == Wrap::CLAMP) return _mm256_min_ps(_mm256_max_ps(c, zero), _mm256_sub_ps(n, _mm256_set1_ps(1.0f)));
+
+    //the quotient can round across an integer, so the remainder is corrected into [0, n)
+    __m256 m = _mm256_sub_ps(c, _mm256_mul_ps(n, _mm256_floor_ps(_mm256_div_ps(c, n))));
+    m = _mm256_add_ps(m, _mm256_and_ps(_mm256_cmp_ps(m, zero, _CMP_LT_OQ), n));
+    m = _mm256_sub_ps(m, _mm256_and_ps(_mm256_cmp_ps(m, n, _CMP_GE_OQ), n));
+    return m;
+  }
+
+  inline Block Fetch(const int* texels, __m256i offset, __m256i tilesX, __m256i x, __m256i y)
+  {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i byte = _mm256_set1_epi32(255);
+
+    __m256i tile = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, 2), tilesX), _mm256_srli_epi32(x, 2));
+    __m256i morton = _mm256_or_si256(
+      _mm256_or_si256(_mm256_and_si256(x, one), _mm256_slli_epi32(_mm256_and_si256(y, one), 1)),
+      _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(x, two), 1), _mm256_slli_epi32(_mm256_and_si256(y, two), 2)));
+    __m256i index = _mm256_add_epi32(offset, _mm256_add_epi32(_mm256_slli_epi32(tile, 4), morton));
+
+    __m256i t = _mm256_i32gather_epi32(texels, index, 4);
+    return Block{
+      _mm256_cvtepi32_ps(_mm256_and_si256(t, byte)),
+      _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t, 8), byte)),
+      _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t, 16), byte)),
+      _mm256_cvtepi32_ps(_mm256_srli_epi32(t, 24))
+    };
+  }
+
+  inline __m256 Lerp(__m256 a, __m256 b, __m256 t){ return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t)); }
+
+  inline Block Lerp(const Block& a, const Block& b, __m256 t)
+  {
+    return Block{Lerp(a.r, b.r, t), Lerp(a.g, b.g, t), Lerp(a.b, b.b, t), Lerp(a.a, b.a, t)};
+  }
+
+  //nearest or bilinear filtering of 8 samples, each lane in its own level
+  inline Block FilterBlock(const int* texels, const LevelTables& tables, __m256i level, Wrap wrap, bool bilinear,
+    __m256 u, __m256 v)
+  {
+    __m256i wi = _mm256_i32gather_epi32(tables.width, level, 4);
+    __m256i hi = _mm256_i32gather_epi32(tables.height, level, 4);
+    __m256i tilesX = _mm256_i32gather_epi32(tables.tilesX, level, 4);
+    __m256i offset = _mm256_i32gather_epi32(tables.offset, level, 4);
+    __m256 w = _mm256_cvtepi32_ps(wi);
+    __m256 h = _mm256_cvtepi32_ps(hi);
+
+    if(!bilinear)
+    {
+      __m256i x = _mm256_cvttps_epi32(WrapBlock(_mm256_floor_ps(_mm256_mul_ps(u, w)), w, wrap));
+      __m256i y = _mm256_cvttps_epi32(WrapBlock(_mm256_floor_ps(_mm256_mul_ps(v, h)), h, wrap));
+      return Fetch(texels, offset, tilesX, x, y);
+    }
+
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 x = _mm256_sub_ps(_mm256_mul_ps(u, w), half);
+    __m256 y = _mm256_sub_ps(_mm256_mul_ps(v, h), half);
+    __m256 fx0 = _mm256_floor_ps(x);
+    __m256 fy0 = _mm256_floor_ps(y);
+    __m256 fx = _mm256_sub_ps(x, fx0);
+    __m256 fy = _mm256_sub_ps(y, fy0);
+
+    __m256i x0 = _mm256_cvttps_epi32(WrapBlock(fx0, w, wrap));
+    __m256i x1 = _mm256_cvttps_epi32(WrapBlock(_mm256_add_ps(fx0, one), w, wrap));
+    __m256i y0 = _mm256_cvttps_epi32(WrapBlock(fy0, h, wrap));
+    __m256i y1 = _mm256_cvttps_epi32(WrapBlock(_mm256_add_ps(fy0, one), h, wrap));
+
+    Block top = Lerp(Fetch(texels, offset, tilesX, x0, y0), Fetch(texels, offset, tilesX, x1, y0), fx);
+    Block bottom = Lerp(Fetch(texels, offset, tilesX, x0, y1), Fetch(texels, offset, tilesX, x1, y1), fx);
+    return Lerp(top, bottom, fy);
+  }
+}
+#endif
+
+void Texture::Sample(const Sampler& s, const float* u, const float* v, const float* lod, int count,
+  float* r, float* g, float* b, float* a)const
+{
+  int i = 0;
+
+#if defined(__AVX2__)
+  if(!m_Levels.empty())
+  {
+    LevelTables tables;
+    int levels = Levels();
+    for(int l = 0; l < levels; l++)
+    {
+      tables.width[l] = m_Levels[l].width;
+      tables.height[l] = m_Levels[l].height;
+      tables.tilesX[l] = m_Levels[l].tilesX;
+      tables.offset[l] = (int)m_Levels[l].offset;
+    }
+
+    const int* texels = reinterpret_cast<const int*>(m_Texels.data());
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 top = _mm256_set1_ps((float)(levels - 1));
+    const __m256i last = _mm256_set1_epi32(levels - 1);
+
+    for(; i + 8 <= count; i += 8)
+    {
+      __m256 vu = _mm256_loadu_ps(u + i);
+      __m256 vv = _mm256_loadu_ps(v + i);
+      __m256 vl = lod ? _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(lod + i), zero), top) : zero;
+
+      Block c;
+      if(s.filter == Filter::TRILINEAR)
+      {
+        __m256i l0 = _mm256_cvttps_epi32(vl);
+        __m256i l1 = _mm256_min_epi32(_mm256_add_epi32(l0, _mm256_set1_epi32(1)), last);
+        __m256 t = _mm256_sub_ps(vl, _mm256_cvtepi32_ps(l0));
+
+        c = Lerp(FilterBlock(texels, tables, l0, s.wrap, true, vu, vv),
+          FilterBlock(texels, tables, l1, s.wrap, true, vu, vv), t);
+      }
+      else
+      {
+        __m256i level = _mm256_cvttps_epi32(_mm256_add_ps(vl, _mm256_set1_ps(0.5f)));
+        c = FilterBlock(texels, tables, level, s.wrap, s.filter == Filter::BILINEAR, vu, vv);
+      }
+
+      _mm256_storeu_ps(r + i, c.r);
+      _mm256_storeu_ps(g + i, c.g);
+      _mm256_storeu_ps(b + i, c.b);
+      _mm256_storeu_ps(a + i, c.a);
+    }
+  }
+#endif
+
+  for(; i < count; i++)
+  {
+    Vec4 c = Sample(s, u[i], v[i], lod ? lod[i] : 0.0f);
+    r[i] = c.X();
+    g[i] = c.Y();
+    b[i] = c.Z();
+    a[i] = c.W();
+  }
+}
@@ -0,0 +1,218 @@
+#ifndef TINYRASTER_TEXTURE_H
+#define TINYRASTER_TEXTURE_H
+//--------------------------------------------------------------------
+//
+//  Name: Texture.h
+//
+//  Desc: RGBA8 textures with a precomputed mip chain and samplers.
+//  Texels are stored in 4x4 tiles of one 64-byte cache line each, in
+//  Morton (Z) order inside the tile, so the texels a bilinear
+//  footprint touches share a line whichever way the surface is
+//  rotated on screen. Samplers filter nearest, bilinear or
+//  trilinear; the level of detail comes from the screen-space
+//  derivatives of the texture coordinates. Batches of samples are
+//  filtered 8 at a time with AVX2 gathers, one at a time otherwise.
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include "./Color.h"
+#include "./Math.h"
+#include "./PixelFormat.h"
+
+//texels of a tile side; a tile is TEXTURE_TILE^2 texels (one cache line of RGBA8)
+#define TEXTURE_TILE 4
+
+//how a sampler filters: the nearest texel of the nearest level, a bilinear blend in the
+//nearest level, or bilinear blends in the two nearest levels blended again by the fraction
+enum class Filter
+{
+  NEAREST,
+  BILINEAR,
+  TRILINEAR
+};
+
+//what coordinates outside [0, 1] address: the texture repeated, or its edge texels
+enum class Wrap
+{
+  REPEAT,
+  CLAMP
+};
+
+struct Sampler
+{
+  Filter filter;
+  Wrap wrap;
+};
+
+class Texture
+{
+
+public:
+
+  class Invalid{};
+
+  Texture() : m_iWidth(0), m_iHeight(0) {}
+
+  //builds the texture and its mip chain from width * height texels, row-major from the top
+  //row. Throws Invalid for an empty size.
+  Texture(const RGBA8* texels, int width, int height);
+  Texture(const Color* texels, int width, int height);
+
+  int Width()const{return m_iWidth;}
+  int Height()const{return m_iHeight;}
+
+  //levels in the chain: level 0 is the full size, each one after it half the one before (at
+  //least 1 texel) down to 1x1
+  int Levels()const{return (int)m_Levels.size();}
+  int LevelWidth(int level)const{return m_Levels[level].width;}
+  int LevelHeight(int level)const{return m_Levels[level].height;}
+
+  const RGBA8& Texel(int level, int x, int y)const
+  {
+    const Level& l = m_Levels[level];
+    return m_Texels[l.offset + Address(l, x, y)];
+  }
+
+  //level of detail of a footprint whose texture coordinates change by (dudx, dvdx) one pixel
+  //to the right and (dudy, dvdy) one pixel down: log2 of the longer side in level-0 texels
+  float Lod(float dudx, float dvdx, float dudy, float dvdy)const
+  {
+    float ax = dudx * (float)m_iWidth, ay = dvdx * (float)m_iHeight;
+    float bx = dudy * (float)m_iWidth, by = dvdy * (float)m_iHeight;
+    float rho2 = std::max(ax * ax + ay * ay, bx * bx + by * by);
+    return rho2 > 0.0f ? 0.5f * std::log2(rho2) : 0.0f;
+  }
+
+  //filtered r, g, b, a in [0, 255] at (u, v), with u to the right and v down from the top-left
+  //corner; lod picks the level as from Lod
+  Vec4 Sample(const Sampler& s, float u, float v, float lod = 0.0f)const
+  {
+    if(m_Levels.empty()) return Vec4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    float top = (float)(Levels() - 1);
+    lod = lod > 0.0f ? (lod < top ? lod : top) : 0.0f;
+
+    if(s.filter == Filter::NEAREST) return Nearest(m_Levels[(int)(lod + 0.5f)], s.wrap, u, v);
+    if(s.filter == Filter::BILINEAR) return Bilinear(m_Levels[(int)(lod + 0.5f)], s.wrap, u, v);
+
+    int level = (int)lod;
+    Vec4 a = Bilinear(m_Levels[level], s.wrap, u, v);
+    if(level + 1 >= Levels()) return a;
+
+    Vec4 b = Bilinear(m_Levels[level + 1], s.wrap, u, v);
+    return a + (b - a) * (lod - (float)level);
+  }
+
+  Vec4 Sample(const Sampler& s, float u, float v, float dudx, float dvdx, float dudy, float dvdy)const
+  {
+    return Sample(s, u, v, Lod(dudx, dvdx, dudy, dvdy));
+  }
+
+  //samples count coordinates at once into the channel arrays r, g, b, a (lod may be null for
+  //level 0); the same results as Sample, 8 per step with AVX2
+  void Sample(const Sampler& s, const float* u, const float* v, const float* lod, int count,
+    float* r, float* g, float* b, float* a)const;
+
+private:
+
+  struct Level
+  {
+    int width;
+    int height;
+    int tilesX;
+    uint32_t offset;
+  };
+
+  //index of texel (x, y) inside its level: the tile, then the Morton order of x and y within it
+  static uint32_t Address(const Level& l, int x, int y)
+  {
+    uint32_t tile = (uint32_t)((y >> 2) * l.tilesX + (x >> 2));
+    uint32_t mx = (uint32_t)(x & 3), my = (uint32_t)(y & 3);
+    return tile * 16 + ((mx & 1) | ((my & 1) << 1) | ((mx & 2) << 1) | ((my & 2) << 2));
+  }
+
+  //a texel index for integer coordinate c on an axis of n texels
+  static int WrapCoord(int c, int n, Wrap wrap)
+  {
+    if(wrap == Wrap::CLAMP) return c < 0 ? 0 : (c >= n ? n - 1 : c);
+    c %= n;
+    return c < 0 ? c + n : c;
+  }
+
+  Vec4 Fetch(const Level& l, int x, int y)const
+  {
+    const RGBA8& t = m_Texels[l.offset + Address(l, x, y)];
+    return Vec4((float)t.r, (float)t.g, (float)t.b, (float)t.a);
+  }
+
+  Vec4 Nearest(const Level& l, Wrap wrap, float u, float v)const
+  {
+    int x = WrapCoord((int)std::floor(u * (float)l.width), l.width, wrap);
+    int y = WrapCoord((int)std::floor(v * (float)l.height), l.height, wrap);
+    return Fetch(l, x, y);
+  }
+
+  //texel centres sit at half-integer coordinates
+  Vec4 Bilinear(const Level& l, Wrap wrap, float u, float v)const
+  {
+    float x = u * (float)l.width - 0.5f;
+    float y = v * (float)l.height - 0.5f;
+    float fx0 = std::floor(x), fy0 = std::floor(y);
+    float fx = x - fx0, fy = y - fy0;
+
+    int x0 = WrapCoord((int)fx0, l.width, wrap), x1 = WrapCoord((int)fx0 + 1, l.width, wrap);
+    int y0 = WrapCoord((int)fy0, l.height, wrap), y1 = WrapCoord((int)fy0 + 1, l.height, wrap);
+
+    Vec4 top = Fetch(l, x0, y0) + (Fetch(l, x1, y0) - Fetch(l, x0, y0)) * fx;
+    Vec4 bottom = Fetch(l, x0, y1) + (Fetch(l, x1, y1) - Fetch(l, x0, y1)) * fx;
+    return top + (bottom - top) * fy;
+  }
+
+  void Build(const std::vector<RGBA8>& level0);
+
+  //tiles are one cache line each, so the texel storage starts on a line as well
+  template<typename T>
+  struct TexelAllocator
+  {
+    using value_type = T;
+
+    static constexpr size_t ALIGN = 64;
+
+    TexelAllocator() = default;
+    template<typename U>
+    TexelAllocator(const TexelAllocator<U>&) {}
+
+    T* allocate(size_t n)
+    {
+      return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(ALIGN)));
+    }
+
+    void deallocate(T* p, size_t)
+    {
+      ::operator delete(p, std::align_val_t(ALIGN));
+    }
+
+    template<typename U>
+    bool operator==(const TexelAllocator<U>&)const{return true;}
+    template<typename U>
+    bool operator!=(const TexelAllocator<U>&)const{return false;}
+  };
+
+  int m_iWidth;
+  int m_iHeight;
+
+  //every level's tiles, one after the other
+  std::vector<Level> m_Levels;
+  std::vector<RGBA8, TexelAllocator<RGBA8>> m_Texels;
+
+};
+
+#endif
@@ -0,0 +1,88 @@
+//----------------------------------------------------------
+//
+//  Name: Undelta.cpp
+//
+//  Desc: Rebuilds full frames from a sequence of .delta files
+//  written with Framebuffer::SetDeltaOutput. The first file
+//  must be a keyframe; every frame is written next to its
+//  delta as ppm, qoi or png:
+//    tr_undelta [--ppm|--qoi|--png] ../frame_0.delta ...
+//
+//----------------------------------------------------------
+
+#include "./FrameDelta.h"
+#include "./ImageEncoder.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+int main(int argc, char** argv)
+{
+  ImageFormat format = ImageFormat::PPM;
+  int first = 1;
+
+  if(argc > 1)
+  {
+    std::string opt = argv[1];
+    if(opt == "--ppm" || opt == "--qoi" || opt == "--png")
+    {
+      if(opt == "--qoi") format = ImageFormat::QOI;
+      if(opt == "--png") format = ImageFormat::PNG;
+      first = 2;
+    }
+  }
+
+  if(first >= argc)
+  {
+    std::cerr << "usage: tr_undelta [--ppm|--qoi|--png] frame_0.delta [frame_1.delta ...]" << std::endl;
+    return 1;
+  }
+
+  int threads = (int)std::thread::hardware_concurrency();
+  DeltaDecoder decoder;
+  std::vector<uint8_t> out;
+
+  for(int i = first; i < argc; i++)
+  {
+    std::string name = argv[i];
+    std::ifstream in(name, std::ios::binary);
+    if(!in)
+    {
+      std::cerr << "Error: cannot read " << name << std::endl;
+      return 1;
+    }
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    try
+    {
+      decoder.Apply(data.data(), data.size());
+    }
+    catch(DeltaDecoder::Invalid)
+    {
+      std::cerr << "Error: " << name << " is not a valid delta for this sequence" << std::endl;
+      return 1;
+    }
+
+    EncodeImage(format, decoder.Pixels(), decoder.Width(), decoder.Height(), threads, out);
+
+    std::string base = name.size() > 6 && name.compare(name.size() - 6, 6, ".delta") == 0 ?
+      name.substr(0, name.size() - 6) : name;
+    std::string target = base + "." + ImageExtension(format);
+
+    std::ofstream file(target, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(out.data()), (std::streamsize)out.size());
+    file.close();
+
+    if(!file)
+    {
+      std::cerr << "Error: cannot write " << target << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "Rebuilt " << argc - first << " frames" << std::endl;
+  return 0;
+}
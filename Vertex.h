@@ -5,7 +5,11 @@
 //  Name: Vertex.h
 //
 //  Desc: Vertex class for storing vertex data for rasterizing geometry
-//  and passing other attributes to the vertex
+//  and passing other attributes to the vertex. Varyings packs the
+//  attributes for PutShadedTriangle's varying-count overload; m_InvW
+//  is 1/w of the clip position the screen position was divided by,
+//  and makes their interpolation perspective-correct (1 for vertices
+//  that are already in screen space).
 //
 //  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
 //
@@ -17,8 +21,20 @@ struct Vertex
 {
   Vec3 m_Position;
   Vec3 m_Color;
-  //Vec3 m_Normal;
-  //Vec2 m_TextureCoords;
+  Vec3 m_Normal = Vec3();
+  Vec2 m_TextureCoords = Vec2();
+  float m_InvW = 1.0f;
+
+  //floats a vertex carries as varyings: color, normal, texture coordinates
+  static constexpr int VARYINGS = 8;
+
+  //writes the varyings to out[0, VARYINGS), color first
+  void Varyings(float* out)const
+  {
+    out[0] = m_Color.X(); out[1] = m_Color.Y(); out[2] = m_Color.Z();
+    out[3] = m_Normal.X(); out[4] = m_Normal.Y(); out[5] = m_Normal.Z();
+    out[6] = m_TextureCoords.X(); out[7] = m_TextureCoords.Y();
+  }
 };
 
 #endif
@@ -0,0 +1,358 @@
+#ifndef TINYRASTER_VERTEXBUFFER_H
+#define TINYRASTER_VERTEXBUFFER_H
+//--------------------------------------------------------------------
+//
+//  Name: VertexBuffer.h
+//
+//  Desc: Structure-of-arrays vertex positions and the batch vertex
+//  stage: one concatenated matrix, the perspective divide and the
+//  viewport map applied 8 vertices per iteration with AVX2 (scalar
+//  otherwise), and the post-transform vertex cache used by indexed
+//  drawing.
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "./Math.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+//maps normalized device coordinates to the framebuffer: p = ndc * scale + offset per axis
+struct Viewport
+{
+  float scaleX, scaleY, scaleZ;
+  float offsetX, offsetY, offsetZ;
+
+  //[-1, 1] onto the pixel centers 0 .. width-1 and height-1 .. 0 (rows are stored top-down, so
+  //y = 1 is row 0), z onto the depth range [0, 1]
+  static constexpr Viewport FromSize(float width, float height)
+  {
+    return Viewport{width / 2.0f, -height / 2.0f, 0.5f, (width - 1.0f) / 2.0f, (height - 1.0f) / 2.0f, 0.5f};
+  }
+};
+
+class VertexBuffer
+{
+
+public:
+
+  class Invalid{};
+
+  VertexBuffer() : m_iCount(0), m_uVersion(NextVersion()), m_pViewX(nullptr), m_pViewY(nullptr),
+                   m_pViewZ(nullptr), m_pViewW(nullptr) {}
+
+  explicit VertexBuffer(int count) : VertexBuffer()
+  {
+    Resize(count);
+  }
+
+  //a read-only view of count vertices whose streams live elsewhere (a memory-mapped mesh cache),
+  //kept alive by keep. Each stream must be padded to a multiple of 8 like the owned ones; the
+  //first write copies them into the buffer.
+  VertexBuffer(const float* x, const float* y, const float* z, const float* w, int count,
+    std::shared_ptr<const void> keep) : m_iCount(count),
+                                        m_uVersion(NextVersion()),
+                                        m_pKeep(std::move(keep)),
+                                        m_pViewX(x),
+                                        m_pViewY(y),
+                                        m_pViewZ(z),
+                                        m_pViewW(w)
+  {
+    if(count < 0 || !x || !y || !z || !w || !m_pKeep) throw Invalid{};
+  }
+
+  //resizes every stream; new vertices are (0, 0, 0, 1). Streams are padded to a multiple of 8
+  //so the batch stage never needs a scalar tail.
+  void Resize(int count)
+  {
+    if(count < 0) throw Invalid{};
+
+    Detach();
+
+    size_t padded = ((size_t)count + 7) & ~(size_t)7;
+    m_X.resize(padded, 0.0f);
+    m_Y.resize(padded, 0.0f);
+    m_Z.resize(padded, 0.0f);
+    m_W.resize(padded, 1.0f);
+    m_iCount = count;
+    m_uVersion = NextVersion();
+  }
+
+  int Size()const{return m_iCount;}
+
+  void Set(int index, const Vec4& p)
+  {
+    if(index < 0 || index >= m_iCount) throw Invalid{};
+
+    Detach();
+    m_X[index] = p.X();
+    m_Y[index] = p.Y();
+    m_Z[index] = p.Z();
+    m_W[index] = p.W();
+    m_uVersion = NextVersion();
+  }
+
+  void Set(int index, const Vec3& p){ Set(index, Vec4(p.X(), p.Y(), p.Z(), 1.0f)); }
+
+  Vec4 Get(int index)const
+  {
+    if(index < 0 || index >= m_iCount) throw Invalid{};
+
+    return Vec4(X()[index], Y()[index], Z()[index], W()[index]);
+  }
+
+  //screen position of a transformed vertex, as taken by the framebuffer's draw calls
+  Vec2 XY(int index)const{ return Vec2(X()[index], Y()[index]); }
+
+  //the streams, Size() valid entries each (plus padding). Writable access counts as a change
+  //of the contents.
+  float* X(){Detach(); m_uVersion = NextVersion(); return m_X.data();}
+  float* Y(){Detach(); m_uVersion = NextVersion(); return m_Y.data();}
+  float* Z(){Detach(); m_uVersion = NextVersion(); return m_Z.data();}
+  float* W(){Detach(); m_uVersion = NextVersion(); return m_W.data();}
+  const float* X()const{return m_pKeep ? m_pViewX : m_X.data();}
+  const float* Y()const{return m_pKeep ? m_pViewY : m_Y.data();}
+  const float* Z()const{return m_pKeep ? m_pViewZ : m_Z.data();}
+  const float* W()const{return m_pKeep ? m_pViewW : m_W.data();}
+
+  //true while the streams are a view of memory owned elsewhere
+  bool IsView()const{return m_pKeep != nullptr;}
+
+  //changes whenever the contents may have changed; unique across all buffers, so a cache can
+  //tell both a modified buffer and a different one at the same address from the one it saw
+  uint64_t Version()const{return m_uVersion;}
+
+private:
+
+  static uint64_t NextVersion()
+  {
+    static std::atomic<uint64_t> next{1};
+    return next++;
+  }
+
+  //copies viewed streams into the buffer's own, so they can be written
+  void Detach()
+  {
+    if(!m_pKeep) return;
+
+    size_t padded = ((size_t)m_iCount + 7) & ~(size_t)7;
+    m_X.assign(m_pViewX, m_pViewX + padded);
+    m_Y.assign(m_pViewY, m_pViewY + padded);
+    m_Z.assign(m_pViewZ, m_pViewZ + padded);
+    m_W.assign(m_pViewW, m_pViewW + padded);
+    m_pKeep.reset();
+  }
+
+  int m_iCount;
+  uint64_t m_uVersion;
+
+  std::vector<float> m_X;
+  std::vector<float> m_Y;
+  std::vector<float> m_Z;
+  std::vector<float> m_W;
+
+  //viewed streams, used only while m_pKeep is set
+  std::shared_ptr<const void> m_pKeep;
+  const float* m_pViewX;
+  const float* m_pViewY;
+  const float* m_pViewZ;
+  const float* m_pViewW;
+
+};
+
+//transforms one position by m, divides by the clip w and maps it through vp (the scalar form of
+//TransformVertices below)
+inline void TransformVertex(const Mat4& m, const Viewport& vp, float x, float y, float z, float w,
+  float& ox, float& oy, float& oz, float& ow)
+{
+  float cx = m.m_Mat[0][0] * x + m.m_Mat[0][1] * y + m.m_Mat[0][2] * z + m.m_Mat[0][3] * w;
+  float cy = m.m_Mat[1][0] * x + m.m_Mat[1][1] * y + m.m_Mat[1][2] * z + m.m_Mat[1][3] * w;
+  float cz = m.m_Mat[2][0] * x + m.m_Mat[2][1] * y + m.m_Mat[2][2] * z + m.m_Mat[2][3] * w;
+  float invW = 1.0f / (m.m_Mat[3][0] * x + m.m_Mat[3][1] * y + m.m_Mat[3][2] * z + m.m_Mat[3][3] * w);
+
+  ox = cx * invW * vp.scaleX + vp.offsetX;
+  oy = cy * invW * vp.scaleY + vp.offsetY;
+  oz = cz * invW * vp.scaleZ + vp.offsetZ;
+  ow = invW;
+}
+
+//transforms every position of in by m (model-view-projection, up to clip space), divides by
+//the clip w and maps the result through vp. out receives screen x and y, the viewport z, and
+//1/w in its w stream for later perspective-correct interpolation. in and out may be the same
+//buffer.
+inline void TransformVertices(const Mat4& m, const Viewport& vp, const VertexBuffer& in, VertexBuffer& out)
+{
+  int count = in.Size();
+  if(out.Size() != count) out.Resize(count);
+
+  //output first: in place on a view, this copies the streams the input then reads
+  float* ox = out.X();
+  float* oy = out.Y();
+  float* oz = out.Z();
+  float* ow = out.W();
+  const float* ix = in.X();
+  const float* iy = in.Y();
+  const float* iz = in.Z();
+  const float* iw = in.W();
+
+  int i = 0;
+
+#if defined(__AVX2__)
+  //row r of the matrix times 8 vertices: m[r][0]*x + m[r][1]*y + m[r][2]*z + m[r][3]*w
+  auto row = [&](int r, __m256 x, __m256 y, __m256 z, __m256 w)
+  {
+    __m256 a = _mm256_mul_ps(_mm256_set1_ps(m.m_Mat[r][0]), x);
+    __m256 b = _mm256_mul_ps(_mm256_set1_ps(m.m_Mat[r][1]), y);
+    a = _mm256_add_ps(a, _mm256_mul_ps(_mm256_set1_ps(m.m_Mat[r][2]), z));
+    b = _mm256_add_ps(b, _mm256_mul_ps(_mm256_set1_ps(m.m_Mat[r][3]), w));
+    return _mm256_add_ps(a, b);
+  };
+
+  //streams are padded to a multiple of 8, so the last partial batch runs on padding
+  for(; i < count; i += 8)
+  {
+    __m256 x = _mm256_loadu_ps(ix + i);
+    __m256 y = _mm256_loadu_ps(iy + i);
+    __m256 z = _mm256_loadu_ps(iz + i);
+    __m256 w = _mm256_loadu_ps(iw + i);
+
+    __m256 cx = row(0, x, y, z, w);
+    __m256 cy = row(1, x, y, z, w);
+    __m256 cz = row(2, x, y, z, w);
+    __m256 invW = _mm256_div_ps(_mm256_set1_ps(1.0f), row(3, x, y, z, w));
+
+    _mm256_storeu_ps(ox + i, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(cx, invW), _mm256_set1_ps(vp.scaleX)), _mm256_set1_ps(vp.offsetX)));
+    _mm256_storeu_ps(oy + i, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(cy, invW), _mm256_set1_ps(vp.scaleY)), _mm256_set1_ps(vp.offsetY)));
+    _mm256_storeu_ps(oz + i, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(cz, invW), _mm256_set1_ps(vp.scaleZ)), _mm256_set1_ps(vp.offsetZ)));
+    _mm256_storeu_ps(ow + i, invW);
+  }
+#endif
+
+  for(; i < count; i++)
+  {
+    TransformVertex(m, vp, ix[i], iy[i], iz[i], iw[i], ox[i], oy[i], oz[i], ow[i]);
+  }
+}
+
+//post-transform vertex cache for indexed drawing. It remembers which vertices of one buffer
+//have been through the vertex stage with one matrix and viewport, so every triangle corner
+//sharing a vertex, and later draws of the same buffer with the same matrix, reuse the result.
+//A different buffer, changed contents, matrix or viewport start it over.
+class VertexCache
+{
+
+public:
+
+  VertexCache() : m_pSource(nullptr), m_uVersion(0), m_Matrix(0.0f), m_Viewport{}, m_iTransformed(0) {}
+
+  //makes every vertex of in that indices reference available in Vertices() and Screen(), each
+  //transformed at most once. Returns how many vertices this call ran through the vertex stage;
+  //throws VertexBuffer::Invalid for an index outside in.
+  int Transform(const Mat4& m, const Viewport& vp, const VertexBuffer& in, const std::vector<int>& indices)
+  {
+    return Transform(m, vp, in, indices.data(), indices.size());
+  }
+
+  int Transform(const Mat4& m, const Viewport& vp, const VertexBuffer& in, const int* indices, size_t indexCount)
+  {
+    int count = in.Size();
+
+    if(&in != m_pSource || in.Version() != m_uVersion || std::memcmp(&m, &m_Matrix, sizeof(Mat4)) != 0 ||
+      std::memcmp(&vp, &m_Viewport, sizeof(Viewport)) != 0)
+    {
+      m_pSource = &in;
+      m_uVersion = in.Version();
+      m_Matrix = m;
+      m_Viewport = vp;
+      m_iTransformed = 0;
+      m_Done.assign(count, 0);
+      m_Out.Resize(count);
+      m_Screen.resize(count);
+    }
+
+    //bounds first, in a pass the compiler vectorizes
+    int lo = 0, hi = count - 1;
+    for(size_t k = 0; k < indexCount; k++)
+    {
+      lo = std::min(lo, indices[k]);
+      hi = std::max(hi, indices[k]);
+    }
+    if(lo < 0 || hi >= count) throw VertexBuffer::Invalid{};
+
+    int missing = count - m_iTransformed;
+    if(missing == 0 || indexCount == 0) return 0;
+
+    int transformed = 0;
+
+    //a draw with at least as many corners as uncached vertices normally covers the buffer: the
+    //batch stage transforms all of it at a fraction of the per-vertex cost, without a per-index
+    //lookup (vertices already cached come out the same)
+    if(indexCount >= (size_t)missing)
+    {
+      TransformVertices(m, vp, in, m_Out);
+      std::fill(m_Done.begin(), m_Done.end(), 1);
+      for(int i = 0; i < count; i++)
+      {
+        m_Screen[i] = m_Out.XY(i);
+      }
+      transformed = missing;
+    }
+    else
+    {
+      const float* ix = in.X();
+      const float* iy = in.Y();
+      const float* iz = in.Z();
+      const float* iw = in.W();
+      float* ox = m_Out.X();
+      float* oy = m_Out.Y();
+      float* oz = m_Out.Z();
+      float* ow = m_Out.W();
+
+      for(size_t k = 0; k < indexCount; k++)
+      {
+        int i = indices[k];
+        if(m_Done[i]) continue;
+
+        m_Done[i] = 1;
+        TransformVertex(m, vp, ix[i], iy[i], iz[i], iw[i], ox[i], oy[i], oz[i], ow[i]);
+        m_Screen[i] = Vec2(ox[i], oy[i]);
+        transformed++;
+      }
+    }
+
+    m_iTransformed += transformed;
+    return transformed;
+  }
+
+  //the transformed vertices (see TransformVertices) and their screen positions, indexed like
+  //the source buffer; only the entries referenced so far are valid
+  const VertexBuffer& Vertices()const{return m_Out;}
+  const std::vector<Vec2>& Screen()const{return m_Screen;}
+
+  //vertices run through the vertex stage since the cache last started over
+  int Transformed()const{return m_iTransformed;}
+
+private:
+
+  const VertexBuffer* m_pSource;
+  uint64_t m_uVersion;
+  Mat4 m_Matrix;
+  Viewport m_Viewport;
+  int m_iTransformed;
+
+  std::vector<uint8_t> m_Done;
+  VertexBuffer m_Out;
+  std::vector<Vec2> m_Screen;
+
+};
+
+#endif
@@ -0,0 +1,208 @@
+#include "./VideoSink.h"
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+//bt.601 limited range in 8.8 fixed point:
+//  Y = ((66R + 129G + 25B + 128) >> 8) + 16
+//  U = ((-38R - 74G + 112B + 128) >> 8) + 128
+//  V = ((112R - 94G - 18B + 128) >> 8) + 128
+static inline uint8_t LumaOf(int r, int g, int b)
+{
+  return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t ChromaU(int r, int g, int b)
+{
+  return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t ChromaV(int r, int g, int b)
+{
+  return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+//scalar conversion of the 2x2 block at (x, y); blocks on odd edges reuse the last row/column
+static void ConvertBlock(const Color* rgb, int width, int height, int x, int y, uint8_t* py,
+  uint8_t* pu, uint8_t* pv)
+{
+  int x1 = std::min(x + 1, width - 1);
+  int y1 = std::min(y + 1, height - 1);
+  const Color* px[4] = {
+    &rgb[y * width + x], &rgb[y * width + x1], &rgb[y1 * width + x], &rgb[y1 * width + x1]
+  };
+
+  int r = 0, g = 0, b = 0;
+  for(const Color* c : px)
+  {
+    r += c->r;
+    g += c->g;
+    b += c->b;
+  }
+
+  py[y * width + x] = LumaOf(px[0]->r, px[0]->g, px[0]->b);
+  if(x1 != x) py[y * width + x1] = LumaOf(px[1]->r, px[1]->g, px[1]->b);
+  if(y1 != y) py[y1 * width + x] = LumaOf(px[2]->r, px[2]->g, px[2]->b);
+  if(x1 != x && y1 != y) py[y1 * width + x1] = LumaOf(px[3]->r, px[3]->g, px[3]->b);
+
+  int c = (y / 2) * ((width + 1) / 2) + x / 2;
+  pu[c] = ChromaU((r + 2) >> 2, (g + 2) >> 2, (b + 2) >> 2);
+  pv[c] = ChromaV((r + 2) >> 2, (g + 2) >> 2, (b + 2) >> 2);
+}
+
+#if defined(__SSSE3__)
+//splits 8 packed rgb pixels (24 bytes) into three vectors of 16-bit channels. The two loads
+//overlap so nothing past the 24 bytes is read.
+static inline void LoadRGB8(const Color* src, __m128i& r, __m128i& g, __m128i& b)
+{
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(src);
+  __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+
+  //pixels 0-4 come from lo (bytes 0-14), pixels 5-7 from hi (bytes 15-23 are hi's 7-15)
+  r = _mm_or_si128(
+    _mm_shuffle_epi8(lo, _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, -1, -1, -1, -1, -1, -1)),
+    _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 7, -1, 10, -1, 13, -1)));
+  g = _mm_or_si128(
+    _mm_shuffle_epi8(lo, _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1)),
+    _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 8, -1, 11, -1, 14, -1)));
+  b = _mm_or_si128(
+    _mm_shuffle_epi8(lo, _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1)),
+    _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 9, -1, 12, -1, 15, -1)));
+}
+
+//luma of 8 pixels from 16-bit channels; the weighted sum stays below 2^16, so unsigned
+//16-bit arithmetic is exact
+static inline __m128i Luma8(__m128i r, __m128i g, __m128i b)
+{
+  __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)),
+    _mm_mullo_epi16(g, _mm_set1_epi16(129))), _mm_mullo_epi16(b, _mm_set1_epi16(25)));
+  sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+  return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+}
+
+//one chroma channel from averaged 16-bit channels; the sum fits a signed 16-bit lane
+static inline __m128i Chroma4(__m128i r, __m128i g, __m128i b, int kr, int kg, int kb)
+{
+  __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16((short)kr)),
+    _mm_mullo_epi16(g, _mm_set1_epi16((short)kg))), _mm_mullo_epi16(b, _mm_set1_epi16((short)kb)));
+  sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+  return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+}
+#endif
+
+void RGBToYUV420(const Color* rgb, int width, int height, uint8_t* y, uint8_t* u, uint8_t* v)
+{
+  int cw = (width + 1) / 2;
+
+  for(int row = 0; row < height; row += 2)
+  {
+    int x = 0;
+
+#if defined(__SSSE3__)
+    //two full rows, 8 pixels (4 chroma samples) per step
+    if(row + 1 < height)
+    {
+      const Color* s0 = rgb + row * width;
+      const Color* s1 = s0 + width;
+      uint8_t* y0 = y + row * width;
+      uint8_t* y1 = y0 + width;
+      uint8_t* pu = u + (row / 2) * cw;
+      uint8_t* pv = v + (row / 2) * cw;
+
+      for(; x + 8 <= width; x += 8)
+      {
+        __m128i r0, g0, b0, r1, g1, b1;
+        LoadRGB8(s0 + x, r0, g0, b0);
+        LoadRGB8(s1 + x, r1, g1, b1);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y0 + x), _mm_packus_epi16(Luma8(r0, g0, b0), _mm_setzero_si128()));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(y1 + x), _mm_packus_epi16(Luma8(r1, g1, b1), _mm_setzero_si128()));
+
+        //2x2 averages: add the rows, then adjacent lanes
+        const __m128i two = _mm_set1_epi16(2);
+        __m128i ra = _mm_srli_epi16(_mm_add_epi16(_mm_hadd_epi16(_mm_add_epi16(r0, r1), _mm_setzero_si128()), two), 2);
+        __m128i ga = _mm_srli_epi16(_mm_add_epi16(_mm_hadd_epi16(_mm_add_epi16(g0, g1), _mm_setzero_si128()), two), 2);
+        __m128i ba = _mm_srli_epi16(_mm_add_epi16(_mm_hadd_epi16(_mm_add_epi16(b0, b1), _mm_setzero_si128()), two), 2);
+
+        __m128i cu = _mm_packus_epi16(Chroma4(ra, ga, ba, -38, -74, 112), _mm_setzero_si128());
+        __m128i cv = _mm_packus_epi16(Chroma4(ra, ga, ba, 112, -94, -18), _mm_setzero_si128());
+
+        int32_t wu = _mm_cvtsi128_si32(cu);
+        int32_t wv = _mm_cvtsi128_si32(cv);
+        std::memcpy(pu + x / 2, &wu, 4);
+        std::memcpy(pv + x / 2, &wv, 4);
+      }
+    }
+#endif
+
+    for(; x < width; x += 2)
+    {
+      ConvertBlock(rgb, width, height, x, row, y, u, v);
+    }
+  }
+}
+
+VideoSink::VideoSink(int fd, VideoFormat format, int fps) : m_iFd(fd),
+                                                            m_Format(format),
+                                                            m_iFps(fps),
+                                                            m_iWidth(0),
+                                                            m_iHeight(0),
+                                                            m_iFrames(0)
+{}
+
+void VideoSink::WriteFrame()
+{
+  size_t pixels = (size_t)m_iWidth * m_iHeight;
+  m_Buffer.clear();
+
+  if(m_Format == VideoFormat::RAW_RGB)
+  {
+    //already in its final layout, no staging copy needed
+    WriteAll(reinterpret_cast<const uint8_t*>(m_RGB.data()), pixels * sizeof(Color));
+    m_iFrames++;
+    return;
+  }
+
+  if(m_iFrames == 0)
+  {
+    std::string header = "YUV4MPEG2 W" + std::to_string(m_iWidth) + " H" + std::to_string(m_iHeight) +
+      " F" + std::to_string(m_iFps) + ":1 Ip A1:1 C420jpeg\n";
+    m_Buffer.insert(m_Buffer.end(), header.begin(), header.end());
+  }
+
+  static const char tag[] = "FRAME\n";
+  m_Buffer.insert(m_Buffer.end(), tag, tag + 6);
+
+  size_t chroma = (size_t)((m_iWidth + 1) / 2) * ((m_iHeight + 1) / 2);
+  size_t start = m_Buffer.size();
+  m_Buffer.resize(start + pixels + 2 * chroma);
+
+  uint8_t* y = m_Buffer.data() + start;
+  RGBToYUV420(m_RGB.data(), m_iWidth, m_iHeight, y, y + pixels, y + pixels + chroma);
+
+  WriteAll(m_Buffer.data(), m_Buffer.size());
+  m_iFrames++;
+}
+
+void VideoSink::WriteAll(const uint8_t* data, size_t size)
+{
+  while(size > 0)
+  {
+    ssize_t n = ::write(m_iFd, data, size);
+
+    if(n < 0)
+    {
+      if(errno == EINTR) continue;
+      throw Invalid{};
+    }
+
+    data += n;
+    size -= (size_t)n;
+  }
+}
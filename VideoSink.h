@@ -0,0 +1,83 @@
+#ifndef TINYRASTER_VIDEOSINK_H
+#define TINYRASTER_VIDEOSINK_H
+//--------------------------------------------------------------------
+//
+//  Name: VideoSink.h
+//
+//  Desc: Streams frames back-to-back to a file descriptor (stdout, a
+//  pipe or a file) as YUV4MPEG2 or raw 24-bit rgb, one write per
+//  frame, so the renderer can feed an encoder directly:
+//    tr --y4m | ffmpeg -i - out.mp4
+//    tr --raw | ffmpeg -f rawvideo -pix_fmt rgb24 -s 1024x1024 -i - out.mp4
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <cstdint>
+#include <vector>
+#include "./Framebuffer.h"
+
+enum class VideoFormat
+{
+  Y4M,     //YUV4MPEG2, 4:2:0 bt.601 limited range, converted in-process
+  RAW_RGB  //packed 24-bit rgb frames with no header
+};
+
+//converts packed 24-bit rgb to planar 4:2:0 (bt.601, limited range). Each chroma sample is
+//taken from the average of a 2x2 block; y is width*height bytes, u and v are
+//((width+1)/2)*((height+1)/2) bytes each.
+void RGBToYUV420(const Color* rgb, int width, int height, uint8_t* y, uint8_t* u, uint8_t* v);
+
+class VideoSink
+{
+
+public:
+
+  class Invalid{};
+
+  //the descriptor is not owned and is left open; fps is only recorded in the y4m header
+  VideoSink(int fd, VideoFormat format, int fps = 30);
+
+  VideoSink(const VideoSink&)=delete;
+  VideoSink& operator=(const VideoSink&)=delete;
+
+  //writes the framebuffer as the next frame. Every frame must have the size of the first one.
+  template<typename P>
+  void Submit(TFramebuffer<P>& fbo)
+  {
+    if(m_iFrames > 0 && (fbo.Width() != m_iWidth || fbo.Height() != m_iHeight)) throw Invalid{};
+
+    m_iWidth = fbo.Width();
+    m_iHeight = fbo.Height();
+    m_RGB.resize((size_t)m_iWidth * m_iHeight);
+    fbo.ReadPixelsRGB(m_RGB.data());
+
+    WriteFrame();
+  }
+
+  int Frames(){return m_iFrames;}
+
+private:
+
+  //encodes m_RGB into m_Buffer (with the stream header before the first frame) and writes it
+  void WriteFrame();
+
+  //write() until every byte is out, throws Invalid on error
+  void WriteAll(const uint8_t* data, size_t size);
+
+  int m_iFd;
+  VideoFormat m_Format;
+  int m_iFps;
+
+  int m_iWidth;
+  int m_iHeight;
+  int m_iFrames;
+
+  //scratch reused by every frame: the rgb copy and the bytes written for the frame
+  std::vector<Color> m_RGB;
+  std::vector<uint8_t> m_Buffer;
+
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "./WorkerPool.h"
+
+WorkerPool::WorkerPool() : m_pJob(nullptr),
+                           m_iCount(0),
+                           m_iGeneration(0),
+                           m_iPending(0),
+                           m_bStop(false)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bStop = true;
+  }
+  m_Start.notify_all();
+
+  for(std::thread& t : m_Threads)
+  {
+    t.join();
+  }
+}
+
+void WorkerPool::Run(int count, const std::function<void(int)>& job)
+{
+  if(count <= 1)
+  {
+    if(count == 1) job(0);
+    return;
+  }
+
+  //new threads wait for the generation after the current one, which is the job below (only
+  //Run changes it, so it is read here without the lock)
+  while((int)m_Threads.size() < count - 1)
+  {
+    m_Threads.emplace_back(&WorkerPool::Work, this, (int)m_Threads.size(), m_iGeneration);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_pJob = &job;
+    m_iCount = count;
+    m_iPending = count - 1;
+    m_iGeneration++;
+  }
+  m_Start.notify_all();
+
+  //the calling thread works too
+  job(0);
+
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  m_Done.wait(lock, [this]{ return m_iPending == 0; });
+  m_pJob = nullptr;
+}
+
+void WorkerPool::Work(int index, uint64_t seen)
+{
+  for(;;)
+  {
+    const std::function<void(int)>* job;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Start.wait(lock, [&]{ return m_bStop || m_iGeneration != seen; });
+      if(m_bStop) return;
+
+      seen = m_iGeneration;
+      if(index + 1 >= m_iCount) continue;
+      job = m_pJob;
+    }
+
+    (*job)(index + 1);
+
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_iPending--;
+    }
+    m_Done.notify_one();
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef TINYRASTER_WORKERPOOL_H
+#define TINYRASTER_WORKERPOOL_H
+//--------------------------------------------------------------------
+//
+//  Name: WorkerPool.h
+//
+//  Desc: A set of worker threads kept alive between jobs. Run hands
+//  a job to several workers and returns once all of them are done;
+//  the threads are started the first time they are needed and then
+//  sleep on a condition variable, so a framebuffer that flushes many
+//  times a frame doesn't pay for creating and joining threads each
+//  time.
+//
+//  Author: Aayush Bade 2025 (aayushbade14.github.io/Portfolio)
+//
+//--------------------------------------------------------------------
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+
+public:
+
+  WorkerPool();
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  //runs job(0) .. job(count - 1) at the same time, job(0) on the calling thread and the others
+  //on pool threads (started here if there are fewer than count - 1), and waits for all of them
+  void Run(int count, const std::function<void(int)>& job);
+
+  int ThreadCount()const{return (int)m_Threads.size();}
+
+private:
+
+  //the loop of pool thread index, which has already seen generation seen
+  void Work(int index, uint64_t seen);
+
+  std::vector<std::thread> m_Threads;
+
+  std::mutex m_Mutex;
+  std::condition_variable m_Start;
+  std::condition_variable m_Done;
+
+  //the current job, run by the pool threads whose index + 1 is below m_iCount
+  const std::function<void(int)>* m_pJob;
+  int m_iCount;
+  //bumped for every job so each thread runs it once
+  uint64_t m_iGeneration;
+  //pool threads still running the current job
+  int m_iPending;
+  bool m_bStop;
+
+};
+
+#endif
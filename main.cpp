@@ -1,53 +1,110 @@
 #include "./Framebuffer.h"
+#include "./FrameWriter.h"
+#include "./Mesh.h"
+#include "./Scene.h"
+#include "./VideoSink.h"
+#include "./VertexBuffer.h"
+#include <algorithm>
 #include <cstdlib>
 #include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
 
-const float N = 0.1f;
-const float F = 1024.0f;
+constexpr float N = 0.1f;
+constexpr float F = 4096.0f;
 
-const float N_X = 1024.0f;
-const float N_Y = 1024.0f;
+constexpr float N_X = 1024.0f;
+constexpr float N_Y = 1024.0f;
 
-const float CS = 500.0f;
+constexpr float CS = 500.0f;
 
-const float PI = 3.141;
-const float THETA = PI/12.0f;
+constexpr float PI = 3.141;
+constexpr float THETA = PI/12.0f;
+constexpr float FOV = 45.0f * PI / 180.0f;
 
-int main(void)
+int main(int argc, char** argv)
 {
   std::srand(std::time(nullptr));
+
+  //--y4m or --raw streams every frame to stdout (e.g. "tr --y4m | ffmpeg -i - out.mp4")
+  //instead of writing one ppm file per frame; --qoi or --png writes compressed files instead,
+  //--delta only the tiles that changed since the previous frame (rebuilt with tr_undelta).
+  //Any other argument is an OBJ or PLY mesh to render in place of the cube.
+  std::string mode, meshPath;
+  for(int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if(arg.compare(0, 2, "--") == 0) mode = arg;
+    else meshPath = arg;
+  }
  
   try
   {
-    float fov = 45.0f * PI / 180.0f;
-    float L = -tan(fov/2.0f)*N;
-    float R = -L;
-    float B = -tan(fov/2.0f)*N;
-    float T = -B;
-
-    Mat4 M_vp;
-    M_vp.m_Mat[0][0] = N_X/2.0f;
-    M_vp.m_Mat[1][1] = N_Y/2.0f;
-    M_vp.m_Mat[0][3] = (N_X - 1)/2.0f;
-    M_vp.m_Mat[1][3] = (N_Y - 1)/2.0f;
-    
-    Mat4 M_perspective;
-    M_perspective.m_Mat[2][2] = -(F + N)/(F - N);
-    M_perspective.m_Mat[2][3] = -(2.0f * F * N)/(F - N);
-    M_perspective.m_Mat[3][2] = -1.0f;
-    M_perspective.m_Mat[0][0] = N;
-    M_perspective.m_Mat[1][1] = N;
-
-
-    Mat4 M_ortho;
-    M_ortho.m_Mat[0][0] = 2.0f/(R - L);
-    M_ortho.m_Mat[1][1] = 2.0f/(T - B);
-    M_ortho.m_Mat[2][2] = 2.0f/(F - N);
-    M_ortho.m_Mat[0][3] = -(R + L)/(R - L);
-    M_ortho.m_Mat[1][3] = -(T + B)/(T - B);
-    M_ortho.m_Mat[2][3] = -(F + N)/(F - N);
-
-    Mat4 M_proj = M_vp * M_ortho * M_perspective;
+    //the camera's lens is fixed, so the projection is folded at compile time
+    constexpr Mat4 M_proj = Mat4::Perspective(FOV, N_X / N_Y, N, F);
+
+    VertexBuffer cube(8);
+    cube.Set(0, Vec3(-CS/2.0f, -CS/2.0f, -CS/2.0f));
+    cube.Set(1, Vec3(CS/2.0f, -CS/2.0f, -CS/2.0f));
+    cube.Set(2, Vec3(CS/2.0f, CS/2.0f, -CS/2.0f));
+    cube.Set(3, Vec3(-CS/2.0f, CS/2.0f, -CS/2.0f));
+
+    cube.Set(4, Vec3(-CS/2.0f, -CS/2.0f, CS/2.0f));
+    cube.Set(5, Vec3(CS/2.0f, -CS/2.0f, CS/2.0f));
+    cube.Set(6, Vec3(CS/2.0f, CS/2.0f, CS/2.0f));
+    cube.Set(7, Vec3(-CS/2.0f, CS/2.0f, CS/2.0f));
+
+    //a mesh is parsed once and cached beside the source, later runs map the cache. It is
+    //centered and scaled to the cube's size.
+    Mesh mesh;
+    Mat4 M_fit;
+    if(!meshPath.empty())
+    {
+      mesh = Mesh::LoadCached(meshPath, (int)std::thread::hardware_concurrency());
+
+      Vec3 lo = mesh.BoundsMin(), hi = mesh.BoundsMax();
+      float extent = std::max(hi.X() - lo.X(), std::max(hi.Y() - lo.Y(), hi.Z() - lo.Z()));
+      float scale = extent > 0.0f ? CS / extent : 1.0f;
+      M_fit = Mat4(scale);
+      M_fit.m_Mat[3][3] = 1.0f;
+      M_fit.m_Mat[0][3] = -(lo.X() + hi.X()) / 2.0f * scale;
+      M_fit.m_Mat[1][3] = -(lo.Y() + hi.Y()) / 2.0f * scale;
+      M_fit.m_Mat[2][3] = -(lo.Z() + hi.Z()) / 2.0f * scale;
+    }
+
+    //the objects: the mesh, or the cube's faces as separate objects sharing its vertices. Each
+    //face is a quad of two triangles, counter-clockwise seen from outside; the shared diagonal is
+    //only drawn once and faces turned away are culled. The 8 corners are transformed once per
+    //frame, the later faces hit the vertex cache.
+    const std::vector<int> faces[6] = {
+      {0, 2, 1, 0, 3, 2}, //back
+      {0, 5, 4, 0, 1, 5}, //bottom
+      {1, 6, 5, 1, 2, 6}, //right
+      {0, 4, 7, 0, 7, 3}, //left
+      {4, 5, 6, 4, 6, 7}, //front
+      {3, 7, 6, 3, 6, 2}  //top
+    };
+    const CP faceColors[6] = {CP::ORANGE, CP::BLUE, CP::GREEN, CP::YELLOW, CP::RED, CP::WHITE};
+
+    Scene scene;
+    if(!meshPath.empty()) scene.Add(mesh, M_fit, CP::WHITE);
+    else for(int i = 0; i < 6; i++) scene.Add(cube, faces[i], Mat4(), faceColors[i]);
+
+    //frames are written by a background thread while the next one renders
+    FrameWriter writer(3);
+
+    std::unique_ptr<VideoSink> sink;
+    if(mode == "--y4m") sink.reset(new VideoSink(STDOUT_FILENO, VideoFormat::Y4M, 30));
+    if(mode == "--raw") sink.reset(new VideoSink(STDOUT_FILENO, VideoFormat::RAW_RGB, 30));
+
+    //one framebuffer for the whole sequence, so delta output can diff against the last frame
+    Framebuffer fbo(N_X, N_Y);
+    if(mode == "--qoi") fbo.SetImageFormat(ImageFormat::QOI);
+    if(mode == "--png") fbo.SetImageFormat(ImageFormat::PNG);
+    if(mode == "--delta") fbo.SetDeltaOutput(true);
+    fbo.SetCullMode(CullMode::BACK);
    
     for(int f = 0; f < 360; f++){
       Mat4 M_model_r;
@@ -97,87 +154,67 @@ int main(void)
       float x1 = 0.0f;
 
       Vec3 campos(x1, y1, z1);
-      Vec3 gaze = campos * -1.0f;
-
-      Vec3 w = Normalize(gaze);
-      Vec3 top = fabs(w.Y()) > 0.99f ? Vec3(1.0f, 0.0f, 0.0f) : Vec3(0.0f, 1.0f, 0.0f);
-
-      Vec3 u = Normalize(top.Cross(w));
-      Vec3 v = Normalize(w.Cross(u));
-      
-      Mat4 M_view;
-      M_view.m_Mat[0][0] = u.X();
-      M_view.m_Mat[1][0] = v.X();
-      M_view.m_Mat[2][0] = w.X();
-      
-      M_view.m_Mat[0][1] = u.Y();
-      M_view.m_Mat[1][1] = v.Y();
-      M_view.m_Mat[2][1] = w.Y();
-
-      M_view.m_Mat[0][2] = u.Z();
-      M_view.m_Mat[1][2] = v.Z();
-      M_view.m_Mat[2][2] = w.Z();
-
-      M_view.m_Mat[0][3] = -u.Dot(campos);
-      M_view.m_Mat[1][3] = -v.Dot(campos);
-      M_view.m_Mat[2][3] = -w.Dot(campos);
+      Mat4 M_view = Mat4::LookAt(campos, Vec3(0.0f, 0.0f, 0.0f), Vec3(0.0f, 1.0f, 0.0f));
 
       Mat4 M_model = R1;
       
-      Mat4 M_transform = M_proj * M_view * M_model;
-
-      std::vector<Vec4> vertices = {
-        {-CS/2.0f, -CS/2.0f, -CS/2.0f, 1.0f},
-        {CS/2.0f, -CS/2.0f, -CS/2.0f, 1.0f},
-        {CS/2.0f, CS/2.0f, -CS/2.0f, 1.0f},
-        {-CS/2.0f, CS/2.0f, -CS/2.0f, 1.0f},
-
-        {-CS/2.0f, -CS/2.0f, CS/2.0f, 1.0f},
-        {CS/2.0f, -CS/2.0f, CS/2.0f, 1.0f},
-        {CS/2.0f, CS/2.0f, CS/2.0f, 1.0f},
-        {-CS/2.0f, CS/2.0f, CS/2.0f, 1.0f}
-      };
-  
-      for(int i = 0; i < 8; i++)
+      for(int i = 0; i < scene.Size(); i++)
       {
-        Vec4 clip = M_view * M_model * vertices[i];
-        clip = M_perspective * clip;
+        scene.SetTransform(i, meshPath.empty() ? M_model : M_model * M_fit);
+      }
 
-        clip /= clip.W();
-        
-        vertices[i] = M_vp * M_ortho * clip;
-      } 
-
-      Framebuffer fbo(N_X, N_Y);
       fbo.ClearFramebuffer(CP::BLACK);
-    
-      //back
-      fbo.PutWireframeTriangle(vertices[0].X(), vertices[0].Y(), vertices[1].X(), vertices[1].Y(), vertices[2].X(), vertices[2].Y(), CP::ORANGE);
-      fbo.PutWireframeTriangle(vertices[0].X(), vertices[0].Y(), vertices[2].X(), vertices[2].Y(), vertices[3].X(), vertices[3].Y(), CP::ORANGE);
-      //bottom
-      fbo.PutWireframeTriangle(vertices[0].X(), vertices[0].Y(), vertices[4].X(), vertices[4].Y(), vertices[5].X(), vertices[5].Y(), CP::BLUE);
-      fbo.PutWireframeTriangle(vertices[0].X(), vertices[0].Y(), vertices[5].X(), vertices[5].Y(), vertices[1].X(), vertices[1].Y(), CP::BLUE);
-      //right
-      fbo.PutWireframeTriangle(vertices[1].X(), vertices[1].Y(), vertices[5].X(), vertices[5].Y(), vertices[6].X(), vertices[6].Y(), CP::GREEN);
-      fbo.PutWireframeTriangle(vertices[1].X(), vertices[1].Y(), vertices[6].X(), vertices[6].Y(), vertices[2].X(), vertices[2].Y(), CP::GREEN);
-      //left
-      fbo.PutWireframeTriangle(vertices[0].X(), vertices[0].Y(), vertices[4].X(), vertices[4].Y(), vertices[7].X(), vertices[7].Y(), CP::YELLOW);
-      fbo.PutWireframeTriangle(vertices[0].X(), vertices[0].Y(), vertices[7].X(), vertices[7].Y(), vertices[3].X(), vertices[3].Y(), CP::YELLOW);
-      //front
-      fbo.PutWireframeTriangle(vertices[4].X(), vertices[4].Y(), vertices[5].X(), vertices[5].Y(), vertices[6].X(), vertices[6].Y(), CP::RED);
-      fbo.PutWireframeTriangle(vertices[4].X(), vertices[4].Y(), vertices[6].X(), vertices[6].Y(), vertices[7].X(), vertices[7].Y(), CP::RED);
-      //top
-      fbo.PutWireframeTriangle(vertices[3].X(), vertices[3].Y(), vertices[7].X(), vertices[7].Y(), vertices[6].X(), vertices[6].Y(), CP::WHITE);
-      fbo.PutWireframeTriangle(vertices[3].X(), vertices[3].Y(), vertices[6].X(), vertices[6].Y(), vertices[2].X(), vertices[2].Y(), CP::WHITE);
-
-      fbo.BlitFramebuffer();
+
+      //objects outside the view are dropped before their vertices are transformed
+      scene.Draw(fbo, M_proj * M_view);
+
+      if(sink) sink->Submit(fbo);
+      else writer.Submit(fbo);
     }
+
+    writer.Wait();
+
+    //stdout carries the video when streaming
+    FrameWriter::Stats stats = writer.GetStats();
+    if(!sink) std::cout << "Wrote " << stats.written << " frames (" << stats.fileBytes / (1024.0 * 1024.0)
+      << " MB), queue depth avg " << stats.avgDepth
+      << " max " << stats.maxDepth << ", render thread stalled " << stats.stallSeconds * 1e3
+      << " ms, writer busy " << stats.writeSeconds * 1e3 << " ms (encoding " << stats.encodeSeconds * 1e3
+      << " ms, " << stats.EncodeMBps() << " MB/s)" << std::endl;
+
+    const ClipStats& clip = fbo.GetClipStats();
+    if(!sink) std::cout << "Assembled " << clip.triangles << " triangles: " << clip.culledFacing << " back-facing, "
+      << clip.culledFrustum << " outside the frustum, " << clip.clipped << " clipped" << std::endl;
+
+    const CullStats& cull = scene.Stats();
+    if(!sink) std::cout << "Drew " << cull.objectsVisible << " of " << scene.Size() * 360 << " objects ("
+      << cull.nodesVisited << " bvh nodes visited)" << std::endl;
   }
   catch(Color::Invalid)
   {
     std::cerr << "Error: Color::Invalid" << std::endl;
     exit(1);
   }
+  catch(FrameWriter::Invalid)
+  {
+    std::cerr << "Error: FrameWriter::Invalid (could not write a frame)" << std::endl;
+    exit(1);
+  }
+  catch(Mesh::Invalid)
+  {
+    std::cerr << "Error: Mesh::Invalid (could not load " << meshPath << ")" << std::endl;
+    exit(1);
+  }
+  catch(Scene::Invalid)
+  {
+    std::cerr << "Error: Scene::Invalid (an object's indices are out of range)" << std::endl;
+    exit(1);
+  }
+  catch(VideoSink::Invalid)
+  {
+    std::cerr << "Error: VideoSink::Invalid (could not stream a frame)" << std::endl;
+    exit(1);
+  }
 
   return 0;
 }